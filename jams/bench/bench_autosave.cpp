@@ -0,0 +1,101 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is provided 'as-is' under the zlib License, see the LICENSE.txt file.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#include <bench/bench_world.h>
+#include <toy/toy.h>
+
+#include <stdio.h>
+#include <random>
+#include <algorithm>
+
+bool bench_autosave(JobSystem& job_system)
+{
+	WorldSnapshot snapshot;
+	movable_snapshot(snapshot);
+
+	const size_t frames = 120;
+	const string path = "bench_autosave";
+	bool success = true;
+
+	for(size_t count : { size_t(10000), size_t(50000) })
+	{
+		DefaultWorld complex(string("bench_autosave"), job_system);
+		World& world = complex.m_world;
+
+		vector<HSpatial> spatials = populate_movables(world, count, uint32_t(count));
+		std::mt19937 random(uint32_t(count));
+
+		WorldAutosave autosave(snapshot);
+		autosave.m_path = path;
+		autosave.m_rotation = 1;
+		autosave.m_interval = 0.0;
+		autosave.m_enabled = true;
+
+		// a hundredth of the entities move on the first half of the frames, none on the second half
+		Clock clock;
+		double total = 0.0;
+		double worst = 0.0;
+		double capture = 0.0;
+		size_t captures = 0;
+		size_t reused = 0;
+		for(size_t frame = 0; frame < frames; ++frame)
+		{
+			if(frame < frames / 2)
+				for(size_t i = 0; i < count / 100; ++i)
+				{
+					HSpatial spatial = spatials[random() % count];
+					spatial->set_position(spatial->m_position + vec3(1.f, 0.f, 0.f));
+				}
+
+			world.next_frame(frame + 1, 1);
+
+			const bool saving = autosave.saving();
+			const double start = clock.read();
+			autosave.update(world);
+			const double time = clock.read() - start;
+			total += time;
+			worst = std::max(worst, time);
+
+			if(!saving && autosave.saving())
+			{
+				capture += autosave.m_capture_time;
+				captures++;
+				if(frame >= frames / 2)
+					reused = std::max(reused, autosave.m_reused);
+			}
+		}
+
+		// the last autosave holds the world as it is once the entities stopped
+		autosave.m_enabled = false;
+		world.m_tasks.join();
+		autosave.update(world);
+		autosave.save(world);
+		world.m_tasks.join();
+		autosave.update(world);
+
+		vector<uint8_t> expected;
+		snapshot.save(world, expected);
+
+		DefaultWorld target_complex(string("bench_autosave_load"), job_system);
+		World& target = target_complex.m_world;
+		vector<uint8_t> loaded;
+		const bool read = snapshot.load(target, path + ".1");
+		snapshot.save(target, loaded);
+		const bool restored = read && loaded == expected;
+		remove((path + ".1").c_str());
+
+		printf("[bench] autosave %zu entities : %zu saves of %zu bytes, capture %.3f ms average, frame %.3f ms average, %.3f ms worst, %zu sections unchanged at rest\n",
+			   count, autosave.m_saves, autosave.m_size, captures ? capture / double(captures) * 1000.0 : 0.0, total / double(frames) * 1000.0, worst * 1000.0, reused);
+
+		if(!restored)
+			printf("[bench] autosave %zu entities : autosaved world differs\n", count);
+
+		success &= restored && autosave.m_saves > 1 && reused > 0;
+
+		WorldSnapshot::clear(target);
+		WorldSnapshot::clear(world);
+	}
+
+	return success;
+}
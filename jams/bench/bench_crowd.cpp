@@ -0,0 +1,69 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is provided 'as-is' under the zlib License, see the LICENSE.txt file.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#include <bench/bench_world.h>
+#include <toy/toy.h>
+
+#include <stdio.h>
+#include <random>
+#include <algorithm>
+
+bool bench_crowd(JobSystem& job_system)
+{
+	const size_t frames = 120;
+	const float size = 400.f;
+	bool success = true;
+
+	for(size_t count : { size_t(1000), size_t(5000), size_t(10000) })
+	{
+		DefaultWorld complex(string("bench_crowd"), job_system);
+		World& world = complex.m_world;
+		flat_ground(complex.m_navmesh, size);
+		complex.m_navmesh.build();
+
+		Crowd crowd(world, complex.m_navmesh, count);
+		crowd.m_max_requests = count;
+
+		std::mt19937 random(uint32_t(count));
+		std::uniform_real_distribution<float> coord(-size * 0.45f, size * 0.45f);
+
+		vector<HCrowdAgent> agents;
+		vector<vec3> starts;
+		for(size_t i = 0; i < count; ++i)
+		{
+			const vec3 position = vec3(coord(random), 0.f, coord(random));
+			Entity entity = world.m_ecs.create<Spatial, Movable, CrowdAgent>();
+			world.m_ecs.set(entity, Spatial(world.origin(), position, ZeroQuat));
+			world.m_ecs.set(entity, Movable(position));
+			world.m_ecs.set(entity, CrowdAgent(entity, entity, crowd));
+			asa<CrowdAgent>(entity).set_target(vec3(coord(random), 0.f, coord(random)));
+			agents.push_back(HCrowdAgent(entity));
+			starts.push_back(position);
+		}
+
+		double total = 0.0;
+		double worst = 0.0;
+		for(size_t frame = 0; frame < frames; ++frame)
+		{
+			world.next_frame(frame + 1, 1);
+			total += crowd.m_update_time;
+			worst = std::max(worst, double(crowd.m_update_time));
+		}
+
+		size_t moved = 0;
+		for(size_t i = 0; i < count; ++i)
+			if(distance(agents[i]->m_spatial->m_position, starts[i]) > 0.1f)
+				++moved;
+
+		printf("[bench] crowd %zu agents : %zu active, %zu moved, update %.3f ms average, %.3f ms worst\n",
+			   count, crowd.m_active_agents, moved, total / double(frames) * 1000.0, worst * 1000.0);
+
+		success &= crowd.m_active_agents == count && moved > count / 2;
+
+		for(HCrowdAgent agent : agents)
+			destroy_spatial(agent->m_spatial);
+	}
+
+	return success;
+}
@@ -0,0 +1,103 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is provided 'as-is' under the zlib License, see the LICENSE.txt file.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#include <bench/bench_world.h>
+#include <toy/toy.h>
+
+#include <stdio.h>
+#include <random>
+
+bool bench_delta(JobSystem& job_system)
+{
+	WorldSnapshot snapshot;
+	movable_snapshot(snapshot);
+
+	const size_t frames = 200;
+	bool success = true;
+
+	for(size_t count : { size_t(1000), size_t(10000) })
+	{
+		DefaultWorld source_complex(string("bench_delta"), job_system);
+		DefaultWorld target_complex(string("bench_delta_decode"), job_system);
+		World& source = source_complex.m_world;
+		World& target = target_complex.m_world;
+
+		std::mt19937 random(uint32_t(count));
+		std::uniform_real_distribution<float> coord(-500.f, 500.f);
+		std::uniform_real_distribution<float> step(-0.5f, 0.5f);
+
+		// one entity out of four is the child of a previous one : destroying a parent destroys its contents along
+		vector<HSpatial> spatials = populate_movables(source, count, uint32_t(count), 4);
+
+		DeltaEncoder encoder(snapshot);
+		DeltaDecoder decoder(snapshot);
+
+		// each frame, a tenth of the entities move, and a hundredth are created, destroyed, or moved back to the origin
+		Clock clock;
+		double encode_time = 0.0;
+		double decode_time = 0.0;
+		size_t diverged = SIZE_MAX;
+		for(size_t frame = 0; frame < frames && diverged == SIZE_MAX; ++frame)
+		{
+			if(frame > 0)
+			{
+				for(size_t i = 0; i < count / 10 && !spatials.empty(); ++i)
+				{
+					HSpatial spatial = spatials[random() % spatials.size()];
+					spatial->set_position(spatial->m_position + vec3(step(random), 0.f, step(random)));
+				}
+
+				for(size_t i = 0; i < count / 100 && !spatials.empty(); ++i)
+				{
+					HSpatial spatial = spatials[random() % spatials.size()];
+					const uint32_t op = random() % 3;
+					if(op == 0)
+						spawn_movable(source, random() % 2 ? source.origin() : spatial, vec3(coord(random), 0.f, coord(random)));
+					else if(op == 2 && spatial->m_parent.m_handle != source.origin().m_handle)
+						set_parent(spatial, source.origin());
+					else if(op == 1)
+					{
+						// the contents of the destroyed spatial are gone with it
+						destroy_spatial(spatial);
+						spatials.clear();
+						gather_spatials(source.origin(), spatials);
+					}
+				}
+
+				spatials.clear();
+				gather_spatials(source.origin(), spatials);
+			}
+
+			vector<uint8_t> data;
+			double start = clock.read();
+			encoder.encode(source, data);
+			encode_time += clock.read() - start;
+
+			start = clock.read();
+			const bool decoded = decoder.decode(target, data);
+			decode_time += clock.read() - start;
+
+			if(!decoded || encoder.hash(source) != decoder.hash(target))
+				diverged = frame;
+		}
+
+		vector<HSpatial> decoded;
+		gather_spatials(target.origin(), decoded);
+
+		printf("[bench] delta %zu entities : %zu frames, %.2f bytes per entity, encode %.3f ms, decode %.3f ms average\n",
+			   count, frames, encoder.bytes_per_entity(), encode_time / double(frames) * 1000.0, decode_time / double(frames) * 1000.0);
+
+		if(diverged != SIZE_MAX)
+			printf("[bench] delta %zu entities : decoded world differs at frame %zu\n", count, diverged);
+		if(decoded.size() != spatials.size())
+			printf("[bench] delta %zu entities : %zu entities decoded, %zu encoded\n", count, decoded.size(), spatials.size());
+
+		success &= diverged == SIZE_MAX && decoded.size() == spatials.size();
+
+		WorldSnapshot::clear(source);
+		WorldSnapshot::clear(target);
+	}
+
+	return success;
+}
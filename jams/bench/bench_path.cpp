@@ -0,0 +1,89 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is provided 'as-is' under the zlib License, see the LICENSE.txt file.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#include <bench/bench_world.h>
+#include <toy/toy.h>
+
+#include <stdio.h>
+#include <random>
+#include <algorithm>
+
+bool bench_path(JobSystem& job_system)
+{
+	const size_t frames = 300;
+	const float size = 400.f;
+	bool success = true;
+
+	for(size_t count : { size_t(100), size_t(1000) })
+	{
+		DefaultWorld complex(string("bench_path"), job_system);
+		flat_ground(complex.m_navmesh, size);
+		complex.m_navmesh.build();
+
+		Pathfinder pathfinder(complex.m_navmesh);
+
+		std::mt19937 random(uint32_t(count));
+		std::uniform_real_distribution<float> coord(-size * 0.4f, size * 0.4f);
+		std::uniform_real_distribution<float> drift(-0.1f, 0.1f);
+
+		vector<unique<DetourPath>> paths;
+		vector<size_t> capacities;
+		for(size_t i = 0; i < count; ++i)
+		{
+			paths.push_back(make_unique<DetourPath>(pathfinder, vec3(coord(random), 0.f, coord(random)), vec3(coord(random), 0.f, coord(random))));
+			paths.back()->compute();
+			capacities.push_back(paths.back()->m_path.capacity() + paths.back()->m_waypoints.capacity() + paths.back()->m_poly_path.capacity());
+		}
+
+		const size_t scratch = pathfinder.m_polys.capacity() + pathfinder.m_points.capacity() + pathfinder.m_point_refs.capacity();
+
+		// each frame, every agent walks towards its next corner while its destination drifts : the corridors are repaired, never searched again
+		Clock clock;
+		double total = 0.0;
+		double worst = 0.0;
+		for(size_t frame = 0; frame < frames; ++frame)
+		{
+			const double start = clock.read();
+			for(unique<DetourPath>& path : paths)
+			{
+				vec3 origin = path->m_origin;
+				if(path->m_path.size() > 1)
+				{
+					const vec3 corner = path->m_path[path->m_path.size() - 2];
+					const vec3 to = corner - origin;
+					origin += length(to) > 0.5f ? normalize(to) * 0.5f : to;
+				}
+				path->update(origin, path->m_destination + vec3(drift(random), 0.f, drift(random)));
+				if(frame % 16 == 0)
+					path->optimize();
+			}
+			const double time = clock.read() - start;
+			total += time;
+			worst = std::max(worst, time);
+		}
+
+		size_t computes = 0;
+		size_t repairs = 0;
+		size_t reallocated = 0;
+		for(size_t i = 0; i < count; ++i)
+		{
+			computes += paths[i]->m_computes;
+			repairs += paths[i]->m_repairs;
+			reallocated += paths[i]->m_path.capacity() + paths[i]->m_waypoints.capacity() + paths[i]->m_poly_path.capacity() != capacities[i] ? 1 : 0;
+		}
+
+		const bool steady = pathfinder.m_polys.capacity() + pathfinder.m_points.capacity() + pathfinder.m_point_refs.capacity() == scratch;
+
+		printf("[bench] path %zu agents : %zu frames, %zu repairs, %zu full queries after the first, update %.3f ms average, %.3f ms worst\n",
+			   count, frames, repairs, computes - count, total / double(frames) * 1000.0, worst * 1000.0);
+
+		if(reallocated > 0 || !steady)
+			printf("[bench] path %zu agents : %zu paths and %s scratch buffers reallocated\n", count, reallocated, steady ? "no" : "the");
+
+		// a corridor invalidated by a tile may be planned again, but the steady state is repairs only
+		success &= computes - count <= count / 100 && reallocated == 0 && steady;
+	}
+
+	return success;
+}
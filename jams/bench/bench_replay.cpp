@@ -0,0 +1,99 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is provided 'as-is' under the zlib License, see the LICENSE.txt file.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#include <bench/bench_world.h>
+#include <toy/toy.h>
+#include <core/World/Replay.hpp>
+
+#include <stdio.h>
+#include <random>
+
+// entities are referred to by their index in the contents of the origin : their handles differ once the world is loaded
+struct Push
+{
+	uint32_t m_index;
+	vec3 m_offset;
+};
+
+static void push(World& world, const Push& push, float scale)
+{
+	vector<HSpatial>& contents = world.origin()->m_contents;
+	if(push.m_index < contents.size())
+	{
+		HSpatial spatial = contents[push.m_index];
+		spatial->set_position(spatial->m_position + push.m_offset * scale);
+	}
+}
+
+bool bench_replay(JobSystem& job_system)
+{
+	WorldSnapshot snapshot;
+	movable_snapshot(snapshot);
+
+	const size_t frames = 300;
+	const size_t pushes = 16;
+	const string path = "bench_replay.replay";
+	bool success = true;
+
+	for(size_t count : { size_t(1000), size_t(10000) })
+	{
+		DefaultWorld source_complex(string("bench_replay"), job_system);
+		World& source = source_complex.m_world;
+		populate_movables(source, count, uint32_t(count));
+
+		WorldRecorder recorder(snapshot);
+		recorder.channel<Push>("push", [](World& world, const Push& value) { push(world, value, 1.f); });
+		recorder.m_fixed_delta = 1;
+		recorder.record(source, uint32_t(count));
+
+		std::mt19937 random(uint32_t(count));
+		std::uniform_real_distribution<float> offset(-1.f, 1.f);
+
+		double record_time = 0.0;
+		for(size_t frame = 0; frame < frames; ++frame)
+		{
+			for(size_t i = 0; i < pushes; ++i)
+				recorder.input(source, "push", Push{ uint32_t(random() % count), vec3(offset(random), 0.f, offset(random)) });
+			recorder.next_frame(source);
+			record_time += recorder.m_frame_time;
+		}
+
+		const uint64_t recorded = recorder.hash(source);
+		recorder.stop(path);
+
+		vector<uint8_t> data;
+		WorldSnapshot::read_file(path, data);
+
+		// the same inputs replayed on a world loaded from the recording end in the same state
+		DefaultWorld replay_complex(string("bench_replay_load"), job_system);
+		WorldRecorder player(snapshot);
+		player.channel<Push>("push", [](World& world, const Push& value) { push(world, value, 1.f); });
+		const bool replayed = player.run(replay_complex.m_world, path);
+		const bool identical = replayed && player.hash(replay_complex.m_world) == recorded;
+
+		// inputs applied differently make the replay diverge, on the first frame they change the world
+		DefaultWorld diverge_complex(string("bench_replay_diverge"), job_system);
+		WorldRecorder diverging(snapshot);
+		diverging.channel<Push>("push", [](World& world, const Push& value) { push(world, value, 2.f); });
+		const bool diverged = !diverging.run(diverge_complex.m_world, path) && diverging.m_divergence == 0;
+
+		remove(path.c_str());
+
+		printf("[bench] replay %zu entities : %zu frames, %zu bytes, recorded %.3f ms per frame\n",
+			   count, frames, data.size(), record_time / double(frames) * 1000.0);
+
+		if(!identical)
+			printf("[bench] replay %zu entities : replayed world differs\n", count);
+		if(!diverged)
+			printf("[bench] replay %zu entities : diverging replay not detected at its first frame\n", count);
+
+		success &= identical && diverged;
+
+		WorldSnapshot::clear(source);
+		WorldSnapshot::clear(replay_complex.m_world);
+		WorldSnapshot::clear(diverge_complex.m_world);
+	}
+
+	return success;
+}
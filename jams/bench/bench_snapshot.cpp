@@ -0,0 +1,72 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is provided 'as-is' under the zlib License, see the LICENSE.txt file.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#include <bench/bench_world.h>
+#include <toy/toy.h>
+
+#include <stdio.h>
+
+bool bench_snapshot(JobSystem& job_system)
+{
+	WorldSnapshot snapshot;
+	movable_snapshot(snapshot);
+
+	const string json = "bench_snapshot.json";
+	bool success = true;
+
+	for(size_t count : { size_t(1000), size_t(10000), size_t(50000) })
+	{
+		DefaultWorld source_complex(string("bench_snapshot"), job_system);
+		DefaultWorld target_complex(string("bench_snapshot_load"), job_system);
+		World& source = source_complex.m_world;
+		World& target = target_complex.m_world;
+		// one entity out of four is the child of a previous one, to check the handles are remapped
+		populate_movables(source, count, uint32_t(count), 4);
+
+		Clock clock;
+		double start = clock.read();
+		vector<uint8_t> data;
+		snapshot.save(source, data);
+		const double save_time = clock.read() - start;
+
+		start = clock.read();
+		const bool loaded = snapshot.load(target, data);
+		const double load_time = clock.read() - start;
+
+		// the loaded world saves to the same bytes : same entities, in the same order, with the same fields
+		vector<uint8_t> reloaded;
+		snapshot.save(target, reloaded);
+		const bool identical = loaded && reloaded == data;
+
+		// a truncated snapshot is rejected before the world is cleared
+		vector<uint8_t> truncated(data.begin(), data.begin() + data.size() * 3 / 4);
+		vector<uint8_t> kept;
+		const bool rejected = !snapshot.load(target, truncated);
+		snapshot.save(target, kept);
+		const bool intact = kept == data;
+
+		start = clock.read();
+		pack_json_file(Ref(&source), json);
+		const double json_time = clock.read() - start;
+
+		vector<uint8_t> json_data;
+		WorldSnapshot::read_file(json, json_data);
+		remove(json.c_str());
+
+		printf("[bench] snapshot %zu entities : binary %zu bytes, save %.3f ms, load %.3f ms, json %zu bytes, save %.3f ms\n",
+			   count, data.size(), save_time * 1000.0, load_time * 1000.0, json_data.size(), json_time * 1000.0);
+
+		if(!identical)
+			printf("[bench] snapshot %zu entities : loaded world differs\n", count);
+		if(!rejected || !intact)
+			printf("[bench] snapshot %zu entities : truncated snapshot %s\n", count, !rejected ? "was loaded" : "modified the world");
+
+		success &= identical && rejected && intact;
+
+		WorldSnapshot::clear(source);
+		WorldSnapshot::clear(target);
+	}
+
+	return success;
+}
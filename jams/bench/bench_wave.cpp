@@ -0,0 +1,106 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is provided 'as-is' under the zlib License, see the LICENSE.txt file.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#include <bench/ex_bench.h>
+#include <toy/toy.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// terrain levels : a level sits next to the levels one step away on the sides, and on top of any lower or equal level
+static void level_rules(uint32_t num_levels, WaveRules& rules)
+{
+	rules.m_valid = true;
+	rules.m_num_tiles = num_levels;
+	rules.m_words = (num_levels + 63) / 64;
+	rules.m_weights.assign(num_levels, 1.f);
+	rules.m_weight_logs.assign(num_levels, 0.f);
+	rules.m_masks.assign(6 * size_t(num_levels) * rules.m_words, 0);
+
+	auto allow = [&](uint32_t direction, uint32_t tile, uint32_t other)
+	{
+		uint64_t* mask = &rules.m_masks[(size_t(direction) * num_levels + tile) * rules.m_words];
+		mask[other / 64] |= uint64_t(1) << (other % 64);
+	};
+
+	for(uint32_t tile = 0; tile < num_levels; ++tile)
+		for(uint32_t other = 0; other < num_levels; ++other)
+		{
+			if(abs(int(tile) - int(other)) <= 1)
+				for(uint32_t direction : { 0U, 1U, 4U, 5U })
+					allow(direction, tile, other);
+			if(other <= tile)
+			{
+				allow(2, other, tile);
+				allow(3, tile, other);
+			}
+		}
+}
+
+static bool wave_consistent(const WaveRules& rules, const TileWave& wave)
+{
+	const uvec3 size = wave.m_size;
+	for(uint z = 0; z < size.z; ++z) for(uint y = 0; y < size.y; ++y) for(uint x = 0; x < size.x; ++x)
+	{
+		const uint16_t tile = wave.tile({ x, y, z });
+		if(tile == UINT16_MAX)
+			return false;
+
+		for(uint32_t direction = 0; direction < 6; ++direction)
+		{
+			const ivec3 coord = ivec3(int(x), int(y), int(z)) + c_wave_directions[direction];
+			if(any(less(coord, ivec3(0))) || any(greaterThanEqual(coord, ivec3(size))))
+				continue;
+			const uint16_t other = wave.tile(uvec3(coord));
+			if(((rules.mask(direction, tile)[other / 64] >> (other % 64)) & 1) == 0)
+				return false;
+		}
+	}
+	return true;
+}
+
+bool bench_wave(JobSystem& job_system)
+{
+	UNUSED(job_system);
+
+	WaveRules rules;
+	level_rules(8, rules);
+
+	const uint64_t seeds[] = { 1, 42, 1337 };
+	bool success = true;
+
+	for(uint size : { 16U, 32U, 64U })
+	{
+		Clock clock;
+		double total = 0.0;
+
+		for(uint64_t seed : seeds)
+		{
+			// the same seed solves to the same tiles : the second solve is compared with the first
+			TileWave first;
+			TileWave second;
+
+			const double start = clock.read();
+			first.reset(rules, uvec3(size), false, seed);
+			first.solve();
+			total += clock.read() - start;
+
+			second.reset(rules, uvec3(size), false, seed);
+			second.solve();
+
+			bool identical = first.m_state == second.m_state;
+			for(uint z = 0; z < size && identical; ++z) for(uint y = 0; y < size && identical; ++y) for(uint x = 0; x < size && identical; ++x)
+				identical &= first.tile({ x, y, z }) == second.tile({ x, y, z });
+
+			const bool solved = first.m_state == TileWave::Solved && wave_consistent(rules, first);
+			if(!identical || !solved)
+				printf("[bench] wave %u^3 seed %llu : %s\n", size, (unsigned long long)seed, !solved ? "not solved" : "not identical");
+			success &= identical && solved;
+		}
+
+		printf("[bench] wave %u^3 : %zu seeds, solved in %.3f ms average\n", size, sizeof(seeds) / sizeof(seeds[0]), total / double(sizeof(seeds) / sizeof(seeds[0])) * 1000.0);
+	}
+
+	return success;
+}
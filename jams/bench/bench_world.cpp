@@ -0,0 +1,59 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is provided 'as-is' under the zlib License, see the LICENSE.txt file.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#include <bench/bench_world.h>
+#include <toy/toy.h>
+
+#include <random>
+
+void movable_snapshot(WorldSnapshot& snapshot)
+{
+	core_snapshot(snapshot);
+	snapshot.archetype<Spatial, Movable>();
+}
+
+HSpatial spawn_movable(World& world, HSpatial parent, const vec3& position, const quat& rotation)
+{
+	Entity entity = world.m_ecs.create<Spatial, Movable>();
+	world.m_ecs.set(entity, Spatial(world, parent, position, rotation));
+	world.m_ecs.set(entity, Movable(position));
+	parent->m_contents.push_back(HSpatial(entity));
+	return HSpatial(entity);
+}
+
+vector<HSpatial> populate_movables(World& world, size_t count, uint32_t seed, size_t nesting)
+{
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> coord(-500.f, 500.f);
+	std::uniform_real_distribution<float> angle(-c_pi, c_pi);
+
+	vector<HSpatial> spatials;
+	for(size_t i = 0; i < count; ++i)
+	{
+		const bool nested = nesting > 0 && !spatials.empty() && i % nesting == 0;
+		HSpatial parent = nested ? spatials[random() % spatials.size()] : world.origin();
+		spatials.push_back(spawn_movable(world, parent, vec3(coord(random), 0.f, coord(random)), angle_axis(angle(random), y3)));
+	}
+	return spatials;
+}
+
+void gather_spatials(HSpatial root, vector<HSpatial>& spatials)
+{
+	for(HSpatial child : root->m_contents)
+	{
+		spatials.push_back(child);
+		gather_spatials(child, spatials);
+	}
+}
+
+void flat_ground(Navmesh& navmesh, float size)
+{
+	const float s = size * 0.5f;
+	navmesh.m_geometry.m_vertices.push_back({ vec3(-s, 0.f, -s) });
+	navmesh.m_geometry.m_vertices.push_back({ vec3(-s, 0.f,  s) });
+	navmesh.m_geometry.m_vertices.push_back({ vec3( s, 0.f,  s) });
+	navmesh.m_geometry.m_vertices.push_back({ vec3( s, 0.f, -s) });
+	navmesh.m_geometry.m_triangles.push_back({ ShapeIndex(0), ShapeIndex(1), ShapeIndex(2) });
+	navmesh.m_geometry.m_triangles.push_back({ ShapeIndex(0), ShapeIndex(2), ShapeIndex(3) });
+}
@@ -0,0 +1,25 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is provided 'as-is' under the zlib License, see the LICENSE.txt file.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#pragma once
+
+#include <bench/ex_bench.h>
+
+#include <stdint.h>
+
+// worlds shared by the benches : movable entities for the benches of the world state, a flat ground for the ones of the navmesh
+
+// the core components, and the archetype of the entities the benches create
+void movable_snapshot(WorldSnapshot& snapshot);
+
+HSpatial spawn_movable(World& world, HSpatial parent, const vec3& position, const quat& rotation = ZeroQuat);
+
+// entities spread over the ground around the origin, with a random heading : when nesting is not zero, one entity out of nesting is the child of a previous one
+vector<HSpatial> populate_movables(World& world, size_t count, uint32_t seed, size_t nesting = 0);
+
+// every spatial under a root, parents first
+void gather_spatials(HSpatial root, vector<HSpatial>& spatials);
+
+// a flat ground of size x size, centered on the origin, for the benches of the navmesh : crowd and path
+void flat_ground(Navmesh& navmesh, float size);
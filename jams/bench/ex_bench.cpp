@@ -0,0 +1,51 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is provided 'as-is' under the zlib License, see the LICENSE.txt file.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#include <bench/ex_bench.h>
+#include <toy/toy.h>
+
+#include <stdio.h>
+#include <string.h>
+
+struct Bench
+{
+	const char* m_name;
+	bool(*m_run)(JobSystem& job_system);
+};
+
+static Bench benches[] =
+{
+	{ "crowd", bench_crowd },
+	{ "wave", bench_wave },
+	{ "snapshot", bench_snapshot },
+	{ "autosave", bench_autosave },
+	{ "replay", bench_replay },
+	{ "delta", bench_delta },
+	{ "path", bench_path },
+};
+
+#ifdef _EX_BENCH_EXE
+int main(int argc, char *argv[])
+{
+	// runs the benches named on the command line, all of them when none is
+	JobSystem job_system;
+
+	size_t failed = 0;
+	for(const Bench& bench : benches)
+	{
+		bool selected = argc < 2;
+		for(int i = 1; i < argc; ++i)
+			selected |= strcmp(argv[i], bench.m_name) == 0;
+		if(!selected)
+			continue;
+
+		printf("[bench] %s\n", bench.m_name);
+		const bool success = bench.m_run(job_system);
+		printf("[bench] %s %s\n", bench.m_name, success ? "passed" : "FAILED");
+		failed += success ? 0 : 1;
+	}
+
+	return failed > 0 ? 1 : 0;
+}
+#endif
@@ -0,0 +1,22 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is provided 'as-is' under the zlib License, see the LICENSE.txt file.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#pragma once
+
+#include <stl/vector.h>
+#include <stl/string.h>
+
+#include <toy/toy.h>
+
+using namespace two;
+using namespace toy;
+
+// headless checks and benchmarks : each one prints its measures, and returns false when its check fails
+bool bench_crowd(JobSystem& job_system);
+bool bench_wave(JobSystem& job_system);
+bool bench_snapshot(JobSystem& job_system);
+bool bench_autosave(JobSystem& job_system);
+bool bench_replay(JobSystem& job_system);
+bool bench_delta(JobSystem& job_system);
+bool bench_path(JobSystem& job_system);
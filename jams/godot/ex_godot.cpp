@@ -200,7 +200,8 @@ void Human::next_frame(Spatial& spatial, Movable& movable, Receptor& receptor, s
 		}
 		else
 		{
-			auto is_walkable = [&](const vec3& pos) { return as<PhysicWorld>(spatial.m_world->m_complex).ground_point(to_ray(pos, -y3)) != vec3(0.f); };
+			Navmesh& navmesh = as<Navmesh>(spatial.m_world->m_complex);
+			auto is_walkable = [&](const vec3& pos) { return navmesh.ground_point(pos, pos - y3 * 1000.f) != vec3(0.f); };
 
 			if(m_dest == vec3(0.f))
 			{
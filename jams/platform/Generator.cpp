@@ -5,6 +5,8 @@
 
 #include <toy/toy.h>
 
+#include <random>
+
 WaveTileset& generator_tileset(GfxSystem& gfx)
 {
 	LocatedFile location = gfx.locate_file("models/platform/platform.tls");
@@ -13,43 +15,61 @@ WaveTileset& generator_tileset(GfxSystem& gfx)
 	return tileset;
 }
 
-void generate_crates(Tileblock& block)
+// points at least radius apart, centered on the block, drawn from the seed of the block : a block loaded again gets the same points
+static vector<vec3> block_positions(Tileblock& block, float radius, uint32_t salt)
 {
-	HSpatial origin = block.m_spatial->m_world->origin();
+	const vec2 size = to_xz(block.m_wfc_block.m_aabb.m_extents);
+	std::mt19937 random(block.m_seed ^ salt);
+	std::uniform_real_distribution<float> x(-size.x * 0.5f, size.x * 0.5f);
+	std::uniform_real_distribution<float> z(-size.y * 0.5f, size.y * 0.5f);
+
+	vector<vec3> positions;
+	const size_t attempts = size_t(size.x * size.y / (radius * radius)) * 4 + 1;
+	for(size_t i = 0; i < attempts; ++i)
+	{
+		const vec3 position = vec3(x(random), 0.f, z(random));
+		bool free = true;
+		for(const vec3& other : positions)
+			free &= distance2(position, other) >= radius * radius;
+		if(free)
+			positions.push_back(position);
+	}
+	return positions;
+}
 
+// the populated entities are attached to their block : they are destroyed with it when it's evicted, and generated the same when it's loaded again
+void generate_crates(Tileblock& block)
+{
 	float crate_radius = 10.f;
-	vector<vec3> positions = distribute_poisson(to_xz(block.m_wfc_block.m_aabb.m_extents), crate_radius);
+	vector<vec3> positions = block_positions(block, crate_radius, 1U);
 	for(const vec3& position : positions)
 	{
-		construct<Crate>(origin, block.m_spatial->m_position + position + y3 * 10.f, vec3(0.75f));
+		construct<Crate>(block.m_spatial, position + y3 * 10.f, vec3(0.75f));
 	}
 }
 
 void generate_npcs(Tileblock& block)
 {
-	HSpatial origin = block.m_spatial->m_world->origin();
-
 	float npc_radius = 10.f;
-	vector<vec3> positions = distribute_poisson(to_xz(block.m_wfc_block.m_aabb.m_extents), npc_radius);
+	vector<vec3> positions = block_positions(block, npc_radius, 2U);
 	for(const vec3& position : positions)
 	{
-		construct<Human>(origin, block.m_spatial->m_position + position + y3 * 10.f, Faction::Enemy);
+		construct<Human>(block.m_spatial, position + y3 * 10.f, Faction::Enemy);
 	}
 }
 
 void generate_lamps(Tileblock& block)
 {
-	HSpatial origin = block.m_spatial->m_world->origin();
-
+	std::mt19937 random(block.m_seed ^ 3U);
 	for(size_t x = 0; x < block.m_wfc_block.m_tiles.m_x; ++x)
 		for(size_t y = 0; y < block.m_wfc_block.m_tiles.m_y; ++y)
 			for(size_t z = 0; z < block.m_wfc_block.m_tiles.m_z; ++z)
 			{
 				Tile& tile = block.m_wfc_block.m_tileset->m_tiles_flip[block.m_wfc_block.m_tiles.at(x, y, z)];
 				if(tile.m_name == "cube_covered_side")
-					if(randi(0, 9) > 8)
+					if(random() % 10 == 9)
 					{
-						construct<Lamp>(origin, block.m_wfc_block.to_position(uvec3(x, y, z)) + y3 * 1.5f * block.m_wfc_block.m_scale);
+						construct<Lamp>(block.m_spatial, block.m_wfc_block.to_position(uvec3(x, y, z)) - block.m_wfc_block.m_position + y3 * 1.5f * block.m_wfc_block.m_scale);
 					}
 			}
 }
@@ -1,6 +1,7 @@
 
 #include <platform/ex_platform.h>
 #include <toy/toy.h>
+#include <core/World/Snapshot.hpp>
 
 #include <platform/Api.h>
 #include <meta/_platform.meta.h>
@@ -38,10 +39,33 @@ TileWorld::TileWorld(const string& name, JobSystem& job_system)
 	, m_bullet_world(m_world)
 	, m_navmesh(m_world)
 	, m_block_size(vec3(m_block_subdiv) * m_tile_scale)
+	, m_stream(m_block_size)
+	, m_cache(name, 1U)
 {
 	m_world.m_pump.add_step({ Task::PhysicsWorld,
 		[&](size_t tick, size_t delta) { m_bullet_world.next_frame(tick, delta); }
 	});
+
+	m_stream.m_budget = 64U << 20;
+	m_stream.m_max_loads = 1U;
+
+	m_stream.m_on_load = [this](WorldStream::Page& page)
+	{
+		page.m_pinned = page.m_coord == m_center_coord;
+	};
+
+	m_stream.m_on_unload = [this](WorldStream::Page& page)
+	{
+		m_blocks.erase(page.m_coord);
+	};
+
+	m_stream.m_measure = [](WorldStream::Page& page)
+	{
+		size_t size = page.m_page->memory();
+		if(Tileblock* block = try_asa<Tileblock>(page.m_page))
+			size += block->m_transforms.size() * sizeof(mat4) + block->m_wfc_block.m_tiles.size() * sizeof(uint16_t);
+		return size;
+	};
 }
 
 TileWorld::~TileWorld()
@@ -52,12 +76,21 @@ void TileWorld::next_frame()
 	for(auto& coord_block : m_blocks)
 		if(coord_block.second && coord_block.second->m_setup && !coord_block.second->m_populated)
 		{
-			populate_block(*coord_block.second);
-			coord_block.second->m_populated = true;
+			Tileblock& block = *coord_block.second;
+			if(!block.m_cached)
+			{
+				vector<uint8_t> tiles;
+				save_tiles(block, tiles);
+				m_cache.store({ coord_block.first, block.m_seed }, "tiles", tiles);
+			}
+
+			// the entities of an evicted block are destroyed with it : a block loaded again is populated again, the same way
+			populate_block(block);
+			block.m_populated = true;
 		}
 }
 
-void TileWorld::generate_block(GfxSystem& gfx, const ivec2& coord)
+HTileblock TileWorld::generate_block(GfxSystem& gfx, const ivec2& coord)
 {
 	static WaveTileset& tileset = generator_tileset(gfx);
 
@@ -71,6 +104,22 @@ void TileWorld::generate_block(GfxSystem& gfx, const ivec2& coord)
 
 	m_blocks[coord] = block;
 
+	world_page.m_cache = &m_cache;
+	world_page.m_cache_key = { coord, block->m_seed };
+
+	// in verify mode, the block is solved again and compared with the cache once setup
+	vector<uint8_t> tiles;
+	if(!m_cache.m_verify && m_cache.read(world_page.m_cache_key, "tiles", tiles) && load_tiles(*block, tiles))
+	{
+		if(!m_center_block)
+		{
+			m_center_block = block;
+			m_center_coord = coord;
+		}
+		wfc.m_auto_solve = true;
+		return block;
+	}
+
 	// @todo why u clang no accept this ?
 	// for(size_t x : { 0U, block.m_wfc_block.m_tiles.m_x - 1 })
 	vector<size_t> xs = { 0U, wfc.m_tiles.m_x - 1 };
@@ -78,19 +127,35 @@ void TileWorld::generate_block(GfxSystem& gfx, const ivec2& coord)
 	for(size_t y = 0; y < wfc.m_tiles.m_y; ++y)
 	for(size_t z = 0; z < wfc.m_tiles.m_z; ++z)
 	{
-		uint16_t empty = 0;
-		wfc.m_wave.set_tile({ uint(x), uint(y), uint(z) }, empty);
+		block->set_tile({ uint(x), uint(y), uint(z) }, 0);
 	}
 
 	if(!m_center_block)
 	{
 		m_center_block = block;
+		m_center_coord = coord;
 		wfc.m_auto_solve = true;
-		return;
+		return block;
 	}
 
-	bool positive = (bool)m_blocks[coord + ivec2(0, -1)];
-	Tileblock& neighbour = positive ? *m_blocks[coord + ivec2(0, -1)] : *m_blocks[coord + ivec2(0, 1)];
+	// the seam is copied from a neighbour along z, blocks next to each other along x are both closed by empty tiles
+	auto below = m_blocks.find(coord + ivec2(0, -1));
+	auto above = m_blocks.find(coord + ivec2(0, 1));
+	bool positive = below != m_blocks.end();
+
+	if(!positive && above == m_blocks.end())
+	{
+		wfc.m_auto_solve = true;
+		return block;
+	}
+
+	// a neighbour still solving in the background has no tiles yet : it will be constrained by this block instead
+	Tileblock& neighbour = positive ? *below->second : *above->second;
+	if(neighbour.solving() || !neighbour.m_wfc_block.m_wave.m_solved)
+	{
+		wfc.m_auto_solve = true;
+		return block;
+	}
 
 	for(size_t x = 0; x < wfc.m_tiles.m_x; ++x)
 	for(size_t y = 0; y < wfc.m_tiles.m_y; ++y)
@@ -98,25 +163,24 @@ void TileWorld::generate_block(GfxSystem& gfx, const ivec2& coord)
 		size_t z = positive ? 0U : wfc.m_tiles.m_z - 1;
 		size_t adjacent_z = positive ? wfc.m_tiles.m_z - 1 : 0U;
 		uint16_t tile = neighbour.m_wfc_block.m_tiles.at(x, y, adjacent_z);
-		wfc.m_wave.set_tile({ uint(x), uint(y), uint(z) }, tile);
+		block->set_tile({ uint(x), uint(y), uint(z) }, tile);
 	}
 
 	wfc.m_wave.propagate();
 
 	wfc.m_auto_solve = true;
+	return block;
 }
 
 void TileWorld::open_blocks(GfxSystem& gfx, const vec3& position, const ivec2& radius)
 {
-	ivec2 coord = ivec2(to_xz(position / m_block_size));
+	if(m_stream.m_sources.empty())
+		m_stream.m_sources.push_back({ "generator", [this, &gfx](const ivec2& coord) -> Entity { return this->generate_block(gfx, coord); } });
 
-	for(int x = coord.x - radius.x; x < coord.x + radius.x + 1; ++x)
-	for(int y = coord.y - radius.y; y < coord.y + radius.y + 1; ++y)
-	{
-		ivec2 neighbour = { x, y };
-		if(!m_blocks[neighbour])
-			this->generate_block(gfx, neighbour);
-	}
+	// the page under the position is always wanted, even with a zero radius
+	const float range = float(max(radius.x, radius.y)) * max(m_block_size.x, m_block_size.z);
+	m_stream.m_anchors = { { position, range, 1.f } };
+	m_stream.update();
 }
 
 Entity Bullet::create(ECS& ecs, HSpatial parent, const vec3& source, const quat& rotation, float velocity)
@@ -131,9 +195,15 @@ Bullet::Bullet(HSpatial spatial, const vec3& source, const quat& rotation, float
 	: m_spatial(spatial)
 	, m_source(source)
 	, m_velocity(rotate(rotation, -z3) * velocity)
-	//, m_solid(Solid::create(m_spatial, *this, Sphere(0.1f), SolidMedium::me, CollisionGroup(energy), false, 1.f))
-	, m_collider(Collider::create(m_spatial, HMovable(), Sphere(0.1f), SolidMedium::me, CM_SOLID))
-{}
+{
+	this->rebuild();
+}
+
+void Bullet::rebuild()
+{
+	//m_solid = Solid::create(m_spatial, *this, Sphere(0.1f), SolidMedium::me, CollisionGroup(energy), false, 1.f);
+	m_collider = Collider::create(m_spatial, HMovable(), Sphere(0.1f), SolidMedium::me, CM_SOLID);
+}
 
 void Bullet::update()
 {
@@ -203,10 +273,21 @@ Human::Human(HSpatial spatial, HMovable movable, HEmitter emitter, HReceptor rec
 	, m_script(script)
 	, m_faction(faction)
 	, m_walk(false)
-	, m_solid(Solid::create(m_spatial, m_movable, CollisionShape(Capsule(0.35f, 1.1f), y3 * 0.9f), false, 1.f))
 {
-	emitter->add_sphere(VisualMedium::me, 0.1f);
-	receptor->add_sphere(VisualMedium::me, 30.f);
+	this->rebuild();
+}
+
+void Human::rebuild()
+{
+	m_solid = Solid::create(m_spatial, m_movable, CollisionShape(Capsule(0.35f, 1.1f), y3 * 0.9f), false, 1.f);
+	m_emitter->add_sphere(VisualMedium::me, 0.1f);
+	m_receptor->add_sphere(VisualMedium::me, 30.f);
+
+	// the bullets in flight are restored as contents of the human
+	m_bullets.clear();
+	for(HSpatial child : m_spatial->m_contents)
+		if(try_asa<Bullet>(child))
+			m_bullets.push_back(HBullet(child));
 }
 
 void Human::next_frame(Spatial& spatial, Movable& movable, Receptor& receptor, size_t tick, size_t delta)
@@ -286,7 +367,8 @@ void Human::next_frame(Spatial& spatial, Movable& movable, Receptor& receptor, s
 		}
 		else
 		{
-			auto is_walkable = [&](const vec3& pos) { return as<PhysicWorld>(spatial.m_world->m_complex).ground_point(to_ray(pos, -y3)) != vec3(0.f); };
+			Navmesh& navmesh = as<Navmesh>(spatial.m_world->m_complex);
+			auto is_walkable = [&](const vec3& pos) { return navmesh.ground_point(pos, pos - y3 * 1000.f) != vec3(0.f); };
 
 			if(m_dest == vec3(0.f))
 			{
@@ -385,8 +467,14 @@ Crate::Crate(HSpatial spatial, HMovable movable, const vec3& extents)
 	: m_spatial(spatial)
 	, m_movable(movable)
 	, m_extents(extents)
-	, m_solid(Solid::create(m_spatial, m_movable, Cube(extents), SolidMedium::me, CM_SOLID, false, 10.f))
-{}
+{
+	this->rebuild();
+}
+
+void Crate::rebuild()
+{
+	m_solid = Solid::create(m_spatial, m_movable, Cube(m_extents), SolidMedium::me, CM_SOLID, false, 10.f);
+}
 
 Player::Player(TileWorld& world)
 	: m_world(&world)
@@ -558,13 +646,18 @@ void paint_human(Gnode& parent, Human& human)
 void paint_world_block(Gnode& parent, Tileblock& block, const uvec3* exclude = nullptr)
 {
 	if(!block.m_wfc_block.m_wave.m_solved) return;
-	paint_tiles(parent, block.m_spatial, block.m_wfc_block, uvec3(UINT_MAX), exclude);
 	WorldPage& world_page = block.m_world_page;
 	if(world_page.m_updated > world_page.m_last_rebuilt)
 	{
 		build_block_geometry(*parent.m_scene, world_page, block);
 		world_page.update_geometry(world_page.m_spatial->m_last_tick);
 	}
+
+	// cutting a hole needs the tiles one by one, otherwise each tile model is drawn as a single batch
+	if(exclude)
+		paint_tiles(parent, block.m_spatial, block.m_wfc_block, uvec3(UINT_MAX), exclude);
+	else
+		paint_tileblock(parent, block);
 }
 
 void paint_crate(Gnode& parent, Crate& crate)
@@ -830,19 +923,19 @@ void ex_platform_menu(Widget& parent, Game& game)
 
 	if(ui::button(menu, button_style(), "Start (3rd Person)").activated())
 	{
-		game.m_module->start(*game.m_shell, game);
+		game.m_shell->start_game();
 		val<Player>(game.m_player).m_mode = ui::OrbitMode::ThirdPerson;
 	}
 
 	if(ui::button(menu, button_style(), "Start (Isometric)").activated())
 	{
-		game.m_module->start(*game.m_shell, game);
+		game.m_shell->start_game();
 		val<Player>(game.m_player).m_mode = ui::OrbitMode::Isometric;
 	}
 
 	if(ui::button(menu, button_style(), "Start (Pseudo Isometric)").activated())
 	{
-		game.m_module->start(*game.m_shell, game);
+		game.m_shell->start_game();
 		val<Player>(game.m_player).m_mode = ui::OrbitMode::PseudoIsometric;
 	}
 
@@ -897,6 +990,8 @@ public:
 		app.m_gfx->add_resource_path("examples/05_character");
 		app.m_gfx->add_resource_path("examples/17_wfc");
 
+		app.m_autosave.m_enabled = true;
+
 #ifdef SCRIPTED_IA
 		LocatedFile location = app.m_gfx->locate_file("scripts/enemy_ai.lua");
 
@@ -914,13 +1009,49 @@ public:
 		World& world = tileworld.m_world;
 		game.m_world = &world;
 
-		world.add_loop<Tileblock, WorldPage>(Task::Spatial);
-		world.add_loop<Human, Spatial, Movable, Receptor>(Task::GameObject);
-
 		static Player player = { tileworld };
 		game.m_player = Ref(&player);
 
-		tileworld.generate_block(*app.m_gfx, ivec2(0));
+		tileworld.open_blocks(*app.m_gfx, vec3(0.f), ivec2(0));
+	}
+
+	virtual void bind(GameShell& app, Game& game) final
+	{
+		World& world = *game.m_world;
+		world.add_loop<Tileblock, WorldPage>(Task::Spatial);
+		world.add_loop<Human, Spatial, Movable, Receptor>(Task::GameObject);
+
+		block_snapshot(app.m_snapshot);
+		app.m_snapshot.component<Bullet>();
+		app.m_snapshot.component<Human>();
+		app.m_snapshot.component<Lamp>();
+		app.m_snapshot.component<Crate>();
+		app.m_snapshot.handle<HBullet>();
+		app.m_snapshot.handle<HHuman>();
+		app.m_snapshot.handle<HLamp>();
+		app.m_snapshot.handle<HCrate>();
+		app.m_snapshot.archetype<Spatial, Bullet>();
+		app.m_snapshot.archetype<Spatial, Movable, Emitter, Receptor, EntityScript, Human>();
+		app.m_snapshot.archetype<Spatial, Movable, Lamp>();
+		app.m_snapshot.archetype<Spatial, Movable, Crate>();
+
+		// the solids and colliders are not stored, they are created again from the restored components
+		app.m_snapshot.rebuild<Bullet>([](Bullet& bullet) { bullet.rebuild(); });
+		app.m_snapshot.rebuild<Human>([](Human& human) { human.rebuild(); });
+		app.m_snapshot.rebuild<Crate>([](Crate& crate) { crate.rebuild(); });
+
+		// a loaded world replaced every entity : the human of the player is then the one of its faction
+		Player& player = val<Player>(game.m_player);
+		app.m_snapshot.remap([&player](World& world, const WorldSnapshot::Remap& remap)
+		{
+			player.m_human = HHuman(remap(player.m_human));
+			if(!player.m_human)
+				world.m_ecs.loop<Human>([&](Human& human)
+				{
+					if(human.m_faction == Faction::Ally)
+						player.m_human = HHuman(human.m_spatial);
+				});
+		});
 	}
 
 	virtual void scene(GameShell& app, GameScene& scene) final
@@ -64,10 +64,17 @@ public:
 
 	std::map<ivec2, HTileblock> m_blocks;
 	HTileblock m_center_block = {};
+	ivec2 m_center_coord = ivec2(0);
+
+	// blocks are generated around the player and evicted least recently used once out of range
+	WorldStream m_stream;
+
+	// solved tiles of the blocks, so that a block already visited is not solved again
+	PageCache m_cache;
 
 	void next_frame();
 
-	void generate_block(GfxSystem& gfx, const ivec2& coord);
+	HTileblock generate_block(GfxSystem& gfx, const ivec2& coord);
 	void open_blocks(GfxSystem& gfx, const vec3& position, const ivec2& radius);
 };
 
@@ -91,6 +98,8 @@ public:
 	//OSolid m_solid;
 	OCollider m_collider;
 
+	// creates the collider, which is not stored in snapshots
+	void rebuild();
 	void update();
 };
 
@@ -162,6 +171,8 @@ public:
 
 	vector<EntityHandle<Bullet>> m_bullets;
 
+	// creates the solid, the emitter and receptor spheres, and gathers the bullets, none of which are stored in snapshots
+	void rebuild();
 	void next_frame(Spatial& spatial, Movable& movable, Receptor& receptor, size_t tick, size_t delta);
 
 	meth_ quat sight(bool aiming = true);
@@ -199,6 +210,9 @@ public:
 
 	attr_ vec3 m_extents;
 	OSolid m_solid;
+
+	// creates the solid, which is not stored in snapshots
+	void rebuild();
 };
 
 class refl_ _PLATFORM_EXPORT Player
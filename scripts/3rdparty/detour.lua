@@ -5,6 +5,7 @@ detour = dep(nil, "detour")
 	includedirs {
         path.join(TOY_3RDPARTY_DIR, "recast", "Recast", "Include"),
         path.join(TOY_3RDPARTY_DIR, "recast", "Detour", "Include"),
+        path.join(TOY_3RDPARTY_DIR, "recast", "DetourCrowd", "Include"),
 	}
 
 	files {
@@ -13,6 +14,9 @@ detour = dep(nil, "detour")
         
         path.join(TOY_3RDPARTY_DIR, "recast", "Detour", "Include", "*.h"),
         path.join(TOY_3RDPARTY_DIR, "recast", "Detour", "Source", "*.cpp"),
+        
+        path.join(TOY_3RDPARTY_DIR, "recast", "DetourCrowd", "Include", "*.h"),
+        path.join(TOY_3RDPARTY_DIR, "recast", "DetourCrowd", "Source", "*.cpp"),
 	}
     
     configuration { "mingw* or linux or osx or asmjs" }
@@ -25,6 +25,7 @@ platform    = module(nil, "_platform",  path.join(TOY_DIR, "jams"), "platform",
 blocks      = module(nil, "_blocks",    path.join(TOY_DIR, "jams"), "blocks",   nil, uses_jam, true, toy.all)
 script      = module(nil, "_wren",      path.join(TOY_DIR, "jams"), "wren",     nil, uses_jam, true, toy.all)
 godot       = module(nil, "_godot",     path.join(TOY_DIR, "jams"), "godot",    nil, uses_jam, true, toy.all)
+bench       = module(nil, "_bench",     path.join(TOY_DIR, "jams"), "bench",    nil, uses_jam, false, toy.all)
 
 function preload_example_folder(name)
     configuration { "asmjs" }
@@ -54,6 +55,8 @@ jam_project("platform", { platform }, { "05_character", "17_wfc" })
 jam_project("blocks",   { blocks })
 jam_project("wren",     { script })
 jam_project("godot",    { godot }, { "05_character" })
+-- headless checks and benchmarks, run without a window
+jam_project("bench",    { bench })
 
 project "ex_boids"
     includedirs {
@@ -5,6 +5,11 @@ newoption {
     description = "Use toy misc module",
 }
 
+newoption {
+    trigger = "db",
+    description = "Use toy db module (links to the sqlite3 library of the system)",
+}
+
 TOY_DIR        = path.getabsolute("..")
 TWO_DIR        = path.join(TOY_DIR, "two")
 
@@ -16,6 +16,7 @@ function toy_core()
     includedirs {
         path.join(TOY_3RDPARTY_DIR, "recast", "Recast", "Include"),
         path.join(TOY_3RDPARTY_DIR, "recast", "Detour", "Include"),
+        path.join(TOY_3RDPARTY_DIR, "recast", "DetourCrowd", "Include"),
         path.join(TOY_3RDPARTY_DIR, "bullet", "src"),
     }
 
@@ -54,6 +55,12 @@ function uses_toy_visu()
     end
 end
 
+function toy_db()
+    links {
+        "sqlite3",
+    }
+end
+
 function toy_shell()
     includedirs {
         path.join(TWO_3RDPARTY_DIR, "tracy"),
@@ -76,11 +83,17 @@ toy.shell       = module("toy", "shell",    TOY_SRC_DIR, "shell",   toy_shell,
 if _OPTIONS["misc"] then
     toy.misc    = module("toy", "misc",     TOY_SRC_DIR, "misc",    nil,            nil,            true,       { two.type, two.math, toy.core })
 end
+if _OPTIONS["db"] then
+    toy.db      = module("toy", "db",       TOY_SRC_DIR, "db",      toy_db,         nil,            false,      { two.type, two.refl, two.jobs, two.ecs, two.math, toy.core })
+end
 
 toy.toy = { toy.util, toy.core, toy.visu, toy.edit, toy.block, toy.shell }
 if _OPTIONS["misc"] then
     table.insert(toy.toy, toy.misc)
 end
+if _OPTIONS["db"] then
+    table.insert(toy.toy, toy.db)
+end
 
 function toy_libs()
     if _OPTIONS["unity"] then
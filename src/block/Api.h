@@ -1,12 +1,17 @@
 #include <math/Image256.h>
 #include <gfx/GfxSystem.h>
 #include <block/Block.h>
+#include <block/BlockLod.h>
+#include <block/BlockMesh.h>
 #include <block/Chunk.h>
 #include <block/Element.h>
 #include <block/Elements.h>
 #include <block/Forward.h>
 #include <block/Handles.h>
 #include <block/Sector.h>
+#include <block/TileWave.h>
 #include <block/Types.h>
 #include <block/VisuBlock.h>
+#include <block/VoxelQuery.h>
+#include <block/Voxels.h>
 
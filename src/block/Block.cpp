@@ -9,17 +9,24 @@ module toy.block
 #include <math/Grid.hpp>
 #include <math/Image256.h>
 #include <geom/Shapes.h>
+#include <geom/Geometry.h>
 #include <ecs/ECS.hpp>
 #include <core/World/World.hpp>
 #include <core/Spatial/Spatial.h>
 #include <core/Physic/Scope.h>
 #include <core/Physic/CollisionShape.h>
 #include <core/WorldPage/WorldPage.h>
+#include <core/Physic/Collider.h>
+#include <core/Physic/Solid.h>
 #include <block/Types.h>
 #include <block/Block.h>
 #include <block/Sector.h>
+#include <block/Element.h>
+#include <block/BlockMesh.h>
 #endif
 
+#include <memory>
+
 #define BLOCK_SUBDIV 20U
 
 namespace toy
@@ -47,29 +54,41 @@ namespace toy
 	{
 		block.reset();
 
-		uint16_t subdiv = block.subdiv();
-		for(uint16_t y = 0; y < subdiv; ++y)
-			for(uint16_t x = 0; x < subdiv; ++x)
+		const uint32_t subdiv = block.subdiv();
+
+		// the layers under the lowest column are filled as a single slab, the columns only above it
+		uint32_t floor = subdiv;
+		for(uint32_t y = 0; y < subdiv; ++y)
+			for(uint32_t x = 0; x < subdiv; ++x)
 			{
-				uint32_t height = image.at(uvec2(x, y));
-				for(uint32_t z = 0; z <= height; ++z)
-					block.chunk(x, z, y, element);
+				const uint32_t top = image.at(uvec2(x, y)) + 1;
+				floor = top < floor ? top : floor;
 			}
+
+		block.fill_slab(0, floor, element);
+
+		for(uint32_t y = 0; y < subdiv; ++y)
+			for(uint32_t x = 0; x < subdiv; ++x)
+				block.fill_column(x, y, floor, image.at(uvec2(x, y)) + 1, element);
 	}
 
 	void paint_block_elements(Block& block, Image256& image, span<Element*> elements)
 	{
-		uint16_t subdiv = block.subdiv();
-		for(uint16_t y = 0; y < subdiv; ++y)
-			for(uint16_t x = 0; x < subdiv; ++x)
-				for(uint16_t z = 0; z < subdiv; ++z)
-				{
-					size_t colour = image.at(uvec2(x, y));
-					Element* element = block.m_chunks.at(x, z, y);
+		// the solid palette entries are flagged once instead of checking the state of every voxel
+		const vector<Element*>& palette = block.m_chunks.m_palette;
+		std::unique_ptr<bool[]> solid(new bool[palette.size()]);
+		for(size_t i = 0; i < palette.size(); ++i)
+			solid[i] = palette[i] && palette[i]->m_state == MatterState::Solid;
 
-					if(element->m_state == MatterState::Solid)
-						block.chunk(x, z, y, *elements[colour]);
-				}
+		const span<bool> mask = { solid.get(), palette.size() };
+
+		const uint32_t subdiv = block.subdiv();
+		for(uint32_t y = 0; y < subdiv; ++y)
+			for(uint32_t x = 0; x < subdiv; ++x)
+			{
+				size_t colour = image.at(uvec2(x, y));
+				block.m_chunks.replace_column(x, y, mask, elements[colour]);
+			}
 	}
 
 	Entity Block::create(ECS& ecs, HSpatial parent, HWorldPage world_page, const vec3& position, Block* parentblock, size_t index, const vec3& size)
@@ -88,6 +107,7 @@ namespace toy
 		, m_parentblock(parentblock)
 		, m_index(index)
 		, m_size(size)
+		, m_depth(parentblock ? parentblock->m_depth + 1 : 0)
 		, m_chunks(BLOCK_SUBDIV)
 		, m_subblocks(2)
 		//, m_scope(m_emitter.add_scope(WorldMedium::me, Cube(m_size), CM_SOURCE))
@@ -127,17 +147,36 @@ namespace toy
 
 	void Block::reset()
 	{
-		for(Element*& chunk : m_chunks)
-			chunk = nullptr;
+		m_chunks.fill(nullptr);
 	}
 
 	void Block::chunk(size_t x, size_t y, size_t z, Element& element)
 	{
-		m_chunks.at(x, y, z) = &element;
+		m_chunks.set(uint32_t(x), uint32_t(y), uint32_t(z), &element);
+	}
+
+	void Block::fill_column(size_t x, size_t z, size_t bottom, size_t top, Element& element)
+	{
+		m_chunks.fill_column(uint32_t(x), uint32_t(z), uint32_t(bottom), uint32_t(top), &element);
+	}
+
+	void Block::fill_slab(size_t bottom, size_t top, Element& element)
+	{
+		top = top < m_chunks.m_y ? top : m_chunks.m_y;
+		m_chunks.fill_box(uvec3(0U, uint32_t(bottom), 0U), uvec3(m_chunks.m_x, uint32_t(top), m_chunks.m_z), &element);
 	}
 
 	void Block::commit()
 	{
+		this->commit_chunks();
+		this->update_solids();
+	}
+
+	void Block::commit_chunks()
+	{
+		m_chunks.compact();
+		m_dirty_mesh = ~uint64_t(0);
+		m_dirty_solids = ~uint64_t(0);
 		m_updated++;
 		WorldPage& page = m_world_page;
 		page.m_updated++;
@@ -166,7 +205,7 @@ namespace toy
 
 	uvec3 Block::local_chunk_coord(size_t index)
 	{
-		return uvec3(uint(m_chunks.x(index)), uint(m_chunks.y(index)), uint(m_chunks.z(index)));
+		return m_chunks.coord(index);
 	}
 
 	uvec3 Block::chunk_coord(size_t index)
@@ -206,6 +245,8 @@ namespace toy
 		}
 
 		m_subdived = true;
+		m_active = false;
+		m_refined = true;
 		// "update" trick
 		spatial.set_position(spatial.m_position);
 	}
@@ -221,6 +262,79 @@ namespace toy
 		}
 	}
 
+	Block* Block::subblock(const uvec3& coord)
+	{
+		const size_t index = m_subblocks.index_at(coord.x, coord.y, coord.z);
+		for(HBlock& block : m_subblocks)
+			if(block && block->m_index == index)
+			{
+				Block& subblock = block;
+				return &subblock;
+			}
+		return nullptr;
+	}
+
+	Block* Block::neighbour_block(Side side)
+	{
+		if(!m_parentblock)
+			return m_neighbours[side];
+
+		const ivec3 coord = ivec3(m_parentblock->local_block_coord(m_index)) + ivec3(to_vec3(side));
+		if(coord.x >= 0 && coord.y >= 0 && coord.z >= 0 && coord.x < 2 && coord.y < 2 && coord.z < 2)
+			return m_parentblock->subblock(uvec3(coord));
+
+		Block* neighbour = m_parentblock->neighbour_block(side);
+		if(!neighbour || neighbour->m_depth != m_parentblock->m_depth || !neighbour->m_subdived)
+			return neighbour;
+
+		return neighbour->subblock(uvec3((coord + ivec3(2)) % ivec3(2)));
+	}
+
+	void Block::downsample()
+	{
+		if(!m_subdived)
+			return;
+
+		for(HBlock& block : m_subblocks)
+			if(block)
+				block->downsample();
+
+		const uint32_t half = m_chunks.m_x / 2;
+		Element* samples[8];
+
+		for(uint32_t z = 0; z < m_chunks.m_z; ++z)
+			for(uint32_t y = 0; y < m_chunks.m_y; ++y)
+				for(uint32_t x = 0; x < m_chunks.m_x; ++x)
+				{
+					Block* child = this->subblock(uvec3(x / half, y / half, z / half));
+					if(!child)
+						continue;
+
+					const uvec3 base = uvec3(x % half, y % half, z % half) * 2U;
+					for(uint32_t i = 0; i < 8; ++i)
+						samples[i] = child->m_chunks.at(base.x + (i & 1), base.y + ((i >> 1) & 1), base.z + (i >> 2));
+
+					// most frequent element of the group, an element wins the ties against an empty chunk
+					Element* element = nullptr;
+					uint32_t best = 0;
+					for(uint32_t i = 0; i < 8; ++i)
+					{
+						uint32_t count = 0;
+						for(uint32_t j = 0; j < 8; ++j)
+							count += samples[j] == samples[i] ? 1 : 0;
+						if(count > best || (count == best && element == nullptr))
+						{
+							element = samples[i];
+							best = count;
+						}
+					}
+
+					m_chunks.set(x, y, z, element);
+				}
+
+		this->commit();
+	}
+
 	Hunk Block::neighbour(size_t index, Side side)
 	{
 		if(m_chunks.border(index, side))
@@ -242,4 +356,174 @@ namespace toy
 	{
 		return this->neighbour(hunk.index, side);
 	}
+
+	bool Block::neighbour(size_t index, Side side, Element*& element)
+	{
+		if(m_chunks.border(index, side))
+		{
+			Block* neighbour = this->neighbour_block(side);
+			if(!neighbour)
+				return false;
+
+			// a coarser neighbour has no chunks facing this one : the face is closed
+			if(neighbour->m_depth != m_depth)
+			{
+				element = nullptr;
+				return true;
+			}
+
+			Voxels& chunks = neighbour->m_chunks;
+			element = chunks.get(chunks.neighbour_mod(index, side));
+		}
+		else
+			element = m_chunks.get(m_chunks.neighbour(index, side));
+		return true;
+	}
+
+	void Block::set_chunk(const uvec3& coord, Element* element)
+	{
+		m_chunks.set(coord.x, coord.y, coord.z, element);
+		this->edited(coord, coord + uvec3(1U));
+	}
+
+	void Block::clear_chunk(const uvec3& coord)
+	{
+		this->set_chunk(coord, nullptr);
+	}
+
+	void Block::paint_box(const uvec3& lo, const uvec3& hi, Element* element)
+	{
+		const uvec3 size = uvec3(m_chunks.m_x, m_chunks.m_y, m_chunks.m_z);
+		const uvec3 first = min(lo, size);
+		const uvec3 last = min(hi, size);
+
+		m_chunks.fill_box(first, last, element);
+		this->edited(first, last);
+	}
+
+	void Block::paint_sphere(const vec3& center, float radius, Element* element)
+	{
+		const vec3 size = vec3(float(m_chunks.m_x), float(m_chunks.m_y), float(m_chunks.m_z));
+		const uvec3 lo = uvec3(clamp(floor(center - radius), vec3(0.f), size));
+		const uvec3 hi = uvec3(clamp(ceil(center + radius), vec3(0.f), size));
+
+		for(uint32_t z = lo.z; z < hi.z; ++z)
+			for(uint32_t y = lo.y; y < hi.y; ++y)
+				for(uint32_t x = lo.x; x < hi.x; ++x)
+				{
+					// chunk centers inside the sphere
+					const vec3 offset = vec3(float(x), float(y), float(z)) + 0.5f - center;
+					if(dot(offset, offset) <= radius * radius)
+						m_chunks.set(x, y, z, element);
+				}
+
+		this->edited(lo, hi);
+	}
+
+	void Block::edited(const uvec3& lo, const uvec3& hi)
+	{
+		if(lo.x >= hi.x || lo.y >= hi.y || lo.z >= hi.z)
+			return;
+
+		// the faces of the chunks around the edit change too
+		const uvec3 size = uvec3(m_chunks.m_x, m_chunks.m_y, m_chunks.m_z);
+		const uvec3 first = uvec3(max(ivec3(lo) - ivec3(1), ivec3(0)));
+		const uvec3 last = min(hi + uvec3(1U), size);
+
+		const uint64_t sections = m_chunks.section_mask(first, last);
+		m_dirty_mesh |= sections;
+		m_dirty_solids |= sections;
+		m_updated++;
+
+		// an edit on the border changes the faces of the neighbour on that side
+		for(Side side : c_sides)
+		{
+			const ivec3 normal = ivec3(to_vec3(side));
+			const int d = normal.x != 0 ? 0 : normal.y != 0 ? 1 : 2;
+			const bool border = normal[d] > 0 ? hi[d] == size[d] : lo[d] == 0;
+			if(!border)
+				continue;
+
+			Block* neighbour = this->neighbour_block(side);
+			if(!neighbour || neighbour->m_depth != m_depth)
+				continue;
+
+			uvec3 facing_lo = first;
+			uvec3 facing_hi = last;
+			facing_lo[d] = normal[d] > 0 ? 0 : size[d] - 1;
+			facing_hi[d] = facing_lo[d] + 1;
+
+			const uint64_t facing = neighbour->m_chunks.section_mask(facing_lo, facing_hi);
+			neighbour->m_dirty_mesh |= facing;
+			neighbour->m_dirty_solids |= facing;
+			neighbour->m_updated++;
+			neighbour->update_solids();
+		}
+
+		this->update_solids();
+	}
+
+	void Block::update_solids()
+	{
+		vector<SolidSection> sections;
+		this->mesh_solids(sections);
+		this->submit_solids(sections);
+	}
+
+	void Block::mesh_solids(vector<SolidSection>& sections)
+	{
+		// only the blocks at the bottom of the octree collide
+		if(m_subdived)
+			return;
+
+		for(uint32_t section = 0; section < 64; ++section)
+		{
+			const uint64_t bit = uint64_t(1) << section;
+			if((m_dirty_solids & bit) == 0)
+				continue;
+
+			uvec3 lo, hi;
+			m_chunks.section_range(section, lo, hi);
+
+			map<Element*, vector<BlockQuad>> quads;
+			greedy_mesh(*this, lo, hi, quads);
+
+			vector<BlockQuad> solid;
+			for(auto& element_quads : quads)
+				if(element_quads.first->m_state == MatterState::Solid)
+					solid.insert(solid.end(), element_quads.second.begin(), element_quads.second.end());
+
+			// an empty section is only removed when it had a geometry
+			if(solid.empty() && (m_solid_sections & bit) == 0)
+				continue;
+
+			sections.push_back({ section, !solid.empty(), Geometry() });
+			if(!solid.empty())
+				block_geometry(solid, sections.back().m_geometry);
+		}
+	}
+
+	void Block::submit_solids(vector<SolidSection>& sections)
+	{
+		WorldPage& page = m_world_page;
+
+		if(m_subdived)
+		{
+			for(uint32_t section = 0; section < 64; ++section)
+				if(m_solid_sections & (uint64_t(1) << section))
+					page.update_section(this->section_key(section), m_spatial, Geometry());
+			m_solid_sections = 0;
+			m_dirty_solids = 0;
+			return;
+		}
+
+		for(SolidSection& section : sections)
+		{
+			const uint64_t bit = uint64_t(1) << section.m_section;
+			page.update_section(this->section_key(section.m_section), m_spatial, move(section.m_geometry));
+			m_solid_sections = section.m_solid ? m_solid_sections | bit : m_solid_sections & ~bit;
+		}
+
+		m_dirty_solids = 0;
+	}
 }
@@ -10,10 +10,13 @@
 #include <type/Proto.h>
 #include <math/Vec.h>
 #include <math/Grid.h>
+#include <geom/Geometry.h>
 #include <core/Spatial/Spatial.h>
 #include <core/Physic/Scope.h>
+#include <core/Physic/Collider.h>
 #include <block/Forward.h>
 #include <block/Handles.h>
+#include <block/Voxels.h>
 
 #ifdef TWO_META_GENERATOR
 namespace two
@@ -60,19 +63,67 @@ namespace toy
 
 		bool m_subdived = false;
 
-		vector2d<Element*> m_chunks;
+		// false while the block is drawn through its subblocks or through one of its parents
+		attr_ bool m_active = true;
+		// true while the block is drawn through its subblocks
+		bool m_refined = false;
+
+		Voxels m_chunks;
 		vector2d<HBlock> m_subblocks;
 
+		// sections of the chunks to mesh and to collide again, see Voxels::section_mask
+		uint64_t m_dirty_mesh = ~uint64_t(0);
+		uint64_t m_dirty_solids = ~uint64_t(0);
+		// sections with a solid geometry in the page : each one is cooked into its own solid by the page
+		uint64_t m_solid_sections = 0;
+
 		table<Side, Block*> m_neighbours = {};
 
 		meth_ void subdivide();
 
 		meth_ void reset();
 		meth_ void chunk(size_t x, size_t y, size_t z, Element& element);
+		// fills the chunks of column (x, z) from bottom up to top excluded
+		meth_ void fill_column(size_t x, size_t z, size_t bottom, size_t top, Element& element);
+		// fills the horizontal layers from bottom up to top excluded
+		meth_ void fill_slab(size_t bottom, size_t top, Element& element);
 		meth_ void commit();
+		// same as commit, without the solids : painting jobs commit the chunks of their block, the solids are meshed once all blocks are painted
+		void commit_chunks();
+
+		// edits : only the sections touched by the edit, and the sections facing it in the neighbours, are meshed and collided again
+		meth_ void set_chunk(const uvec3& coord, Element* element);
+		meth_ void clear_chunk(const uvec3& coord);
+		meth_ void paint_box(const uvec3& lo, const uvec3& hi, Element* element);
+		// center and radius in chunks, relative to the block corner
+		meth_ void paint_sphere(const vec3& center, float radius, Element* element);
+
+		void edited(const uvec3& lo, const uvec3& hi);
+		// geometry of a dirty section, empty when the section has no solid chunk
+		struct SolidSection
+		{
+			uint32_t m_section;
+			bool m_solid;
+			Geometry m_geometry;
+		};
+
+		// hands the geometry of the dirty sections to the page, which cooks them on a job
+		void update_solids();
+		// meshes the dirty sections on any thread : neither this block nor its neighbours may be edited meanwhile
+		void mesh_solids(vector<SolidSection>& sections);
+		// hands the meshed sections to the page, on the main thread
+		void submit_solids(vector<SolidSection>& sections);
+		uint64_t section_key(uint32_t section) const { return (uint64_t(m_spatial.m_handle) << 6) | section; }
 
 		void subdivide_to(uint16_t depth);
 
+		// fills the chunks of a subdivided block from its subblocks, one chunk out of each 2x2x2 group
+		meth_ void downsample();
+
+		Block* subblock(const uvec3& coord);
+		// block of the same depth on that side, or the coarser block covering it when the region is not subdivided as deep
+		Block* neighbour_block(Side side);
+
 		uint16_t depth();
 
 		vec3 min(Spatial& self);
@@ -95,6 +146,8 @@ namespace toy
 
 		Hunk neighbour(size_t index, Side side);
 		Hunk neighbour(Hunk& hunk, Side side);
+		// same as above without building a hunk, returns false when there is no neighbour
+		bool neighbour(size_t index, Side side, Element*& element);
 
 	protected:
 		//EmitterScope& m_scope;
@@ -0,0 +1,136 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#ifdef TWO_MODULES
+module toy.block
+#else
+#include <math/Grid.hpp>
+#include <ecs/ECS.hpp>
+#include <core/Spatial/Spatial.h>
+#include <block/Types.h>
+#include <block/BlockLod.h>
+#include <block/Block.h>
+#endif
+
+#include <cfloat>
+
+namespace toy
+{
+	BlockLod::BlockLod()
+	{}
+
+	size_t BlockLod::update(span<Block*> roots, span<vec3> viewers)
+	{
+		m_active.clear();
+		m_changed.clear();
+
+		for(Block* root : roots)
+			this->select(*root, viewers, true);
+
+		// the seams of the blocks touching a block that changed level are rebuilt
+		for(Block* changed : m_changed)
+		{
+			Spatial& spatial = changed->m_spatial;
+			const vec3 center = spatial.absolute_position();
+			const vec3 extent = changed->m_size / 2.f;
+
+			for(Block* active : m_active)
+			{
+				Spatial& other = active->m_spatial;
+				const vec3 gap = abs(other.absolute_position() - center) - (active->m_size / 2.f + extent);
+				if(gap.x <= 0.01f && gap.y <= 0.01f && gap.z <= 0.01f)
+				{
+					active->m_dirty_mesh |= this->seam(*active, center, extent, gap);
+					active->m_updated++;
+				}
+			}
+		}
+
+		return m_changed.size();
+	}
+
+	uint64_t BlockLod::seam(Block& block, const vec3& center, const vec3& extent, const vec3& gap) const
+	{
+		const uvec3 size = uvec3(block.m_chunks.m_x, block.m_chunks.m_y, block.m_chunks.m_z);
+		if(size.x == 0 || size.y == 0 || size.z == 0)
+			return 0;
+
+		Spatial& spatial = block.m_spatial;
+		const vec3 block_min = spatial.absolute_position() - block.m_size / 2.f;
+
+		// along the axes the blocks touch on, the layer of chunks on that border, along the others, the chunks facing the other block
+		uvec3 lo, hi;
+		for(int d = 0; d < 3; ++d)
+		{
+			if(gap[d] >= -0.01f)
+			{
+				const bool positive = center[d] > block_min[d] + block.m_size[d] / 2.f;
+				lo[d] = positive ? size[d] - 1 : 0;
+				hi[d] = lo[d] + 1;
+			}
+			else
+			{
+				const float scale = float(size[d]) / block.m_size[d];
+				const float first = (center[d] - extent[d] - block_min[d]) * scale;
+				const float last = (center[d] + extent[d] - block_min[d]) * scale;
+				lo[d] = uint32_t(clamp(floor(first), 0.f, float(size[d] - 1)));
+				hi[d] = uint32_t(clamp(ceil(last), float(lo[d] + 1), float(size[d])));
+			}
+		}
+
+		return block.m_chunks.section_mask(lo, hi);
+	}
+
+	float BlockLod::distance(Block& block, span<vec3> viewers) const
+	{
+		Spatial& spatial = block.m_spatial;
+		const vec3 center = spatial.absolute_position();
+		const vec3 extent = block.m_size / 2.f;
+
+		float nearest = FLT_MAX;
+		for(const vec3& viewer : viewers)
+		{
+			const vec3 outside = max(abs(viewer - center) - extent, vec3(0.f));
+			nearest = min(nearest, length(outside));
+		}
+		return nearest;
+	}
+
+	void BlockLod::select(Block& block, span<vec3> viewers, bool visible)
+	{
+		bool refine = false;
+		if(visible && block.m_subdived && block.m_depth < m_max_depth)
+		{
+			const float threshold = block.m_size.x * m_distance_factor * (block.m_refined ? m_hysteresis : 1.f);
+			refine = this->distance(block, viewers) < threshold;
+		}
+
+		this->activate(block, visible && !refine);
+
+		// the subblocks of a block that was not refined are all inactive already
+		const bool refined = block.m_refined;
+		block.m_refined = refine;
+
+		if(refine || refined)
+			for(HBlock& subblock : block.m_subblocks)
+				if(subblock)
+				{
+					Block& child = subblock;
+					this->select(child, viewers, refine);
+				}
+	}
+
+	void BlockLod::activate(Block& block, bool active)
+	{
+		if(block.m_active != active)
+		{
+			block.m_active = active;
+			m_changed.push_back(&block);
+		}
+
+		if(active)
+			m_active.push_back(&block);
+	}
+}
@@ -0,0 +1,46 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#pragma once
+
+#include <stl/vector.h>
+#include <stl/span.h>
+#include <math/Vec.h>
+#include <block/Forward.h>
+
+namespace toy
+{
+	/* Level of detail over subdivided block octrees :
+		- a block is refined into its subblocks while a viewer is closer than its size times the distance factor
+		- the selected blocks are active, all the others are inactive and not meshed
+		- coarse blocks are drawn from the chunks downsampled from their subblocks (Block::downsample)
+		- blocks touching a block that changed level are bumped, and the sections on their border facing it are meshed again
+	*/
+
+	class TOY_BLOCK_EXPORT BlockLod
+	{
+	public:
+		BlockLod();
+
+		float m_distance_factor = 2.f;
+		// a refined block is only merged back beyond the refine distance times this factor
+		float m_hysteresis = 1.25f;
+		uint16_t m_max_depth = 8;
+
+		vector<Block*> m_active;
+		vector<Block*> m_changed;
+
+		// selects the active blocks under each root, returns the number of blocks that changed state
+		size_t update(span<Block*> roots, span<vec3> viewers);
+
+		float distance(Block& block, span<vec3> viewers) const;
+		// sections of a block on its border facing another block, given the center and extent of the other block, and the gap between them
+		uint64_t seam(Block& block, const vec3& center, const vec3& extent, const vec3& gap) const;
+
+	private:
+		void select(Block& block, span<vec3> viewers, bool visible);
+		void activate(Block& block, bool active);
+	};
+}
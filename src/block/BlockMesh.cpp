@@ -0,0 +1,320 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#ifdef TWO_MODULES
+module toy.block
+#else
+#include <math/Grid.hpp>
+#include <geom/Shape/ProcShape.h>
+#include <geom/Shape/DrawShape.h>
+#include <geom/Shapes.h>
+#include <geom/Geometry.h>
+#include <block/Types.h>
+#include <block/BlockMesh.h>
+#include <block/Block.h>
+#endif
+
+namespace toy
+{
+	// axis of the side normal, followed by the two axes of the faces
+	static void side_axes(Side side, int& d, int& u, int& v)
+	{
+		const vec3 normal = to_vec3(side);
+		d = normal.x != 0.f ? 0 : normal.y != 0.f ? 1 : 2;
+		u = (d + 1) % 3;
+		v = (d + 2) % 3;
+	}
+
+	void snapshot_block(Block& block, BlockSnapshot& snapshot)
+	{
+		const Voxels& voxels = block.m_chunks;
+		snapshot.m_voxels = voxels;
+		snapshot.m_size = block.m_size;
+		snapshot.m_version = block.m_updated;
+
+		const uvec3 size = uvec3(voxels.m_x, voxels.m_y, voxels.m_z);
+
+		for(Side side : c_sides)
+		{
+			vector<Element*>& border = snapshot.m_borders[side];
+			border.clear();
+			snapshot.m_skirts[side] = false;
+
+			Block* neighbour = block.neighbour_block(side);
+			if(!neighbour)
+				continue;
+
+			if(neighbour->m_depth != block.m_depth || !neighbour->m_active)
+			{
+				snapshot.m_skirts[side] = true;
+				continue;
+			}
+
+			int d, u, v;
+			side_axes(side, d, u, v);
+			const bool positive = to_vec3(side)[d] > 0.f;
+
+			border.resize(size[u] * size[v]);
+
+			uvec3 coord;
+			coord[d] = positive ? 0 : size[d] - 1;
+			for(uint j = 0; j < size[v]; ++j)
+				for(uint i = 0; i < size[u]; ++i)
+				{
+					coord[u] = i;
+					coord[v] = j;
+					border[i + j * size[u]] = neighbour->m_chunks.at(coord.x, coord.y, coord.z);
+				}
+		}
+	}
+
+	bool BlockSnapshot::neighbour(size_t index, Side side, Element*& element) const
+	{
+		if(!m_voxels.border(index, side))
+		{
+			element = m_voxels.get(m_voxels.neighbour(index, side));
+			return true;
+		}
+
+		if(m_skirts[side])
+		{
+			element = nullptr;
+			return true;
+		}
+
+		const vector<Element*>& border = m_borders[side];
+		if(border.empty())
+			return false;
+
+		int d, u, v;
+		side_axes(side, d, u, v);
+
+		const uvec3 size = uvec3(m_voxels.m_x, m_voxels.m_y, m_voxels.m_z);
+		const uvec3 coord = m_voxels.coord(index);
+		element = border[coord[u] + coord[v] * size[u]];
+		return true;
+	}
+
+	// T_Source gives the neighbour of a chunk across the faces : a snapshot off the main thread, the block itself on it
+	template <class T_Source>
+	size_t greedy_mesh_range(T_Source& block, const Voxels& voxels, const vec3& extent, const uvec3& lo, const uvec3& hi, map<Element*, vector<BlockQuad>>& quads)
+	{
+		const uvec3 size = uvec3(voxels.m_x, voxels.m_y, voxels.m_z);
+		const vec3 chunk = extent / vec3(size);
+		const vec3 origin = -extent / 2.f;
+
+		// nothing to draw in an empty block
+		if(voxels.uniform() && voxels.get(0) == nullptr)
+			return 0;
+
+		size_t count = 0;
+		vector<Element*> mask;
+
+		for(Side side : c_sides)
+		{
+			const vec3 normal = to_vec3(side);
+			int d, u, v;
+			side_axes(side, d, u, v);
+			const bool positive = normal[d] > 0.f;
+
+			const uint width = hi[u] - lo[u];
+			const uint height = hi[v] - lo[v];
+			mask.resize(width * height);
+
+			for(uint s = lo[d]; s < hi[d]; ++s)
+			{
+				// exposed faces of this slice : a face is drawn where the neighbour chunk exists and is of another element
+				for(uint j = 0; j < height; ++j)
+					for(uint i = 0; i < width; ++i)
+					{
+						uvec3 coord;
+						coord[d] = s;
+						coord[u] = lo[u] + i;
+						coord[v] = lo[v] + j;
+
+						const size_t index = voxels.index_at(coord.x, coord.y, coord.z);
+						Element* element = voxels[index];
+						Element*& face = mask[i + j * width];
+						face = nullptr;
+
+						if(element == nullptr)
+							continue;
+
+						Element* neighbour = nullptr;
+						if(!block.neighbour(index, side, neighbour) || neighbour == element)
+							continue;
+
+						face = element;
+					}
+
+				// grow each face along u first, then along v as long as the whole row matches
+				for(uint j = 0; j < height; ++j)
+					for(uint i = 0; i < width;)
+					{
+						Element* element = mask[i + j * width];
+						if(element == nullptr)
+						{
+							++i;
+							continue;
+						}
+
+						uint w = 1;
+						while(i + w < width && mask[i + w + j * width] == element)
+							++w;
+
+						uint h = 1;
+						for(; j + h < height; ++h)
+						{
+							bool row = true;
+							for(uint k = 0; k < w && row; ++k)
+								row = mask[i + k + (j + h) * width] == element;
+							if(!row)
+								break;
+						}
+
+						for(uint y = 0; y < h; ++y)
+							for(uint x = 0; x < w; ++x)
+								mask[i + x + (j + y) * width] = nullptr;
+
+						BlockQuad quad;
+						quad.m_origin[d] = origin[d] + float(positive ? s + 1 : s) * chunk[d];
+						quad.m_origin[u] = origin[u] + float(lo[u] + i) * chunk[u];
+						quad.m_origin[v] = origin[v] + float(lo[v] + j) * chunk[v];
+						quad.m_normal = normal;
+
+						vec3 eu = vec3(0.f);
+						vec3 ev = vec3(0.f);
+						eu[u] = float(w) * chunk[u];
+						ev[v] = float(h) * chunk[v];
+
+						// u x v points along +d : swap them for the faces looking down the axis
+						quad.m_u = positive ? eu : ev;
+						quad.m_v = positive ? ev : eu;
+						quad.m_size = positive ? vec2(float(w), float(h)) : vec2(float(h), float(w));
+
+						quads[element].push_back(quad);
+						++count;
+
+						i += w;
+					}
+			}
+		}
+
+		return count;
+	}
+
+	size_t greedy_mesh(const BlockSnapshot& block, map<Element*, vector<BlockQuad>>& quads)
+	{
+		const Voxels& voxels = block.m_voxels;
+		return greedy_mesh_range(block, voxels, block.m_size, uvec3(0U), uvec3(voxels.m_x, voxels.m_y, voxels.m_z), quads);
+	}
+
+	size_t greedy_mesh(const BlockSnapshot& block, const uvec3& lo, const uvec3& hi, map<Element*, vector<BlockQuad>>& quads)
+	{
+		return greedy_mesh_range(block, block.m_voxels, block.m_size, lo, hi, quads);
+	}
+
+	size_t greedy_mesh(Block& block, const uvec3& lo, const uvec3& hi, map<Element*, vector<BlockQuad>>& quads)
+	{
+		return greedy_mesh_range(block, block.m_chunks, block.m_size, lo, hi, quads);
+	}
+
+	void block_geometry(span<BlockQuad> quads, Geometry& geometry)
+	{
+		const uint32_t count = uint32_t(quads.size());
+		geometry.allocate(count * 4U, count * 2U);
+
+		span<Vertex> vertices = geometry.vertices();
+		span<uint32_t> indices = geometry.indices();
+		MeshAdapter data(Vertex::vertex_format, { vertices.data(), uint32_t(vertices.size()) }, { indices.data(), uint32_t(indices.size()) }, true);
+
+		draw_block_quads(quads, Colour::White, data);
+	}
+
+	void draw_block_quads(span<BlockQuad> quads, const Colour& colour, MeshAdapter& writer)
+	{
+		uint32_t index = 0;
+		for(const BlockQuad& quad : quads)
+		{
+			const vec3 corners[4] = { quad.m_origin, quad.m_origin + quad.m_u, quad.m_origin + quad.m_u + quad.m_v, quad.m_origin + quad.m_v };
+			const vec2 uvs[4] = { vec2(0.f), vec2(quad.m_size.x, 0.f), quad.m_size, vec2(0.f, quad.m_size.y) };
+			const vec4 tangent = vec4(normalize(quad.m_u), 1.f);
+
+			for(size_t i = 0; i < 4; ++i)
+				writer.position(corners[i])
+					  .normal(quad.m_normal)
+					  .colour(colour)
+					  .tangent(tangent)
+					  .uv0(uvs[i]);
+
+			writer.tri(index, index + 1, index + 2);
+			writer.tri(index, index + 2, index + 3);
+			index += 4;
+		}
+	}
+
+	void draw_block_outlines(span<BlockQuad> quads, const Colour& colour, MeshAdapter& writer)
+	{
+		uint32_t index = 0;
+		for(const BlockQuad& quad : quads)
+		{
+			writer.position(quad.m_origin).colour(colour);
+			writer.position(quad.m_origin + quad.m_u).colour(colour);
+			writer.position(quad.m_origin + quad.m_u + quad.m_v).colour(colour);
+			writer.position(quad.m_origin + quad.m_v).colour(colour);
+
+			writer.line(index, index + 1);
+			writer.line(index + 1, index + 2);
+			writer.line(index + 2, index + 3);
+			writer.line(index + 3, index);
+			index += 4;
+		}
+	}
+
+	ShapeSize size_shape_lines(const ProcShape& shape, const BlockShape& block)
+	{
+		UNUSED(shape);
+		const uint32_t count = uint32_t(block.m_quads.size());
+		return { count * 4U, count * 8U };
+	}
+
+	void draw_shape_lines(const ProcShape& shape, const BlockShape& block, MeshAdapter& writer)
+	{
+		draw_block_outlines(block.m_quads, shape.m_symbol.m_outline, writer);
+	}
+
+	ShapeSize size_shape_triangles(const ProcShape& shape, const BlockShape& block)
+	{
+		UNUSED(shape);
+		const uint32_t count = uint32_t(block.m_quads.size());
+		return { count * 4U, count * 6U };
+	}
+
+	void draw_shape_triangles(const ProcShape& shape, const BlockShape& block, MeshAdapter& writer)
+	{
+		draw_block_quads(block.m_quads, shape.m_symbol.m_fill, writer);
+	}
+
+	struct BlockShapeDeclaration
+	{
+		BlockShapeDeclaration()
+		{
+			decl_shape<BlockShape>(DispatchDrawProcShape::me);
+		}
+	};
+
+	BlockShape::BlockShape()
+		: Shape(type<BlockShape>())
+	{
+		static BlockShapeDeclaration decl;
+	}
+
+	object<Shape> BlockShape::clone() const
+	{
+		object<BlockShape> shape = oconstruct<BlockShape>();
+		shape->m_quads = m_quads;
+		return shape;
+	}
+}
@@ -0,0 +1,72 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#pragma once
+
+#include <stl/vector.h>
+#include <stl/span.h>
+#include <stl/map.h>
+#include <math/Vec.h>
+#include <math/Colour.h>
+#include <geom/Shape/ProcShape.h>
+#include <block/Forward.h>
+#include <block/Voxels.h>
+
+namespace toy
+{
+	// a rectangle of coplanar faces of the same element, corners are origin, origin + u, origin + u + v, origin + v
+	struct BlockQuad
+	{
+		vec3 m_origin;
+		vec3 m_u;
+		vec3 m_v;
+		vec3 m_normal;
+		vec2 m_size;
+	};
+
+	// copy of the voxels of a block and of the neighbour slices touching it, so that it can be meshed away from the main thread
+	struct BlockSnapshot
+	{
+		Voxels m_voxels;
+		vec3 m_size = vec3(0.f);
+		size_t m_version = 0;
+
+		// neighbour slice on each side, indexed along the two other axes : empty when there is no neighbour
+		table<Side, vector<Element*>> m_borders = {};
+		// sides facing a block drawn at another level of detail : the border faces are always drawn so no crack opens
+		table<Side, bool> m_skirts = {};
+
+		bool neighbour(size_t index, Side side, Element*& element) const;
+	};
+
+	export_ TOY_BLOCK_EXPORT void snapshot_block(Block& block, BlockSnapshot& snapshot);
+
+	// merges the exposed faces of each slice of the block into maximal rectangles, returns the number of quads
+	export_ TOY_BLOCK_EXPORT size_t greedy_mesh(const BlockSnapshot& block, map<Element*, vector<BlockQuad>>& quads);
+	// same, restricted to the chunks in [lo, hi) : used to remesh the sections of a block touched by an edit
+	export_ TOY_BLOCK_EXPORT size_t greedy_mesh(const BlockSnapshot& block, const uvec3& lo, const uvec3& hi, map<Element*, vector<BlockQuad>>& quads);
+	export_ TOY_BLOCK_EXPORT size_t greedy_mesh(Block& block, const uvec3& lo, const uvec3& hi, map<Element*, vector<BlockQuad>>& quads);
+
+	export_ TOY_BLOCK_EXPORT void block_geometry(span<BlockQuad> quads, Geometry& geometry);
+
+	export_ TOY_BLOCK_EXPORT void draw_block_quads(span<BlockQuad> quads, const Colour& colour, MeshAdapter& writer);
+	export_ TOY_BLOCK_EXPORT void draw_block_outlines(span<BlockQuad> quads, const Colour& colour, MeshAdapter& writer);
+
+	class refl_ TOY_BLOCK_EXPORT BlockShape : public Shape
+	{
+	public:
+		constr_ BlockShape();
+
+		vector<BlockQuad> m_quads;
+
+		virtual object<Shape> clone() const;
+	};
+
+	export_ TOY_BLOCK_EXPORT ShapeSize size_shape_lines(const ProcShape& shape, const BlockShape& block);
+	export_ TOY_BLOCK_EXPORT void draw_shape_lines(const ProcShape& shape, const BlockShape& block, MeshAdapter& writer);
+
+	export_ TOY_BLOCK_EXPORT ShapeSize size_shape_triangles(const ProcShape& shape, const BlockShape& block);
+	export_ TOY_BLOCK_EXPORT void draw_shape_triangles(const ProcShape& shape, const BlockShape& block, MeshAdapter& writer);
+}
@@ -27,7 +27,21 @@ namespace toy
 		: m_name(name)
 		, m_state(state)
 		, m_colour(colour)
-	{}
+	{
+		m_id = uint32_t(registry().size());
+		registry().push_back(this);
+	}
+
+	vector<Element*>& Element::registry()
+	{
+		static vector<Element*> elements = { nullptr };
+		return elements;
+	}
+
+	Element* Element::find(uint32_t id)
+	{
+		return id < registry().size() ? registry()[id] : nullptr;
+	}
 
 	Entity Heap::create(ECS& ecs, HSpatial parent, const vec3& position, Element& element, float radius)
 	{
@@ -34,6 +34,10 @@ namespace toy
 		attr_ string m_name;
 		attr_ MatterState m_state;
 		attr_ Colour m_colour;
+
+		// every element constructed, indexed by id : id 0 stands for no element
+		static vector<Element*>& registry();
+		static Element* find(uint32_t id);
 	};
 
 	class refl_ TOY_BLOCK_EXPORT Heap
@@ -22,6 +22,10 @@ namespace toy
     
     struct Hunk;
     class Block;
+    class BlockLod;
+    struct BlockQuad;
+    struct BlockSnapshot;
+    class BlockShape;
     class Chunk;
     class Element;
     class Heap;
@@ -36,8 +40,18 @@ namespace toy
     class Fungus;
     class Water;
     class Sector;
+    struct BlockGrid;
+    struct WaveRules;
+    struct WaveConstraint;
+    class TileWave;
+    struct TileblockSolve;
+    struct TileBatch;
     class Tileblock;
+    struct BlockMeshTask;
     struct BlockState;
+    class Voxels;
+    struct VoxelRay;
+    struct VoxelHit;
 }
 
 #ifdef TWO_META_GENERATOR
@@ -7,18 +7,29 @@
 module toy.block
 #else
 #include <math/Grid.hpp>
+#include <math/Math.h>
 #include <geom/Shapes.h>
 #include <ecs/Complex.h>
 #include <ecs/ECS.hpp>
+#include <jobs/JobLoop.hpp>
+#include <gfx/Model.h>
+#include <gfx/GfxSystem.h>
 #include <core/Spatial/Spatial.h>
 #include <core/World/World.hpp>
 #include <core/World/Section.h>
+#include <core/World/Snapshot.hpp>
+#include <core/Asset/AssetQueue.h>
+#include <core/WorldPage/PageCache.h>
 #include <block/Types.h>
 #include <block/Sector.h>
 #include <block/Element.h>
 #include <block/Block.h>
+#include <block/Chunk.h>
 #endif
 
+#include <cstdio>
+#include <algorithm>
+
 namespace toy
 {
 	Entity Sector::create(ECS& ecs, HSpatial parent, const vec3& position, const uvec3& coordinate, const vec3& size)
@@ -41,27 +52,6 @@ namespace toy
 		, m_heaps()
 	{}
 
-	struct BlockGrid
-	{
-		BlockGrid(const uvec3& grid_subdiv, const uvec3& block_subdiv, const vec3& cell_size)
-			: m_subdiv(grid_subdiv), m_block_subdiv(block_subdiv), m_cell_size(cell_size)
-		{}
-
-		attr_ uvec3 m_subdiv;
-		attr_ uvec3 m_block_subdiv;
-		attr_ vec3 m_cell_size;
-
-		attr_ vec3 m_sector_size;
-		attr_ vec3 m_world_size;
-		attr_ vec3 m_center_offset;
-
-		attr_ vector<Element*> m_elements;
-
-		attr_ vector<Sector*> m_sectors;
-		attr_ vector2d<Block*> m_blocks;
-
-	};
-
 	void block_grid(World& world, BlockGrid& grid, const uvec3& grid_subdiv, const uvec3& block_subdiv, const vec3& cell_size)
 	{
 		grid.m_sector_size = vec3(block_subdiv) * cell_size;
@@ -89,6 +79,84 @@ namespace toy
 		index_blocks(grid_subdiv, grid.m_blocks, blocks, grid.m_sectors);
 	}
 
+	struct PaintGridHeight
+	{
+		span<Sector*> m_sectors;
+		span<Image256> m_heights;
+		Element* m_element;
+
+		inline void operator()(JobSystem& js, Job* job, uint32_t start, uint32_t count) const
+		{
+			UNUSED(js); UNUSED(job);
+			for(uint32_t index = start; index < start + count; ++index)
+			{
+				paint_block_height(*m_sectors[index]->m_block, m_heights[index], *m_element);
+				m_sectors[index]->m_block->commit_chunks();
+			}
+		}
+	};
+
+	struct PaintGridElements
+	{
+		span<Sector*> m_sectors;
+		span<Image256> m_images;
+		span<Element*> m_elements;
+
+		inline void operator()(JobSystem& js, Job* job, uint32_t start, uint32_t count) const
+		{
+			UNUSED(js); UNUSED(job);
+			for(uint32_t index = start; index < start + count; ++index)
+			{
+				paint_block_elements(*m_sectors[index]->m_block, m_images[index], m_elements);
+				m_sectors[index]->m_block->commit_chunks();
+			}
+		}
+	};
+
+	struct MeshGridSolids
+	{
+		span<Sector*> m_sectors;
+		span<vector<Block::SolidSection>> m_solids;
+
+		inline void operator()(JobSystem& js, Job* job, uint32_t start, uint32_t count) const
+		{
+			UNUSED(js); UNUSED(job);
+			for(uint32_t index = start; index < start + count; ++index)
+				m_sectors[index]->m_block->mesh_solids(m_solids[index]);
+		}
+	};
+
+	// meshing reads the border chunks of the neighbours : it starts once every block is painted, and only the geometry is handed to the pages on the calling thread
+	static void update_grid_solids(JobSystem& job_system, BlockGrid& grid)
+	{
+		vector<vector<Block::SolidSection>> solids(grid.m_sectors.size());
+		MeshGridSolids mesh = { grid.m_sectors, solids };
+		Job* job = split_jobs<1>(job_system, nullptr, 0, uint32_t(grid.m_sectors.size()), mesh);
+		job_system.complete(job);
+
+		for(size_t index = 0; index < grid.m_sectors.size(); ++index)
+			grid.m_sectors[index]->m_block->submit_solids(solids[index]);
+	}
+
+	void paint_grid_height(JobSystem& job_system, BlockGrid& grid, span<Image256> heights, Element& element)
+	{
+		// blocks only write their own chunks : they are painted and committed in parallel
+		PaintGridHeight paint = { grid.m_sectors, heights, &element };
+		Job* job = split_jobs<1>(job_system, nullptr, 0, uint32_t(grid.m_sectors.size()), paint);
+		job_system.complete(job);
+
+		update_grid_solids(job_system, grid);
+	}
+
+	void paint_grid_elements(JobSystem& job_system, BlockGrid& grid, span<Image256> images, span<Element*> elements)
+	{
+		PaintGridElements paint = { grid.m_sectors, images, elements };
+		Job* job = split_jobs<1>(job_system, nullptr, 0, uint32_t(grid.m_sectors.size()), paint);
+		job_system.complete(job);
+
+		update_grid_solids(job_system, grid);
+	}
+
 	Entity Tileblock::create(ECS& ecs, HSpatial parent, const vec3& position, const uvec3& size, const vec3& tile_scale, WaveTileset& tileset)
 	{
 		Entity entity = ecs.create<Spatial, WorldPage, Navblock, Tileblock>();
@@ -104,22 +172,90 @@ namespace toy
 		, m_world_page(world_page)
 		, m_navblock(navblock)
 		, m_wfc_block(spatial->m_position, size, period, tileset)
+		, m_rules(tileset_rules(tileset))
+	{}
+
+	Tileblock::~Tileblock()
+	{}
+
+	void Tileblock::set_tile(const uvec3& coord, uint16_t tile)
 	{
-		//m_spatial.m_world.add_task(this, short(Task::Background));
+		m_constraints.push_back({ coord, tile });
+		m_wfc_block.m_wave.set_tile(coord, tile);
 	}
 
-	Tileblock::~Tileblock()
+	// the solution only depends on the seed of the block, so a block solves the same on a job or not
+	static void solve_tiles(TileblockSolve& solve)
 	{
-		//m_spatial.m_world.remove_task(this, short(Task::Background));
+		static const uint32_t max_attempts = 8;
+
+		TileWave& wave = solve.m_wave;
+		for(uint32_t attempt = 0; attempt < max_attempts; ++attempt)
+		{
+			wave.reset(*solve.m_rules, solve.m_size, false, uint64_t(solve.m_seed) + attempt);
+			if(!wave.constrain(solve.m_constraints))
+				continue;
+
+			while(wave.step() == TileWave::Unsolved)
+				solve.m_steps++;
+
+			if(wave.m_state == TileWave::Solved)
+				return;
+		}
+	}
+
+	// the wave of the block finds every cell collapsed : stepping it has nothing left to search
+	static void impose_tiles(WfcBlock& block, const TileWave& wave)
+	{
+		for(uint z = 0; z < wave.m_size.z; ++z) for(uint y = 0; y < wave.m_size.y; ++y) for(uint x = 0; x < wave.m_size.x; ++x)
+			block.m_wave.set_tile({ x, y, z }, wave.tile({ x, y, z }));
+		block.m_wave.propagate();
 	}
 
 	void Tileblock::next_frame(WorldPage& world_page, size_t frame, size_t delta)
 	{
-		m_wfc_block.next_frame(frame, delta);
+		World& world = *m_spatial->m_world;
+
+		const bool ready = m_wfc_block.m_auto_solve && !m_wfc_block.m_wave.m_solved;
+		if(ready && m_rules && !m_stepped && !m_solve)
+		{
+			m_solve = std::make_shared<TileblockSolve>();
+			m_solve->m_rules = m_rules;
+			m_solve->m_size = uvec3(uint(m_wfc_block.m_tiles.m_x), uint(m_wfc_block.m_tiles.m_y), uint(m_wfc_block.m_tiles.m_z));
+			m_solve->m_constraints = m_constraints;
+			m_solve->m_seed = m_seed;
+
+			// the world owns the job in flight : the tileblock can be destroyed at any time
+			TileblockSolve* solve = m_solve.get();
+			world.m_tasks.run(m_background ? &world.m_job_system : nullptr, m_solve, [solve]() { solve_tiles(*solve); });
+		}
+
+		if(m_solve)
+		{
+			m_solve_steps = m_solve->m_steps;
+			if(!m_solve->m_done)
+				return;
+
+			if(m_solve->m_wave.m_state == TileWave::Solved)
+				impose_tiles(m_wfc_block, m_solve->m_wave);
+			else
+				printf("[warning] Tileblock wave has no solution, solving it step by step\n");
+
+			m_stepped = true;
+			m_solve = nullptr;
+		}
+
+		// without rules, the wave of the block is solved step by step, one step per frame, as is what is left after the tiles are imposed
+		if(ready && (!m_rules || m_stepped))
+		{
+			m_wfc_block.next_frame(frame, delta);
+			if(m_wfc_block.m_wave.m_solved)
+				m_wfc_block.m_wave_solved = frame;
+		}
 
 		world_page.m_updated = m_wfc_block.m_wave_solved;
 
-		if(m_wfc_block.m_wave.m_solved && !m_setup)
+		if(m_wfc_block.m_wave.m_solved && !m_setup && (!m_models || m_models->ready()))
 			m_setup = true;
 	}
 
@@ -129,10 +265,19 @@ namespace toy
 		return !outside;
 	}
 
+	uint32_t tileblock_seed(const ivec2& coord, uint32_t world_seed)
+	{
+		uint32_t hash = world_seed ^ 2166136261U;
+		hash = (hash ^ uint32_t(coord.x)) * 16777619U;
+		hash = (hash ^ uint32_t(coord.y)) * 16777619U;
+		return hash;
+	}
+
 	HTileblock generate_block(GfxSystem& gfx, WaveTileset& tileset, HSpatial origin, const ivec2& coord, const uvec3& block_subdiv, const vec3& tile_scale, bool from_file)
 	{
 		vec3 position = vec3(to_xz(coord)) * vec3(block_subdiv) * tile_scale;
 		HTileblock block = construct<Tileblock>(origin, position, block_subdiv, tile_scale, tileset);
+		block->m_seed = tileblock_seed(coord);
 
 		if(block->m_wfc_block.m_tile_models.empty())
 			block->m_wfc_block.load_models(gfx, from_file);
@@ -140,49 +285,201 @@ namespace toy
 		return block;
 	}
 
+	// tile models of a tileset, loaded once for all the blocks using it
+	struct TileModels
+	{
+		vector<string> m_names;
+		vector<string> m_paths;
+		size_t m_imported = 0;
+	};
+
+	static std::shared_ptr<AssetLoad> load_tile_models(AssetQueue& assets, GfxSystem& gfx, WaveTileset& tileset)
+	{
+		std::shared_ptr<TileModels> models = std::make_shared<TileModels>();
+		for(Tile& tile : tileset.m_tiles_flip)
+		{
+			const string name = tileset.m_name + "/" + tile.m_name;
+			if(std::find(models->m_names.begin(), models->m_names.end(), name) == models->m_names.end())
+				models->m_names.push_back(name);
+		}
+
+		// the files are looked up along the resource paths on the job
+		GfxSystem* system = &gfx;
+		auto load = [models, system]() -> bool
+		{
+			for(const string& name : models->m_names)
+			{
+				LocatedFile location = system->locate_file("models/" + name, system->models().m_formats);
+				if(!location)
+				{
+					printf("[warning] Tile model %s not found\n", name.c_str());
+					return false;
+				}
+				models->m_paths.push_back(location.path(false));
+			}
+			return true;
+		};
+
+		// the importers create the meshes as they read them : a few models per update, so that a tileset doesn't stall a frame
+		auto publish = [models, system]() -> bool
+		{
+			const size_t end = min(models->m_imported + 4, models->m_names.size());
+			for(; models->m_imported < end; ++models->m_imported)
+				if(!system->models().get(models->m_names[models->m_imported].c_str()))
+					system->models().file_at(models->m_paths[models->m_imported], models->m_names[models->m_imported]);
+			return models->m_imported == models->m_names.size();
+		};
+
+		return assets.load("tileset/" + tileset.m_name, load, publish);
+	}
+
+	HTileblock generate_block(AssetQueue& assets, GfxSystem& gfx, WaveTileset& tileset, HSpatial origin, const ivec2& coord, const uvec3& block_subdiv, const vec3& tile_scale, bool from_file)
+	{
+		vec3 position = vec3(to_xz(coord)) * vec3(block_subdiv) * tile_scale;
+		HTileblock block = construct<Tileblock>(origin, position, block_subdiv, tile_scale, tileset);
+		block->m_seed = tileblock_seed(coord);
+
+		// the models are imported once by the load shared by the blocks of the tileset, each block then only finds them in the store
+		// the block holds the only handle to its own load, so it is cancelled if the block is destroyed first
+		if(block->m_wfc_block.m_tile_models.empty())
+		{
+			std::shared_ptr<AssetLoad> models = from_file ? load_tile_models(assets, gfx, tileset) : nullptr;
+			GfxSystem* system = &gfx;
+			auto publish = [block, system, models, from_file]() -> bool
+			{
+				if(models && !models->done())
+					return false;
+				block->m_wfc_block.load_models(*system, from_file);
+				return true;
+			};
+			block->m_models = assets.load("", nullptr, publish);
+		}
+
+		return block;
+	}
+
 	void build_block_geometry(Scene& scene, WorldPage& page, Tileblock& block)
 	{
 		UNUSED(scene);
 
 		WfcBlock& tileblock = block.m_wfc_block;
 
-		vector<Cube> cubes;
-		vector<ProcShape> shapes;
-		cubes.reserve(tileblock.m_tiles.size());
+		auto model_at = [&](size_t x, size_t y, size_t z) -> uint16_t
+		{
+			uint16_t index = tileblock.m_tiles.at(x, y, z);
+			if(index == UINT16_MAX || index >= tileblock.m_tile_models.size() || !tileblock.m_tile_models[index].m_model)
+				return UINT16_MAX;
+			return index;
+		};
 
+		// count the tiles of each model first, so that each model gets a contiguous range of transforms
+		vector<uint32_t> counts(tileblock.m_tile_models.size(), 0U);
 		for(size_t x = 0; x < tileblock.m_tiles.m_x; ++x) for(size_t y = 0; y < tileblock.m_tiles.m_y; ++y) for(size_t z = 0; z < tileblock.m_tiles.m_z; ++z)
 		{
-			uint16_t index = tileblock.m_tiles.at(x, y, z);
+			uint16_t model = model_at(x, y, z);
+			if(model != UINT16_MAX)
+				counts[model]++;
+		}
 
-			if(index != UINT16_MAX)
+		// one collision shape per model, shared by all the tiles of that model
+		CompoundShape compound;
+		vector<uint32_t> batches(counts.size(), UINT32_MAX);
+
+		block.m_batches.clear();
+		uint32_t first = 0;
+		for(size_t model = 0; model < counts.size(); ++model)
+			if(counts[model] > 0)
 			{
-				TileModel& tile = tileblock.m_tile_models[index];
-				if(tile.m_model)
-				{
-					vec3 position = tileblock.to_position({ uint(x), uint(y), uint(z) }) - tileblock.m_position + y3 * 0.5f * tileblock.m_scale;
-					cubes.push_back({ position, tileblock.m_scale / 2.f });
-					shapes.push_back({ Symbol(), &cubes.back(), PLAIN });
-				}
+				batches[model] = uint32_t(block.m_batches.size());
+				block.m_batches.push_back({ uint16_t(model), first, 0U });
+				compound.m_shapes.push_back(CollisionShape(Cube(tileblock.m_scale / 2.f), y3 * 0.5f * tileblock.m_scale));
+				first += counts[model];
 			}
+
+		block.m_transforms.resize(first);
+		compound.m_children.reserve(first);
+
+		for(size_t x = 0; x < tileblock.m_tiles.m_x; ++x) for(size_t y = 0; y < tileblock.m_tiles.m_y; ++y) for(size_t z = 0; z < tileblock.m_tiles.m_z; ++z)
+		{
+			uint16_t model = model_at(x, y, z);
+			if(model == UINT16_MAX)
+				continue;
+
+			const vec3 position = tileblock.to_position({ uint(x), uint(y), uint(z) });
+
+			// the tilesets only hold the unrotated variant of each model : the profile of the wave tile is its number of quarter turns
+			const Tile& tile = tileblock.m_tileset->m_tiles_flip[tileblock.m_tiles.at(x, y, z)];
+			const quat rotation = angle_axis(-c_pi / 2.f * float(tile.m_profile), y3);
+
+			TileBatch& batch = block.m_batches[batches[model]];
+			block.m_transforms[batch.m_first + batch.m_count++] = bxTRS(tileblock.m_scale, rotation, position);
+			compound.add(batches[model], position - tileblock.m_position, rotation);
 		}
 
-		page.m_chunks.emplace_back();
-		Geometry& geometry = page.m_chunks.back();
+		page.m_instances.clear();
+		page.m_instances.push_back(move(compound));
+	}
 
-		ShapeSize size;
-		for(const ProcShape& shape : shapes)
-			size.vec += symbol_triangle_size(shape).vec;
+	void save_tiles(Tileblock& block, vector<uint8_t>& data)
+	{
+		WfcBlock& tileblock = block.m_wfc_block;
+		const uvec3 size = uvec3(uint(tileblock.m_tiles.m_x), uint(tileblock.m_tiles.m_y), uint(tileblock.m_tiles.m_z));
 
-		geometry.allocate(size.vertex_count, size.index_count);
+		PageWriter writer = { data };
+		writer.value(size);
+		for(uint z = 0; z < size.z; ++z) for(uint y = 0; y < size.y; ++y) for(uint x = 0; x < size.x; ++x)
+			writer.value(uint16_t(tileblock.m_tiles.at(x, y, z)));
+	}
 
-		span<Vertex> vertices = geometry.vertices();
-		span<uint32_t> indices = geometry.indices();
-		MeshAdapter data(Vertex::vertex_format, { vertices.data(), vertices.size() }, { indices.data(), indices.size() }, true);
+	bool load_tiles(Tileblock& block, const vector<uint8_t>& data)
+	{
+		WfcBlock& tileblock = block.m_wfc_block;
+		const uvec3 size = uvec3(uint(tileblock.m_tiles.m_x), uint(tileblock.m_tiles.m_y), uint(tileblock.m_tiles.m_z));
 
-		for(const ProcShape& shape : shapes)
+		PageReader reader = { data.data(), data.size() };
+		uvec3 stored = uvec3(0U);
+		if(!reader.value(stored) || stored != size || data.size() != sizeof(uvec3) + size_t(size.x) * size.y * size.z * sizeof(uint16_t))
+			return false;
+
+		const size_t num_tiles = block.m_rules ? block.m_rules->m_num_tiles : SIZE_MAX;
+
+		// the tiles are all imposed before solving : the solver finds them collapsed, there is nothing left to search
+		vector<WaveConstraint> constraints;
+		for(uint z = 0; z < size.z; ++z) for(uint y = 0; y < size.y; ++y) for(uint x = 0; x < size.x; ++x)
 		{
-			symbol_draw_triangles(shape, data);
-			data.next();
+			uint16_t tile = UINT16_MAX;
+			reader.value(tile);
+			if(tile == UINT16_MAX || tile >= num_tiles)
+				return false;
+			constraints.push_back({ uvec3(x, y, z), tile });
 		}
+
+		for(const WaveConstraint& constraint : constraints)
+			block.set_tile(constraint.m_coord, constraint.m_tile);
+		tileblock.m_wave.propagate();
+
+		block.m_cached = true;
+		return true;
+	}
+
+	void block_snapshot(WorldSnapshot& snapshot)
+	{
+		snapshot.component<Sector>();
+		snapshot.component<Tileblock>();
+		snapshot.component<Block>();
+		snapshot.component<Chunk>();
+		snapshot.component<Heap>();
+
+		snapshot.handle<HSector>();
+		snapshot.handle<HTileblock>();
+		snapshot.handle<HBlock>();
+		snapshot.handle<HChunk>();
+		snapshot.handle<HHeap>();
+
+		snapshot.archetype<Spatial, WorldPage, Navblock, Sector>();
+		snapshot.archetype<Spatial, WorldPage, Navblock, Tileblock>();
+		snapshot.archetype<Spatial, Block>();
+		snapshot.archetype<Spatial, Chunk>();
+		snapshot.archetype<Spatial, Heap>();
 	}
 }
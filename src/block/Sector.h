@@ -6,15 +6,21 @@
 #pragma once
 
 #include <stl/vector.h>
+#include <stl/span.h>
 #include <stl/function.h>
 #include <type/Proto.h>
 #include <wfc-gfx/Tileblock.h>
 #include <core/WorldPage/WorldPage.h>
+#include <core/World/JobTasks.h>
 //#include <core/WorldPage/BufferPage.h>
 #include <core/Navmesh/Navmesh.h>
 #include <block/Forward.h>
 #include <block/Element.h>
 #include <block/Structs.h>
+#include <block/TileWave.h>
+
+#include <atomic>
+#include <memory>
 
 namespace toy
 {
@@ -40,6 +46,25 @@ namespace toy
 		vector<Heap*> m_heaps;
 	};
 
+	// wave of a tileblock solved on a background job : the job solves its own bitset wave, the tiles are imposed on the block on the main thread
+	struct TileblockSolve : public JobTask
+	{
+		TileWave m_wave;
+		const WaveRules* m_rules = nullptr;
+		uvec3 m_size = uvec3(0U);
+		vector<WaveConstraint> m_constraints;
+		uint32_t m_seed = 0;
+		std::atomic<size_t> m_steps = { 0 };
+	};
+
+	// a range of tiles of the same model in Tileblock::m_transforms, drawn as one instance batch
+	struct TileBatch
+	{
+		uint16_t m_model;
+		uint32_t m_first;
+		uint32_t m_count;
+	};
+
 	class refl_ TOY_BLOCK_EXPORT Tileblock
 	{
 	public:
@@ -57,16 +82,82 @@ namespace toy
 		attr_ bool m_setup = false;
 		attr_ bool m_populated = false;
 
+		// the same seed gives the same solution, whether the wave is solved in the background or not
+		attr_ uint32_t m_seed = 0;
+		attr_ bool m_background = true;
+
 		function<void(Tileblock&)> m_on_setup;
 
+		// rules of the tileset, and the tiles imposed before solving : both are replayed by the bitset solver
+		const WaveRules* m_rules = nullptr;
+		vector<WaveConstraint> m_constraints;
+
+		void set_tile(const uvec3& coord, uint16_t tile);
+
+		// the block keeps its wave while the tiles are solved in the background, the progress is published here
+		std::shared_ptr<TileblockSolve> m_solve;
+		size_t m_solve_steps = 0;
+		// the wave of the block is stepped : its tiles are imposed, or the bitset wave had no solution
+		bool m_stepped = false;
+
+		bool solving() const { return m_solve != nullptr; }
+
+		// tile models loaded between frames : the block solves meanwhile, and is only set up once they are in
+		std::shared_ptr<AssetLoad> m_models;
+
+		// tiles restored from a page cache, the wave only propagates them
+		bool m_cached = false;
+
+		// tiles of the solved wave grouped by tile model, transforms are in world space
+		vector<TileBatch> m_batches;
+		vector<mat4> m_transforms;
+
 		void next_frame(WorldPage& world_page, size_t frame, size_t delta);
 
 		bool contains(const vec3& position);
 	};
 
+	TOY_BLOCK_EXPORT uint32_t tileblock_seed(const ivec2& coord, uint32_t world_seed = 0);
+
 	TOY_BLOCK_EXPORT func_ HTileblock generate_block(GfxSystem& gfx, WaveTileset& tileset, HSpatial origin, const ivec2& coord, const uvec3& block_subdiv, const vec3& tile_scale, bool from_file = true);
+	// the tile models are loaded by the asset queue instead of right away
+	TOY_BLOCK_EXPORT HTileblock generate_block(AssetQueue& assets, GfxSystem& gfx, WaveTileset& tileset, HSpatial origin, const ivec2& coord, const uvec3& block_subdiv, const vec3& tile_scale, bool from_file = true);
 
 	TOY_BLOCK_EXPORT func_ void build_block_geometry(Scene& scene, WorldPage& page, Tileblock& block);
 
+	// tiles of a solved tileblock, as stored in a page cache
+	TOY_BLOCK_EXPORT void save_tiles(Tileblock& block, vector<uint8_t>& data);
+	// imposes the stored tiles on the wave of the block, false when they don't fit the block
+	TOY_BLOCK_EXPORT bool load_tiles(Tileblock& block, const vector<uint8_t>& data);
+
+	// components, handles and archetypes of the block module
+	TOY_BLOCK_EXPORT void block_snapshot(WorldSnapshot& snapshot);
+
+	struct TOY_BLOCK_EXPORT BlockGrid
+	{
+		BlockGrid(const uvec3& grid_subdiv, const uvec3& block_subdiv, const vec3& cell_size)
+			: m_subdiv(grid_subdiv), m_block_subdiv(block_subdiv), m_cell_size(cell_size)
+		{}
+
+		attr_ uvec3 m_subdiv;
+		attr_ uvec3 m_block_subdiv;
+		attr_ vec3 m_cell_size;
+
+		attr_ vec3 m_sector_size;
+		attr_ vec3 m_world_size;
+		attr_ vec3 m_center_offset;
+
+		attr_ vector<Element*> m_elements;
+
+		attr_ vector<Sector*> m_sectors;
+		attr_ vector2d<Block*> m_blocks;
+	};
+
+	TOY_BLOCK_EXPORT void block_grid(World& world, BlockGrid& grid, const uvec3& grid_subdiv, const uvec3& block_subdiv, const vec3& cell_size);
+
+	// heights and images are given per sector, in the order of BlockGrid::m_sectors
+	TOY_BLOCK_EXPORT void paint_grid_height(JobSystem& job_system, BlockGrid& grid, span<Image256> heights, Element& element);
+	TOY_BLOCK_EXPORT void paint_grid_elements(JobSystem& job_system, BlockGrid& grid, span<Image256> images, span<Element*> elements);
+
 	TOY_BLOCK_EXPORT func_ void index_blocks(const uvec3& grid_size, vector2d<Block*>& grid, span<Block*> blocks, span<Sector*> sectors);
 }
@@ -0,0 +1,431 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#ifdef TWO_MODULES
+module toy.block
+#else
+#include <stl/map.h>
+#include <wfc-gfx/Tileblock.h>
+#include <block/Types.h>
+#include <block/TileWave.h>
+#endif
+
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace toy
+{
+	const ivec3 c_wave_directions[6] = { ivec3(1, 0, 0), ivec3(-1, 0, 0), ivec3(0, 1, 0), ivec3(0, -1, 0), ivec3(0, 0, 1), ivec3(0, 0, -1) };
+
+	static inline uint32_t lowest_bit(uint64_t word)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, word);
+		return uint32_t(index);
+#else
+		return uint32_t(__builtin_ctzll(word));
+#endif
+	}
+
+	bool wave_rules(const WaveTileset& tileset, WaveRules& rules)
+	{
+		const uint32_t num_tiles = uint32_t(tileset.m_num_tiles);
+		rules.m_valid = false;
+		rules.m_num_tiles = num_tiles;
+		rules.m_words = (num_tiles + 63) / 64;
+
+		if(num_tiles == 0 || num_tiles != tileset.m_tiles_flip.size() || tileset.m_weights.size() < num_tiles)
+		{
+			printf("[warning] Tileset %s has %u tiles, %zu variants and %zu weights : its waves are solved step by step\n",
+				   tileset.m_name.c_str(), num_tiles, tileset.m_tiles_flip.size(), tileset.m_weights.size());
+			return false;
+		}
+
+		rules.m_weights.resize(num_tiles);
+		rules.m_weight_logs.resize(num_tiles);
+		for(uint32_t tile = 0; tile < num_tiles; ++tile)
+		{
+			const float weight = float(tileset.m_weights[tile]);
+			rules.m_weights[tile] = weight;
+			rules.m_weight_logs[tile] = weight > 0.f ? weight * std::log(weight) : 0.f;
+		}
+
+		rules.m_masks.assign(6 * size_t(num_tiles) * rules.m_words, 0);
+		for(uint32_t direction = 0; direction < 6; ++direction)
+			for(uint32_t tile = 0; tile < num_tiles; ++tile)
+			{
+				uint64_t* mask = &rules.m_masks[(size_t(direction) * num_tiles + tile) * rules.m_words];
+				for(uint32_t other = 0; other < num_tiles; ++other)
+					if(tileset.m_propagator.at(direction, tile, other))
+						mask[other / 64] |= uint64_t(1) << (other % 64);
+			}
+
+		// a tile allows another one on one side only if that one allows it on the other side : this only holds when the propagator is indexed in the order of c_wave_directions
+		for(uint32_t direction = 0; direction < 6; ++direction)
+			for(uint32_t tile = 0; tile < num_tiles; ++tile)
+				for(uint32_t other = 0; other < num_tiles; ++other)
+				{
+					const bool allowed = (rules.mask(direction, tile)[other / 64] >> (other % 64)) & 1;
+					const bool opposite = (rules.mask(direction ^ 1, other)[tile / 64] >> (tile % 64)) & 1;
+					if(allowed != opposite)
+					{
+						printf("[warning] Tileset %s propagator is not symmetric in direction %u : its waves are solved step by step\n", tileset.m_name.c_str(), direction);
+						return false;
+					}
+				}
+
+		rules.m_valid = true;
+		return true;
+	}
+
+	const WaveRules* tileset_rules(const WaveTileset& tileset)
+	{
+		static map<const WaveTileset*, WaveRules> rules;
+		auto it = rules.find(&tileset);
+		if(it == rules.end())
+		{
+			it = rules.insert({ &tileset, WaveRules() }).first;
+			wave_rules(tileset, it->second);
+		}
+		return it->second.m_valid ? &it->second : nullptr;
+	}
+
+	void TileWave::reset(const WaveRules& rules, const uvec3& size, bool periodic, uint64_t seed)
+	{
+		m_rules = &rules;
+		m_words = rules.m_words;
+		m_size = size;
+		m_periodic = periodic;
+		m_state = Unsolved;
+		m_random = seed;
+
+		const uint32_t num_tiles = rules.m_num_tiles;
+		const uint32_t count = size.x * size.y * size.z;
+
+		float sum_weights = 0.f;
+		float sum_weight_logs = 0.f;
+		for(uint32_t tile = 0; tile < num_tiles; ++tile)
+		{
+			sum_weights += rules.m_weights[tile];
+			sum_weight_logs += rules.m_weight_logs[tile];
+		}
+
+		m_cells.assign(size_t(count) * m_words, ~uint64_t(0));
+		if(num_tiles % 64 != 0)
+			for(uint32_t index = 0; index < count; ++index)
+				this->cell(index)[m_words - 1] = (uint64_t(1) << (num_tiles % 64)) - 1;
+
+		m_counts.assign(count, uint16_t(num_tiles));
+		m_sum_weights.assign(count, sum_weights);
+		m_sum_weight_logs.assign(count, sum_weight_logs);
+
+		// a tiny noise per cell breaks the ties between cells of equal entropy
+		m_noise.resize(count);
+		m_entropies.resize(count);
+		for(uint32_t index = 0; index < count; ++index)
+		{
+			m_noise[index] = this->random() * 1e-4f;
+			this->update_entropy(index);
+		}
+
+		m_heap.clear();
+		m_heap_pos.assign(count, UINT32_MAX);
+		if(num_tiles > 1)
+		{
+			m_heap.resize(count);
+			for(uint32_t index = 0; index < count; ++index)
+			{
+				m_heap[index] = index;
+				m_heap_pos[index] = index;
+			}
+			for(uint32_t pos = count / 2; pos-- > 0;)
+				this->heap_down(pos);
+		}
+
+		m_stack.clear();
+		m_stack.reserve(count);
+		m_queued.assign(count, 0);
+		m_support.resize(m_words);
+
+		if(num_tiles == 0)
+			m_state = Contradiction;
+	}
+
+	bool TileWave::set_tile(const uvec3& coord, uint16_t tile)
+	{
+		WaveConstraint constraint = { coord, tile };
+		return this->constrain({ &constraint, 1 });
+	}
+
+	bool TileWave::constrain(span<WaveConstraint> constraints)
+	{
+		for(const WaveConstraint& constraint : constraints)
+		{
+			const uvec3& coord = constraint.m_coord;
+			if(constraint.m_tile >= m_rules->m_num_tiles || coord.x >= m_size.x || coord.y >= m_size.y || coord.z >= m_size.z)
+			{
+				printf("[ERROR] TileWave constraint out of range, tile %u\n", uint32_t(constraint.m_tile));
+				continue;
+			}
+
+			const uint32_t index = coord.x + (coord.y + coord.z * m_size.y) * m_size.x;
+
+			std::fill(m_support.begin(), m_support.end(), 0);
+			m_support[constraint.m_tile / 64] = uint64_t(1) << (constraint.m_tile % 64);
+			this->restrict_cell(index, m_support.data());
+		}
+
+		return this->propagate();
+	}
+
+	TileWave::State TileWave::step()
+	{
+		if(m_state != Unsolved)
+			return m_state;
+
+		if(m_heap.empty())
+			return m_state = Solved;
+
+		const uint32_t index = m_heap[0];
+		const uint32_t tile = this->pick(index);
+
+		std::fill(m_support.begin(), m_support.end(), 0);
+		m_support[tile / 64] = uint64_t(1) << (tile % 64);
+		this->restrict_cell(index, m_support.data());
+
+		if(this->propagate() && m_heap.empty())
+			m_state = Solved;
+		return m_state;
+	}
+
+	TileWave::State TileWave::solve(size_t max_steps)
+	{
+		for(size_t step = 0; step < max_steps && m_state == Unsolved; ++step)
+			this->step();
+		return m_state;
+	}
+
+	uint16_t TileWave::tile(const uvec3& coord) const
+	{
+		const uint32_t index = coord.x + (coord.y + coord.z * m_size.y) * m_size.x;
+		if(m_counts[index] != 1)
+			return UINT16_MAX;
+
+		const uint64_t* bits = this->cell(index);
+		for(uint32_t word = 0; word < m_words; ++word)
+			if(bits[word])
+				return uint16_t(word * 64 + lowest_bit(bits[word]));
+		return UINT16_MAX;
+	}
+
+	bool TileWave::neighbour(uint32_t index, uint32_t direction, uint32_t& result) const
+	{
+		const ivec3 size = ivec3(m_size);
+		ivec3 coord = ivec3(int(index % m_size.x), int((index / m_size.x) % m_size.y), int(index / (m_size.x * m_size.y)));
+		coord += c_wave_directions[direction];
+
+		if(m_periodic)
+			coord = (coord + size) % size;
+		else if(coord.x < 0 || coord.y < 0 || coord.z < 0 || coord.x >= size.x || coord.y >= size.y || coord.z >= size.z)
+			return false;
+
+		result = uint32_t(coord.x + (coord.y + coord.z * size.y) * size.x);
+		return true;
+	}
+
+	bool TileWave::restrict_cell(uint32_t index, const uint64_t* allowed)
+	{
+		uint64_t* bits = this->cell(index);
+		uint32_t count = m_counts[index];
+		float sum_weights = m_sum_weights[index];
+		float sum_weight_logs = m_sum_weight_logs[index];
+
+		bool changed = false;
+		for(uint32_t word = 0; word < m_words; ++word)
+		{
+			uint64_t removed = bits[word] & ~allowed[word];
+			if(!removed)
+				continue;
+
+			changed = true;
+			bits[word] &= allowed[word];
+
+			for(; removed; removed &= removed - 1)
+			{
+				const uint32_t tile = word * 64 + lowest_bit(removed);
+				sum_weights -= m_rules->m_weights[tile];
+				sum_weight_logs -= m_rules->m_weight_logs[tile];
+				--count;
+			}
+		}
+
+		if(!changed)
+			return false;
+
+		m_counts[index] = uint16_t(count);
+		m_sum_weights[index] = sum_weights;
+		m_sum_weight_logs[index] = sum_weight_logs;
+
+		if(count <= 1)
+		{
+			this->heap_remove(index);
+			if(count == 0)
+				m_state = Contradiction;
+		}
+		else if(m_heap_pos[index] != UINT32_MAX)
+		{
+			// removing a dominant tile can raise the entropy : the cell can move either way
+			this->update_entropy(index);
+			this->heap_up(m_heap_pos[index]);
+			this->heap_down(m_heap_pos[index]);
+		}
+
+		if(!m_queued[index])
+		{
+			m_queued[index] = 1;
+			m_stack.push_back(index);
+		}
+		return true;
+	}
+
+	bool TileWave::propagate()
+	{
+		while(!m_stack.empty() && m_state != Contradiction)
+		{
+			const uint32_t index = m_stack.back();
+			m_stack.pop_back();
+			m_queued[index] = 0;
+
+			const uint64_t* bits = this->cell(index);
+
+			for(uint32_t direction = 0; direction < 6; ++direction)
+			{
+				uint32_t neighbour;
+				if(!this->neighbour(index, direction, neighbour))
+					continue;
+
+				// tiles allowed in the neighbour : union of the masks of the tiles left in this cell
+				std::fill(m_support.begin(), m_support.end(), 0);
+				for(uint32_t word = 0; word < m_words; ++word)
+					for(uint64_t tiles = bits[word]; tiles; tiles &= tiles - 1)
+					{
+						const uint64_t* mask = m_rules->mask(direction, word * 64 + lowest_bit(tiles));
+						for(uint32_t i = 0; i < m_words; ++i)
+							m_support[i] |= mask[i];
+					}
+
+				this->restrict_cell(neighbour, m_support.data());
+				if(m_state == Contradiction)
+					break;
+			}
+		}
+
+		if(m_state == Contradiction)
+		{
+			for(uint32_t index : m_stack)
+				m_queued[index] = 0;
+			m_stack.clear();
+			return false;
+		}
+		return true;
+	}
+
+	uint32_t TileWave::pick(uint32_t index)
+	{
+		const uint64_t* bits = this->cell(index);
+		const float threshold = this->random() * m_sum_weights[index];
+
+		float sum = 0.f;
+		uint32_t last = 0;
+		for(uint32_t word = 0; word < m_words; ++word)
+			for(uint64_t tiles = bits[word]; tiles; tiles &= tiles - 1)
+			{
+				last = word * 64 + lowest_bit(tiles);
+				sum += m_rules->m_weights[last];
+				if(threshold < sum)
+					return last;
+			}
+		return last;
+	}
+
+	// splitmix64 : the sequence only depends on the seed, unlike the standard distributions
+	float TileWave::random()
+	{
+		uint64_t z = (m_random += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		z = z ^ (z >> 31);
+		return float(z >> 40) * (1.f / 16777216.f);
+	}
+
+	void TileWave::update_entropy(uint32_t index)
+	{
+		const float sum = m_sum_weights[index];
+		const float entropy = sum > 0.f ? std::log(sum) - m_sum_weight_logs[index] / sum : 0.f;
+		m_entropies[index] = entropy + m_noise[index];
+	}
+
+	void TileWave::heap_up(uint32_t pos)
+	{
+		const uint32_t index = m_heap[pos];
+		while(pos > 0)
+		{
+			const uint32_t parent = (pos - 1) / 2;
+			if(!this->less(index, m_heap[parent]))
+				break;
+			m_heap[pos] = m_heap[parent];
+			m_heap_pos[m_heap[pos]] = pos;
+			pos = parent;
+		}
+		m_heap[pos] = index;
+		m_heap_pos[index] = pos;
+	}
+
+	void TileWave::heap_down(uint32_t pos)
+	{
+		const uint32_t size = uint32_t(m_heap.size());
+		const uint32_t index = m_heap[pos];
+		while(true)
+		{
+			uint32_t child = pos * 2 + 1;
+			if(child >= size)
+				break;
+			if(child + 1 < size && this->less(m_heap[child + 1], m_heap[child]))
+				++child;
+			if(!this->less(m_heap[child], index))
+				break;
+			m_heap[pos] = m_heap[child];
+			m_heap_pos[m_heap[pos]] = pos;
+			pos = child;
+		}
+		m_heap[pos] = index;
+		m_heap_pos[index] = pos;
+	}
+
+	void TileWave::heap_remove(uint32_t index)
+	{
+		const uint32_t pos = m_heap_pos[index];
+		if(pos == UINT32_MAX)
+			return;
+
+		const uint32_t last = m_heap.back();
+		m_heap.pop_back();
+		m_heap_pos[index] = UINT32_MAX;
+
+		if(pos < m_heap.size())
+		{
+			m_heap[pos] = last;
+			m_heap_pos[last] = pos;
+			this->heap_up(pos);
+			this->heap_down(m_heap_pos[last]);
+		}
+	}
+}
@@ -0,0 +1,108 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#pragma once
+
+#include <stl/vector.h>
+#include <stl/span.h>
+#include <math/Vec.h>
+#include <block/Forward.h>
+
+#include <stdint.h>
+
+namespace toy
+{
+	// the 6 directions of the wave : +x, -x, +y, -y, +z, -z, the opposite of a direction is direction ^ 1
+	export_ TOY_BLOCK_EXPORT extern const ivec3 c_wave_directions[6];
+
+	// compatibility of a tileset, computed once : for each direction and each tile, the bitset of the tiles allowed next to it
+	struct TOY_BLOCK_EXPORT WaveRules
+	{
+		// false when the tileset doesn't have the layout the rules are read with : its blocks are solved by their own wave
+		bool m_valid = false;
+		uint32_t m_num_tiles = 0;
+		uint32_t m_words = 0;
+		vector<float> m_weights;
+		vector<float> m_weight_logs;
+		vector<uint64_t> m_masks;
+
+		inline const uint64_t* mask(uint32_t direction, uint32_t tile) const { return &m_masks[(size_t(direction) * m_num_tiles + tile) * m_words]; }
+	};
+
+	// reads the weights and the propagator of the tileset, the one its own wave is solved with, and checks their layout
+	export_ TOY_BLOCK_EXPORT bool wave_rules(const WaveTileset& tileset, WaveRules& rules);
+	// rules of a tileset, built on first use and cached, null when they're not valid : must be called from the main thread
+	export_ TOY_BLOCK_EXPORT const WaveRules* tileset_rules(const WaveTileset& tileset);
+
+	struct WaveConstraint
+	{
+		uvec3 m_coord;
+		uint16_t m_tile;
+	};
+
+	/* Bitset wave function collapse solver :
+		- each cell holds the bitset of the tiles it can still be, along with its weight sums for the entropy
+		- the next cell to observe is the top of an indexed min heap on entropy, updated in place as cells shrink
+		- changed cells are propagated from a fixed stack, nothing is allocated after reset()
+		- the random sequence is owned by the wave, the same seed gives the same solution on every platform
+	*/
+
+	class TOY_BLOCK_EXPORT TileWave
+	{
+	public:
+		enum State : uint8_t { Unsolved, Solved, Contradiction };
+
+		void reset(const WaveRules& rules, const uvec3& size, bool periodic, uint64_t seed);
+
+		// restricts a cell to a single tile and propagates, false on contradiction
+		bool set_tile(const uvec3& coord, uint16_t tile);
+		bool constrain(span<WaveConstraint> constraints);
+
+		// observes the cell of lowest entropy and propagates
+		State step();
+		State solve(size_t max_steps = SIZE_MAX);
+
+		// tile of a collapsed cell, UINT16_MAX otherwise
+		uint16_t tile(const uvec3& coord) const;
+
+		uvec3 m_size = uvec3(0U);
+		bool m_periodic = false;
+		State m_state = Unsolved;
+
+	private:
+		inline uint64_t* cell(uint32_t index) { return &m_cells[size_t(index) * m_words]; }
+		inline const uint64_t* cell(uint32_t index) const { return &m_cells[size_t(index) * m_words]; }
+
+		bool neighbour(uint32_t index, uint32_t direction, uint32_t& result) const;
+		bool restrict_cell(uint32_t index, const uint64_t* allowed);
+		bool propagate();
+		uint32_t pick(uint32_t index);
+		float random();
+
+		void update_entropy(uint32_t index);
+		inline bool less(uint32_t a, uint32_t b) const { return m_entropies[a] < m_entropies[b] || (m_entropies[a] == m_entropies[b] && a < b); }
+		void heap_up(uint32_t pos);
+		void heap_down(uint32_t pos);
+		void heap_remove(uint32_t index);
+
+		const WaveRules* m_rules = nullptr;
+		uint32_t m_words = 0;
+		uint64_t m_random = 0;
+
+		vector<uint64_t> m_cells;
+		vector<uint16_t> m_counts;
+		vector<float> m_sum_weights;
+		vector<float> m_sum_weight_logs;
+		vector<float> m_noise;
+		vector<float> m_entropies;
+
+		vector<uint32_t> m_heap;
+		vector<uint32_t> m_heap_pos;
+
+		vector<uint32_t> m_stack;
+		vector<uint8_t> m_queued;
+		vector<uint64_t> m_support;
+	};
+}
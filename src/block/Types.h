@@ -36,6 +36,7 @@ namespace two
     export_ template <> TOY_BLOCK_EXPORT Type& type<two::ComponentHandle<toy::Tileblock>>();
     export_ template <> TOY_BLOCK_EXPORT Type& type<two::vector2d<toy::Block*>>();
     export_ template <> TOY_BLOCK_EXPORT Type& type<toy::Block>();
+    export_ template <> TOY_BLOCK_EXPORT Type& type<toy::BlockShape>();
     export_ template <> TOY_BLOCK_EXPORT Type& type<toy::Chunk>();
     export_ template <> TOY_BLOCK_EXPORT Type& type<toy::Element>();
     export_ template <> TOY_BLOCK_EXPORT Type& type<toy::Heap>();
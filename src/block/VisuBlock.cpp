@@ -20,15 +20,18 @@ module toy.block
 #include <gfx/GfxSystem.h>
 #include <gfx/Draw.h>
 #include <gfx/Gfx.h>
+#include <jobs/JobSystem.h>
 #include <core/Spatial/Spatial.h>
+#include <core/World/World.h>
 #include <block/VisuBlock.h>
 #include <block/Block.h>
 #include <block/Element.h>
 #include <block/Sector.h>
 #include <block/Elements.h>
+#include <block/BlockMesh.h>
 #endif
 
-#include <cstdio>
+#include <algorithm>
 
 #define DEBUG_BLOCK 0
 #define BLOCK_WIREFRAME 1
@@ -49,14 +52,11 @@ namespace toy
 		gfx::shape(parent, Cube(size), Symbol(Colour(1.f, 1.f, 1.f, 0.2f)));
 #endif
 		BlockState& state = parent.state<BlockState>();
-		if(state.m_updated < block.m_updated)
-		{
-			state.m_updated = block.m_updated;
-			update_block_geometry(parent.m_scene->m_gfx, block, state);
-		}
+		update_block_geometry(parent.m_scene->m_gfx, block, state, BLOCK_WIREFRAME);
 
-		for(auto& element_model : state.m_models)
-			gfx::item(parent, *element_model.second, ItemFlag::Default | ItemFlag::Static | ItemFlag::Selectable, material);
+		for(auto& section : state.m_models)
+			for(auto& element_model : section)
+				gfx::item(parent, *element_model.second, ItemFlag::Default | ItemFlag::Static | ItemFlag::Selectable, material);
 	}
 
 	Material& plain_material(GfxSystem& gfx, cstring name)
@@ -87,67 +87,54 @@ namespace toy
 		paint_block(parent, block, &material);
 	}
 
-	void voxel_side(Block& block, size_t chunk, Element* element, Side side, vector<Quad>& quads, vector<ProcShape>& shapes)
+	void paint_tileblock(Gnode& parent, Tileblock& block)
 	{
-		SignedAxis axis = SignedAxis(side);
-		Quad quad = { to_xz(block.chunk_size()), c_dirs_tangents[axis], c_dirs_normals[axis] };
-		quad.m_center = block.chunk_position(chunk) + to_vec3(side) * block.chunk_size() / 2.f;
-
-		quads.push_back(quad);
-		shapes.push_back({ Symbol(), &quads.back(), OUTLINE });
-		shapes.push_back({ Symbol(element->m_colour), &quads.back(), PLAIN });
+		WfcBlock& tileblock = block.m_wfc_block;
+		for(const TileBatch& batch : block.m_batches)
+		{
+			Model& model = *tileblock.m_tile_models[batch.m_model].m_model;
+			Item& item = gfx::item(parent, model, ItemFlag::Default | ItemFlag::NoUpdate);
+			gfx::instances(parent, item, { block.m_transforms.data() + batch.m_first, batch.m_count });
+		}
 	}
 
-	void update_block_geometry(GfxSystem& gfx, Block& block, BlockState& state)
+	static void mesh_block_sections(BlockMeshTask& task)
 	{
-		UNUSED(gfx);
-
-		//Spatial& spatial = block.m_spatial;
-		WorldPage& world_page = block.m_world_page;
-
-		if(block.m_subdived)
-			return;
-
-		vector<Quad> quads;
-		//quads.reserve(block.m_chunks.size() * 6 / 2);
-		quads.reserve(block.m_chunks.size() * 6 / 2 * 16);
+		const Voxels& voxels = task.m_snapshot.m_voxels;
+		task.m_quads.resize(64);
 
-		state.m_models.clear();
-
-		map<Element*, vector<ProcShape>> bodies;
-
-		vector<Element*> elements = { &Earth::me, &Stone::me, &Sand::me, &Air::me, &Gas::me, &Minerals::me, &Fungus::me, &Water::me };
-
-		size_t index = 0;
-		for(Element* element : block.m_chunks)
-		{
-			if(element == nullptr /*|| element->matterState() != STATE_SOLID*/)
+		for(uint32_t section = 0; section < 64; ++section)
+			if(task.m_sections & (uint64_t(1) << section))
 			{
-				++index;
-				continue;
+				uvec3 lo, hi;
+				voxels.section_range(section, lo, hi);
+				greedy_mesh(task.m_snapshot, lo, hi, task.m_quads[section]);
 			}
+	}
 
-			for(Side side : c_sides)
-			{
-				Hunk neighbour = block.neighbour(index, side);
-
-				if(!neighbour || neighbour.element == element)
-					continue;
+	static void update_block_models(Block& block, BlockState& state, uint32_t section, map<Element*, vector<BlockQuad>>& quads, bool outline)
+	{
+		map<Element*, object<Model>>& models = state.m_models[section];
+		models.clear();
 
-				voxel_side(block, index, element, side, quads, bodies[element]);
-			}
+		vector<Element*> elements = { &Earth::me, &Stone::me, &Sand::me, &Air::me, &Gas::me, &Minerals::me, &Fungus::me, &Water::me };
 
-			++index;
-		}
+		BlockShape shape;
 
 		for(Element* element : elements)
-			if(!bodies[element].empty())
+			if(!quads[element].empty())
 			{
-				string identifier = "sector_" + to_string(block.m_index) + "_" + element->m_name;
+				string identifier = "sector_" + to_string(block.m_index) + "_" + to_string(section) + "_" + element->m_name;
 
-				printf("[info] Creating geometry for Block %s, %zu quads\n", identifier.c_str(), bodies[element].size());
+				// one shape per element : the quads are written straight into the mesh
+				shape.m_quads = move(quads[element]);
 
-				state.m_models[element] = gen_model(identifier.c_str(), bodies[element], true);
+				vector<ProcShape> shapes;
+				if(outline)
+					shapes.push_back({ Symbol(), &shape, OUTLINE });
+				shapes.push_back({ Symbol(element->m_colour), &shape, PLAIN });
+
+				models[element] = gen_model(identifier.c_str(), shapes, true);
 
 				/*
 				Material& plain = gfx.fetch_material(element->m_name.c_str(), "pbr/pbr");
@@ -157,10 +144,49 @@ namespace toy
 				state.m_models[element]->m_meshes[0]->m_material = &wireframe;
 				state.m_models[element]->m_meshes[1]->m_material = &wireframe;
 				*/
-
-				world_page.m_geometry_filter.push_back(identifier); // @kludge : find out a more intelligent way to filter world geometry
 			}
+	}
+
+	void update_block_geometry(GfxSystem& gfx, Block& block, BlockState& state, bool outline)
+	{
+		// inactive blocks are drawn through their subblocks or a parent : their models go until they are selected again
+		if(!block.m_active)
+		{
+			state.m_models.clear();
+			state.m_task = nullptr;
+			state.m_updated = 0;
+			return;
+		}
+
+		// one job per block at a time : a newer version is submitted once the current one landed
+		if(!state.m_task && state.m_updated < block.m_updated)
+		{
+			std::shared_ptr<BlockMeshTask> task = std::make_shared<BlockMeshTask>();
+			snapshot_block(block, task->m_snapshot);
+			task->m_sections = state.m_models.empty() ? ~uint64_t(0) : block.m_dirty_mesh;
+			block.m_dirty_mesh = 0;
+			state.m_task = task;
+
+			// the world owns the job in flight : the block state can drop the task at any time
+			BlockMeshTask* data = task.get();
+			block.m_spatial->m_world->m_tasks.run(gfx.m_job_system, task, [data]() { mesh_block_sections(*data); });
+		}
 
-		//as<WorldPage>(block.sector()).update_geometry();
+		// the last models stay on screen until the job lands, results older than them are dropped
+		if(state.m_task && state.m_task->m_done)
+		{
+			BlockMeshTask& task = *state.m_task;
+			if(task.m_snapshot.m_version > state.m_updated)
+			{
+				state.m_updated = task.m_snapshot.m_version;
+				state.m_models.resize(64);
+				for(uint32_t section = 0; section < 64; ++section)
+					if(task.m_sections & (uint64_t(1) << section))
+						update_block_models(block, state, section, task.m_quads[section], outline);
+			}
+			else
+				block.m_dirty_mesh |= task.m_sections;
+			state.m_task = nullptr;
+		}
 	}
 }
@@ -9,10 +9,15 @@
 #include <visu/VisuScene.h>
 #include <block/Forward.h>
 #include <block/Block.h>
+#include <block/BlockMesh.h>
+#include <core/World/JobTasks.h>
 
 #include <gfx/Node3.h>
 #include <gfx/Light.h>
 
+#include <atomic>
+#include <memory>
+
 namespace toy
 {
 	export_ TOY_BLOCK_EXPORT void paint_heap(Gnode& parent, Heap& heap);
@@ -20,11 +25,25 @@ namespace toy
 	export_ TOY_BLOCK_EXPORT void paint_block(Gnode& parent, Block& block);
 	export_ TOY_BLOCK_EXPORT void paint_block_wireframe(Gnode& parent, Block& block, const Colour& colour);
 
+	// draws the tiles of a tileblock built by build_block_geometry, one instance batch per tile model
+	export_ TOY_BLOCK_EXPORT void paint_tileblock(Gnode& parent, Tileblock& block);
+
+	// meshing job of the dirty sections of a block, the quads are tagged with the block version of the snapshot
+	struct BlockMeshTask : public JobTask
+	{
+		BlockSnapshot m_snapshot;
+		uint64_t m_sections = 0;
+		vector<map<Element*, vector<BlockQuad>>> m_quads;
+	};
+
 	struct BlockState : public NodeState
 	{
+		// version of the models on screen, they are kept until a more recent job lands
 		size_t m_updated = 0;
-		map<Element*, object<Model>> m_models;
+		// models of each section, only the dirty sections are meshed and built again
+		vector<map<Element*, object<Model>>> m_models;
+		std::shared_ptr<BlockMeshTask> m_task;
 	};
 
-	export_ TOY_BLOCK_EXPORT void update_block_geometry(GfxSystem& gfx, Block& block, BlockState& state);
+	export_ TOY_BLOCK_EXPORT void update_block_geometry(GfxSystem& gfx, Block& block, BlockState& state, bool outline = true);
 }
@@ -0,0 +1,262 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#ifdef TWO_MODULES
+module toy.block
+#else
+#include <math/Grid.hpp>
+#include <ecs/ECS.hpp>
+#include <jobs/JobLoop.hpp>
+#include <core/Spatial/Spatial.h>
+#include <block/Types.h>
+#include <block/VoxelQuery.h>
+#include <block/Block.h>
+#include <block/Element.h>
+#include <block/Sector.h>
+#endif
+
+#include <cfloat>
+#include <utility>
+
+namespace toy
+{
+	static inline bool solid(Element* element)
+	{
+		return element != nullptr && element->m_state == MatterState::Solid;
+	}
+
+	static Side side_of(int axis, int step)
+	{
+		for(Side side : c_sides)
+			if(to_vec3(side)[axis] == float(step))
+				return side;
+		return Side::Right;
+	}
+
+	static vec3 block_min(Block& block)
+	{
+		Spatial& spatial = block.m_spatial;
+		return block.min(spatial);
+	}
+
+	Block* grid_block_at(BlockGrid& grid, const vec3& position)
+	{
+		const vec3 local = (position + grid.m_center_offset) / grid.m_sector_size;
+		if(local.x < 0.f || local.y < 0.f || local.z < 0.f)
+			return nullptr;
+
+		const uvec3 coord = uvec3(floor(local));
+		if(coord.x >= grid.m_subdiv.x || coord.y >= grid.m_subdiv.y || coord.z >= grid.m_subdiv.z)
+			return nullptr;
+
+		return grid.m_blocks.at(coord.x, coord.y, coord.z);
+	}
+
+	// clips the segment against the grid bounds, in fractions of the segment
+	static bool clip_grid(BlockGrid& grid, const vec3& from, const vec3& to, float& t0, float& t1)
+	{
+		const vec3 lo = -grid.m_center_offset;
+		const vec3 hi = lo + grid.m_world_size;
+		const vec3 delta = to - from;
+
+		t0 = 0.f;
+		t1 = 1.f;
+		for(int axis = 0; axis < 3; ++axis)
+		{
+			if(delta[axis] == 0.f)
+			{
+				if(from[axis] < lo[axis] || from[axis] > hi[axis])
+					return false;
+				continue;
+			}
+
+			float near = (lo[axis] - from[axis]) / delta[axis];
+			float far = (hi[axis] - from[axis]) / delta[axis];
+			if(near > far)
+				std::swap(near, far);
+			t0 = max(t0, near);
+			t1 = min(t1, far);
+		}
+		return t0 <= t1;
+	}
+
+	bool voxel_raycast(BlockGrid& grid, const vec3& from, const vec3& to, VoxelHit& hit)
+	{
+		hit = VoxelHit();
+
+		float t0, t1;
+		if(!clip_grid(grid, from, to, t0, t1))
+			return false;
+
+		const vec3 delta_world = to - from;
+		const vec3 entry = from + delta_world * t0;
+
+		// nudge the entry point inside the grid, a point ray only tests the chunk it is in
+		const vec3 nudge = delta_world == vec3(0.f) ? vec3(0.f) : normalize(delta_world) * 0.0001f;
+		Block* block = grid_block_at(grid, entry + nudge);
+		if(!block)
+			return false;
+
+		const uvec3 usize = uvec3(block->m_chunks.m_x, block->m_chunks.m_y, block->m_chunks.m_z);
+		const ivec3 size = ivec3(usize);
+		const vec3 chunk = block->chunk_size();
+
+		// everything below is in chunk units, relative to the current block corner
+		const vec3 start = (entry - block_min(*block)) / chunk;
+		const vec3 delta = delta_world / chunk;
+
+		ivec3 cell = clamp(ivec3(floor(start)), ivec3(0), size - ivec3(1));
+		ivec3 step;
+		vec3 t_next;
+		vec3 t_delta;
+		for(int axis = 0; axis < 3; ++axis)
+		{
+			step[axis] = delta[axis] > 0.f ? 1 : delta[axis] < 0.f ? -1 : 0;
+			t_delta[axis] = step[axis] != 0 ? abs(1.f / delta[axis]) : FLT_MAX;
+			const float boundary = float(step[axis] > 0 ? cell[axis] + 1 : cell[axis]);
+			t_next[axis] = step[axis] != 0 ? t0 + (boundary - start[axis]) / delta[axis] : FLT_MAX;
+		}
+
+		float t = t0;
+		vec3 normal = vec3(0.f);
+
+		while(true)
+		{
+			Element* element = block->m_chunks.at(uint32_t(cell.x), uint32_t(cell.y), uint32_t(cell.z));
+			if(solid(element))
+			{
+				hit.m_block = block;
+				hit.m_coord = uvec3(cell);
+				hit.m_element = element;
+				hit.m_distance = t;
+				hit.m_position = from + delta_world * t;
+				hit.m_normal = normal;
+				return true;
+			}
+
+			const int axis = t_next.x < t_next.y ? (t_next.x < t_next.z ? 0 : 2) : (t_next.y < t_next.z ? 1 : 2);
+			if(t_next[axis] > t1)
+				return false;
+
+			t = t_next[axis];
+			t_next[axis] += t_delta[axis];
+			cell[axis] += step[axis];
+
+			normal = vec3(0.f);
+			normal[axis] = -float(step[axis]);
+
+			// leaving the block : carry on in the neighbour on that side
+			if(cell[axis] < 0 || cell[axis] >= size[axis])
+			{
+				block = block->m_neighbours[side_of(axis, step[axis])];
+				if(!block)
+					return false;
+				cell[axis] -= step[axis] * size[axis];
+			}
+		}
+	}
+
+	bool voxel_visible(BlockGrid& grid, const vec3& from, const vec3& to)
+	{
+		VoxelHit hit;
+		return !voxel_raycast(grid, from, to, hit);
+	}
+
+	struct VoxelRaycasts
+	{
+		BlockGrid* m_grid;
+		span<VoxelRay> m_rays;
+		span<VoxelHit> m_hits;
+
+		inline void operator()(JobSystem& js, Job* job, uint32_t start, uint32_t count) const
+		{
+			UNUSED(js); UNUSED(job);
+			for(uint32_t index = start; index < start + count; ++index)
+				voxel_raycast(*m_grid, m_rays[index].m_from, m_rays[index].m_to, m_hits[index]);
+		}
+	};
+
+	void voxel_raycasts(JobSystem* job_system, BlockGrid& grid, span<VoxelRay> rays, span<VoxelHit> hits)
+	{
+		if(!job_system)
+		{
+			for(size_t i = 0; i < rays.size(); ++i)
+				voxel_raycast(grid, rays[i].m_from, rays[i].m_to, hits[i]);
+			return;
+		}
+
+		VoxelRaycasts raycasts = { &grid, rays, hits };
+		Job* job = split_jobs<64>(*job_system, nullptr, 0, uint32_t(rays.size()), raycasts);
+		job_system->complete(job);
+	}
+
+	vec3 voxel_surface_normal(Block& block, const uvec3& coord)
+	{
+		// gradient of the solid occupancy : points from the solid chunks toward the empty ones
+		const size_t index = block.m_chunks.index_at(coord.x, coord.y, coord.z);
+
+		vec3 gradient = vec3(0.f);
+		for(Side side : c_sides)
+		{
+			Element* element = nullptr;
+			const bool exists = block.neighbour(index, side, element);
+			if(exists && !solid(element))
+				gradient += to_vec3(side);
+		}
+
+		return gradient == vec3(0.f) ? vec3(0.f) : normalize(gradient);
+	}
+
+	template <class T_Inside>
+	static size_t voxel_overlap(BlockGrid& grid, const vec3& lo, const vec3& hi, map<Element*, size_t>& counts, const T_Inside& inside)
+	{
+		size_t total = 0;
+
+		for(Sector* sector : grid.m_sectors)
+		{
+			Block& block = *sector->m_block;
+			const vec3 block_lo = block_min(block);
+			const vec3 chunk = block.chunk_size();
+			const Voxels& voxels = block.m_chunks;
+			const vec3 size = vec3(float(voxels.m_x), float(voxels.m_y), float(voxels.m_z));
+
+			// range of the chunks whose center may be inside the volume
+			const uvec3 first = uvec3(clamp(floor((lo - block_lo) / chunk - 0.5f) + 1.f, vec3(0.f), size));
+			const uvec3 last = uvec3(clamp(floor((hi - block_lo) / chunk - 0.5f) + 1.f, vec3(0.f), size));
+			if(first.x >= last.x || first.y >= last.y || first.z >= last.z)
+				continue;
+
+			for(uint32_t z = first.z; z < last.z; ++z)
+				for(uint32_t y = first.y; y < last.y; ++y)
+					for(uint32_t x = first.x; x < last.x; ++x)
+					{
+						const vec3 center = block_lo + (vec3(float(x), float(y), float(z)) + 0.5f) * chunk;
+						if(!inside(center))
+							continue;
+
+						Element* element = voxels.at(x, y, z);
+						if(element == nullptr)
+							continue;
+
+						counts[element]++;
+						total++;
+					}
+		}
+
+		return total;
+	}
+
+	size_t voxel_overlap_box(BlockGrid& grid, const vec3& lo, const vec3& hi, map<Element*, size_t>& counts)
+	{
+		auto inside = [](const vec3& point) { UNUSED(point); return true; };
+		return voxel_overlap(grid, lo, hi, counts, inside);
+	}
+
+	size_t voxel_overlap_sphere(BlockGrid& grid, const vec3& center, float radius, map<Element*, size_t>& counts)
+	{
+		auto inside = [&](const vec3& point) { const vec3 offset = point - center; return dot(offset, offset) <= radius * radius; };
+		return voxel_overlap(grid, center - radius, center + radius, counts, inside);
+	}
+}
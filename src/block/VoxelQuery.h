@@ -0,0 +1,55 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#pragma once
+
+#include <stl/span.h>
+#include <stl/map.h>
+#include <math/Vec.h>
+#include <block/Forward.h>
+
+namespace toy
+{
+	/* Queries answered from the block chunks directly, without going through the physics world :
+		- rays walk the chunks of a BlockGrid with a DDA, crossing from block to block through Block::m_neighbours
+		- only solid elements stop a ray
+		- the blocks read are the roots of the grid : subdivided roots are read from their downsampled chunks
+		- queries only read the chunks, batches are split over the job system
+	*/
+
+	struct VoxelRay
+	{
+		vec3 m_from;
+		vec3 m_to;
+	};
+
+	struct VoxelHit
+	{
+		Block* m_block = nullptr;
+		uvec3 m_coord = uvec3(0U);
+		Element* m_element = nullptr;
+		vec3 m_position = vec3(0.f);
+		// normal of the face the ray entered the chunk through
+		vec3 m_normal = vec3(0.f);
+		// fraction of the ray, from 0 at m_from to 1 at m_to
+		float m_distance = 1.f;
+
+		explicit operator bool() const { return m_block != nullptr; }
+	};
+
+	export_ TOY_BLOCK_EXPORT Block* grid_block_at(BlockGrid& grid, const vec3& position);
+
+	export_ TOY_BLOCK_EXPORT bool voxel_raycast(BlockGrid& grid, const vec3& from, const vec3& to, VoxelHit& hit);
+	export_ TOY_BLOCK_EXPORT bool voxel_visible(BlockGrid& grid, const vec3& from, const vec3& to);
+
+	export_ TOY_BLOCK_EXPORT void voxel_raycasts(JobSystem* job_system, BlockGrid& grid, span<VoxelRay> rays, span<VoxelHit> hits);
+
+	// smooth normal of the surface around a chunk, from the solid chunks surrounding it
+	export_ TOY_BLOCK_EXPORT vec3 voxel_surface_normal(Block& block, const uvec3& coord);
+
+	// number of chunks of each element whose center is inside the volume, in world coordinates
+	export_ TOY_BLOCK_EXPORT size_t voxel_overlap_box(BlockGrid& grid, const vec3& lo, const vec3& hi, map<Element*, size_t>& counts);
+	export_ TOY_BLOCK_EXPORT size_t voxel_overlap_sphere(BlockGrid& grid, const vec3& center, float radius, map<Element*, size_t>& counts);
+}
@@ -0,0 +1,287 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#ifdef TWO_MODULES
+module toy.block
+#else
+#include <math/Grid.hpp>
+#include <block/Types.h>
+#include <block/Voxels.h>
+#include <block/Element.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+namespace toy
+{
+	Voxels::Voxels()
+		: m_palette({ nullptr })
+	{}
+
+	Voxels::Voxels(uint32_t size)
+		: m_x(size)
+		, m_y(size)
+		, m_z(size)
+		, m_palette({ nullptr })
+	{}
+
+	void Voxels::set(size_t index, Element* element)
+	{
+		if(m_bits == 0 && m_palette[0] == element)
+			return;
+
+		const uint16_t value = this->prepare(element);
+		if(value != UINT16_MAX)
+			this->write(index, value);
+	}
+
+	uint16_t Voxels::prepare(Element* element)
+	{
+		if(m_bits == 0)
+		{
+			// leaving the uniform state : every voxel starts at palette entry 0
+			m_bits = 4;
+			m_data.assign((this->size() + 1) / 2, 0);
+		}
+
+		return this->add_palette(element);
+	}
+
+	void Voxels::fill_run(size_t index, size_t count, Element* element)
+	{
+		if(count == 0 || (m_bits == 0 && m_palette[0] == element))
+			return;
+
+		if(count == this->size())
+		{
+			this->fill(element);
+			return;
+		}
+
+		const uint16_t value = this->prepare(element);
+		if(value == UINT16_MAX)
+			return;
+
+		if(m_bits == 8)
+		{
+			memset(&m_data[index], value, count);
+			return;
+		}
+
+		if(m_bits == 16)
+		{
+			for(size_t end = index + count; index < end; ++index)
+				this->write(index, value);
+			return;
+		}
+
+		// unaligned nibbles at both ends, whole bytes in between
+		size_t end = index + count;
+		if(index & 1)
+			this->write(index++, value);
+		if(end & 1 && end > index)
+			this->write(--end, value);
+		if(end > index)
+			memset(&m_data[index >> 1], value | (value << 4), (end - index) >> 1);
+	}
+
+	void Voxels::fill_box(const uvec3& lo, const uvec3& hi, Element* element)
+	{
+		if(lo.x >= hi.x || lo.y >= hi.y || lo.z >= hi.z)
+			return;
+
+		if(lo.x == 0 && lo.y == 0 && lo.z == 0 && hi.x == m_x && hi.y == m_y && hi.z == m_z)
+		{
+			this->fill(element);
+			return;
+		}
+
+		// full rows along x are contiguous, full slices along x and y too
+		const size_t row = hi.x - lo.x;
+		if(row == m_x && hi.y - lo.y == m_y)
+		{
+			this->fill_run(this->index_at(0, 0, lo.z), row * m_y * (hi.z - lo.z), element);
+			return;
+		}
+
+		for(uint32_t z = lo.z; z < hi.z; ++z)
+			for(uint32_t y = lo.y; y < hi.y; ++y)
+				this->fill_run(this->index_at(lo.x, y, z), row, element);
+	}
+
+	void Voxels::fill_column(uint32_t x, uint32_t z, uint32_t bottom, uint32_t top, Element* element)
+	{
+		top = top < m_y ? top : m_y;
+		if(bottom >= top || (m_bits == 0 && m_palette[0] == element))
+			return;
+
+		const uint16_t value = this->prepare(element);
+		if(value == UINT16_MAX)
+			return;
+
+		size_t index = this->index_at(x, bottom, z);
+		for(uint32_t y = bottom; y < top; ++y, index += m_x)
+			this->write(index, value);
+	}
+
+	void Voxels::replace_column(uint32_t x, uint32_t z, span<bool> mask, Element* element)
+	{
+		// the mask covers the palette as it is before the element is added to it
+		if(m_bits == 0)
+		{
+			if(!mask.empty() && mask[0])
+				this->fill_column(x, z, 0, m_y, element);
+			return;
+		}
+
+		const uint16_t value = this->prepare(element);
+		if(value == UINT16_MAX)
+			return;
+
+		size_t index = this->index_at(x, 0, z);
+		for(uint32_t y = 0; y < m_y; ++y, index += m_x)
+		{
+			const uint16_t entry = this->palette_index(index);
+			if(entry < mask.size() && mask[entry])
+				this->write(index, value);
+		}
+	}
+
+	void Voxels::fill(Element* element)
+	{
+		m_palette = { element };
+		m_data = vector<uint8_t>();
+		m_bits = 0;
+	}
+
+	uint16_t Voxels::add_palette(Element* element)
+	{
+		for(size_t i = 0; i < m_palette.size(); ++i)
+			if(m_palette[i] == element)
+				return uint16_t(i);
+
+		// the write is rejected rather than redirected to another element
+		if(m_palette.size() == c_max_palette)
+		{
+			printf("[ERROR] Voxels palette is full, write of element %s rejected\n", element ? element->m_name.c_str() : "none");
+			return UINT16_MAX;
+		}
+
+		m_palette.push_back(element);
+
+		const uint8_t bits = m_palette.size() > 256 ? 16 : m_palette.size() > 16 ? 8 : 4;
+		if(bits > m_bits)
+		{
+			vector<uint16_t> identity(m_palette.size());
+			for(size_t i = 0; i < identity.size(); ++i)
+				identity[i] = uint16_t(i);
+			this->repack(bits, identity);
+		}
+
+		return uint16_t(m_palette.size() - 1);
+	}
+
+	void Voxels::repack(uint8_t bits, const vector<uint16_t>& remap)
+	{
+		const size_t size = this->size();
+		vector<uint8_t> data(bits == 4 ? (size + 1) / 2 : size * (bits / 8), 0);
+
+		for(size_t i = 0; i < size; ++i)
+		{
+			const uint16_t value = remap[this->palette_index(i)];
+			if(bits == 4)
+				data[i >> 1] |= uint8_t(value << ((i & 1) << 2));
+			else if(bits == 8)
+				data[i] = uint8_t(value);
+			else
+			{
+				data[i * 2] = uint8_t(value);
+				data[i * 2 + 1] = uint8_t(value >> 8);
+			}
+		}
+
+		m_data = move(data);
+		m_bits = bits;
+	}
+
+	void Voxels::compact()
+	{
+		if(m_bits == 0)
+		{
+			m_palette.resize(1);
+			return;
+		}
+
+		vector<size_t> counts(m_palette.size(), 0);
+		const size_t size = this->size();
+		for(size_t i = 0; i < size; ++i)
+			counts[this->palette_index(i)]++;
+
+		vector<Element*> palette;
+		vector<uint16_t> remap(m_palette.size(), 0);
+		for(size_t i = 0; i < m_palette.size(); ++i)
+			if(counts[i] > 0)
+			{
+				remap[i] = uint16_t(palette.size());
+				palette.push_back(m_palette[i]);
+			}
+
+		if(palette.size() == 1)
+		{
+			this->fill(palette[0]);
+			return;
+		}
+
+		this->repack(palette.size() <= 16 ? 4 : palette.size() <= 256 ? 8 : 16, remap);
+		m_palette = move(palette);
+	}
+
+	uint64_t Voxels::section_mask(const uvec3& lo, const uvec3& hi) const
+	{
+		if(lo.x >= hi.x || lo.y >= hi.y || lo.z >= hi.z)
+			return 0;
+
+		const uvec3 size = uvec3(m_x, m_y, m_z);
+		const uvec3 first = lo * c_sections / size;
+		const uvec3 last = (hi - 1U) * c_sections / size;
+
+		uint64_t mask = 0;
+		for(uint32_t z = first.z; z <= last.z; ++z)
+			for(uint32_t y = first.y; y <= last.y; ++y)
+				for(uint32_t x = first.x; x <= last.x; ++x)
+					mask |= uint64_t(1) << (x + (y + z * c_sections) * c_sections);
+		return mask;
+	}
+
+	void Voxels::section_range(uint32_t section, uvec3& lo, uvec3& hi) const
+	{
+		const uvec3 size = uvec3(m_x, m_y, m_z);
+		const uvec3 coord = uvec3(section % c_sections, (section / c_sections) % c_sections, section / (c_sections * c_sections));
+		lo = coord * size / c_sections;
+		hi = (coord + 1U) * size / c_sections;
+	}
+
+	bool Voxels::border(size_t index, Side side) const
+	{
+		const ivec3 coord = ivec3(this->coord(index)) + ivec3(to_vec3(side));
+		return coord.x < 0 || coord.y < 0 || coord.z < 0
+			|| coord.x >= int(m_x) || coord.y >= int(m_y) || coord.z >= int(m_z);
+	}
+
+	size_t Voxels::neighbour(size_t index, Side side) const
+	{
+		const uvec3 coord = uvec3(ivec3(this->coord(index)) + ivec3(to_vec3(side)));
+		return this->index_at(coord.x, coord.y, coord.z);
+	}
+
+	size_t Voxels::neighbour_mod(size_t index, Side side) const
+	{
+		const ivec3 size = ivec3(int(m_x), int(m_y), int(m_z));
+		const uvec3 coord = uvec3((ivec3(this->coord(index)) + ivec3(to_vec3(side)) + size) % size);
+		return this->index_at(coord.x, coord.y, coord.z);
+	}
+}
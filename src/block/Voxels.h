@@ -0,0 +1,114 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#pragma once
+
+#include <stl/vector.h>
+#include <stl/span.h>
+#include <math/Vec.h>
+#include <math/Grid.h>
+#include <block/Forward.h>
+
+#include <stdint.h>
+
+namespace toy
+{
+	/* Dense voxel storage of a block :
+		- each voxel is an index in a palette of elements, packed on 4, 8 or 16 bits
+		- past 65535 palette entries, writes of new elements are rejected, with an error
+		- a block where all voxels are the same element stores no voxel data at all
+		- compact() drops unused palette entries and packs back on the smallest width
+		- the palette is persisted through the elements ids (Element::m_id)
+	*/
+
+	class TOY_BLOCK_EXPORT Voxels
+	{
+	public:
+		Voxels();
+		Voxels(uint32_t size);
+
+		uint32_t m_x = 0;
+		uint32_t m_y = 0;
+		uint32_t m_z = 0;
+
+		// palette entry 0 is the value of a uniform block
+		vector<Element*> m_palette;
+		vector<uint8_t> m_data;
+		uint8_t m_bits = 0;
+
+		// the last 16 bit value marks a rejected write
+		static constexpr size_t c_max_palette = 65535;
+
+		size_t size() const { return size_t(m_x) * m_y * m_z; }
+		bool uniform() const { return m_bits == 0; }
+		size_t memory() const { return m_data.size() + m_palette.size() * sizeof(Element*); }
+
+		inline uint16_t palette_index(size_t index) const
+		{
+			if(m_bits == 0) return 0;
+			if(m_bits == 8) return m_data[index];
+			if(m_bits == 16) return uint16_t(m_data[index * 2] | (m_data[index * 2 + 1] << 8));
+			return (m_data[index >> 1] >> ((index & 1) << 2)) & 0xF;
+		}
+
+		inline Element* get(size_t index) const { return m_palette[this->palette_index(index)]; }
+		inline Element* at(uint32_t x, uint32_t y, uint32_t z) const { return this->get(this->index_at(x, y, z)); }
+		inline Element* operator[](size_t index) const { return this->get(index); }
+
+		void set(size_t index, Element* element);
+		void set(uint32_t x, uint32_t y, uint32_t z, Element* element) { this->set(this->index_at(x, y, z), element); }
+
+		void fill(Element* element);
+		void compact();
+
+		// bulk writes : the palette entry is resolved once, then whole runs of voxels are written at a time
+		void fill_run(size_t index, size_t count, Element* element);
+		void fill_box(const uvec3& lo, const uvec3& hi, Element* element);
+		void fill_column(uint32_t x, uint32_t z, uint32_t bottom, uint32_t top, Element* element);
+		// overwrites the voxels of the column whose palette entry is flagged in mask, entries beyond the mask are kept
+		void replace_column(uint32_t x, uint32_t z, span<bool> mask, Element* element);
+
+		// grid layout : x varies fastest, then y, then z
+		inline size_t index_at(uint32_t x, uint32_t y, uint32_t z) const { return x + (y + size_t(z) * m_y) * m_x; }
+		inline uint32_t x(size_t index) const { return uint32_t(index % m_x); }
+		inline uint32_t y(size_t index) const { return uint32_t((index / m_x) % m_y); }
+		inline uint32_t z(size_t index) const { return uint32_t(index / (size_t(m_x) * m_y)); }
+		inline uvec3 coord(size_t index) const { return uvec3(this->x(index), this->y(index), this->z(index)); }
+
+		// the grid is split in 4x4x4 sections, meshed and collided separately : one bit per section in a 64 bit mask
+		static constexpr uint32_t c_sections = 4;
+
+		uint64_t section_mask(const uvec3& lo, const uvec3& hi) const;
+		void section_range(uint32_t section, uvec3& lo, uvec3& hi) const;
+
+		bool border(size_t index, Side side) const;
+		size_t neighbour(size_t index, Side side) const;
+		// index of the voxel across the border, in a neighbour grid of the same size
+		size_t neighbour_mod(size_t index, Side side) const;
+
+	private:
+		uint16_t prepare(Element* element);
+		uint16_t add_palette(Element* element);
+
+		inline void write(size_t index, uint16_t value)
+		{
+			if(m_bits == 8)
+				m_data[index] = uint8_t(value);
+			else if(m_bits == 16)
+			{
+				m_data[index * 2] = uint8_t(value);
+				m_data[index * 2 + 1] = uint8_t(value >> 8);
+			}
+			else
+			{
+				uint8_t& byte = m_data[index >> 1];
+				const uint8_t shift = uint8_t((index & 1) << 2);
+				byte = uint8_t((byte & ~(0xF << shift)) | (value << shift));
+			}
+		}
+
+		void repack(uint8_t bits, const vector<uint16_t>& remap);
+	};
+}
@@ -24,6 +24,7 @@ namespace two
     template <> TOY_BLOCK_EXPORT Type& type<two::ComponentHandle<toy::Tileblock>>() { static Type ty("ComponentHandle<toy::Tileblock>", sizeof(two::ComponentHandle<toy::Tileblock>)); return ty; }
     template <> TOY_BLOCK_EXPORT Type& type<two::vector2d<toy::Block*>>() { static Type ty("vector2d<toy::Block*>", sizeof(two::vector2d<toy::Block*>)); return ty; }
     template <> TOY_BLOCK_EXPORT Type& type<toy::Block>() { static Type ty("Block", sizeof(toy::Block)); return ty; }
+    template <> TOY_BLOCK_EXPORT Type& type<toy::BlockShape>() { static Type ty("BlockShape", type<two::Shape>(), sizeof(toy::BlockShape)); return ty; }
     template <> TOY_BLOCK_EXPORT Type& type<toy::Chunk>() { static Type ty("Chunk", sizeof(toy::Chunk)); return ty; }
     template <> TOY_BLOCK_EXPORT Type& type<toy::Element>() { static Type ty("Element", sizeof(toy::Element)); return ty; }
     template <> TOY_BLOCK_EXPORT Type& type<toy::Heap>() { static Type ty("Heap", sizeof(toy::Heap)); return ty; }
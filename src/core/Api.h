@@ -2,6 +2,7 @@
 #include <jobs/JobSystem.h>
 #include <lang/Script.h>
 #include <core/Anim/Anim.h>
+#include <core/Asset/AssetQueue.h>
 #include <core/Core.h>
 #include <core/Forward.h>
 #include <core/Handles.h>
@@ -19,10 +20,14 @@
 #include <core/Movable/MotionStateObserver.h>
 #include <core/Movable/Movable.h>
 #include <core/Navmesh/ChunkyTriMesh.h>
+#include <core/Navmesh/GroundCache.h>
 #include <core/Navmesh/NavGeom.h>
 #include <core/Navmesh/Navmesh.h>
+#include <core/Navmesh/NavmeshCache.h>
 #include <core/Navmesh/rcTileMesh.h>
+#include <core/Path/Crowd.h>
 #include <core/Path/DetourPath.h>
+#include <core/Path/PathGraph.h>
 #include <core/Path/Pathfinder.h>
 #include <core/Physic/Collider.h>
 #include <core/Physic/CollisionGroup.h>
@@ -35,9 +40,16 @@
 #include <core/Physic/Signal.h>
 #include <core/Physic/Solid.h>
 #include <core/Script/Script.h>
+#include <core/World/Autosave.h>
+#include <core/World/Delta.h>
+#include <core/World/JobTasks.h>
 #include <core/World/Origin.h>
+#include <core/World/Replay.h>
 #include <core/World/Section.h>
+#include <core/World/Snapshot.h>
 #include <core/World/World.h>
 #include <core/World/WorldClock.h>
+#include <core/WorldPage/PageCache.h>
 #include <core/WorldPage/WorldPage.h>
+#include <core/WorldPage/WorldStream.h>
 
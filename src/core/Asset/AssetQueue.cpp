@@ -0,0 +1,167 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#include <jobs/JobSystem.h>
+#include <core/Types.h>
+#include <core/Asset/AssetQueue.h>
+
+#include <stdio.h>
+#include <algorithm>
+
+namespace toy
+{
+	void AssetLoad::then(function<void(bool)> callback)
+	{
+		if(this->done())
+			callback(m_state == Ready);
+		else
+			m_callbacks.push_back(callback);
+	}
+
+	AssetQueue::AssetQueue(JobSystem& job_system)
+		: m_job_system(job_system)
+	{}
+
+	AssetQueue::~AssetQueue()
+	{
+		// the jobs in flight write into their load : they must be done before the loads are released
+		for(std::shared_ptr<AssetLoad>& load : m_loading)
+			if(!load->m_loaded)
+				m_job_system.complete(load->m_job);
+	}
+
+	std::shared_ptr<AssetLoad> AssetQueue::load(const string& key, function<bool()> load, function<bool()> publish, bool detached)
+	{
+		if(!key.empty())
+		{
+			auto it = m_loads.find(key);
+			if(it != m_loads.end())
+			{
+				if(std::shared_ptr<AssetLoad> shared = it->second.lock())
+					return shared;
+				m_loads.erase(it);
+			}
+		}
+
+		std::shared_ptr<AssetLoad> asset = std::make_shared<AssetLoad>();
+		asset->m_key = key;
+		asset->m_load = load;
+		asset->m_publish = publish;
+		asset->m_detached = detached;
+		m_queued.push_back(asset);
+
+		if(!key.empty())
+			m_loads[key] = asset;
+		return asset;
+	}
+
+	void AssetQueue::finish(AssetLoad& load, bool success)
+	{
+		load.m_state = success ? AssetLoad::Ready : AssetLoad::Failed;
+		if(success)
+			m_published++;
+		else
+		{
+			m_failed++;
+			printf("[warning] Asset %s could not be loaded\n", load.m_key.c_str());
+		}
+
+		vector<function<void(bool)>> callbacks = move(load.m_callbacks);
+		load.m_callbacks.clear();
+		for(auto& callback : callbacks)
+			callback(success);
+	}
+
+	void AssetQueue::update()
+	{
+		// only the queue holds them : nobody wants these assets anymore
+		auto cancelled = [&](const std::shared_ptr<AssetLoad>& load)
+		{
+			const bool cancel = !load->m_detached && load.use_count() == 1;
+			if(cancel)
+				m_cancelled++;
+			return cancel;
+		};
+
+		m_queued.erase(std::remove_if(m_queued.begin(), m_queued.end(), cancelled), m_queued.end());
+		m_loaded.erase(std::remove_if(m_loaded.begin(), m_loaded.end(), cancelled), m_loaded.end());
+
+		for(std::shared_ptr<AssetLoad>& load : m_loading)
+			if(load->m_loaded)
+			{
+				if(load->m_success)
+				{
+					load->m_state = AssetLoad::Loaded;
+					m_loaded.push_back(load);
+				}
+				else
+					this->finish(*load, false);
+			}
+
+		m_loading.erase(std::remove_if(m_loading.begin(), m_loading.end(), [](const std::shared_ptr<AssetLoad>& load) { return bool(load->m_loaded); }), m_loading.end());
+
+		// loads without a job stage go straight to publishing
+		size_t started = 0;
+		for(std::shared_ptr<AssetLoad>& load : m_queued)
+		{
+			if(load->m_load && m_loading.size() >= m_max_loading)
+				break;
+
+			started++;
+			if(!load->m_load)
+			{
+				load->m_state = AssetLoad::Loaded;
+				m_loaded.push_back(load);
+				continue;
+			}
+
+			load->m_state = AssetLoad::Loading;
+			m_loading.push_back(load);
+
+			AssetLoad* target = load.get();
+			load->m_job = m_job_system.job(nullptr, [target](JobSystem& js, Job* job)
+			{
+				UNUSED(js); UNUSED(job);
+				target->m_success = target->m_load();
+				target->m_loaded = true;
+			});
+			m_job_system.run(load->m_job);
+		}
+		m_queued.erase(m_queued.begin(), m_queued.begin() + started);
+
+		// publishing runs on the main thread : a few per update, so that a burst of loads doesn't stall a frame
+		size_t published = 0;
+		for(auto it = m_loaded.begin(); it != m_loaded.end() && published < m_max_publish;)
+		{
+			AssetLoad& load = **it;
+			if(load.m_publish && !load.m_publish())
+			{
+				++it;
+				continue;
+			}
+
+			published++;
+			this->finish(load, true);
+			it = m_loaded.erase(it);
+		}
+	}
+
+	void AssetQueue::flush()
+	{
+		while(!m_queued.empty() || !m_loading.empty())
+		{
+			for(std::shared_ptr<AssetLoad>& load : m_loading)
+				if(!load->m_loaded)
+					m_job_system.complete(load->m_job);
+			this->update();
+		}
+
+		// the publishes that asked to be tried again stay queued
+		const size_t max_publish = m_max_publish;
+		m_max_publish = SIZE_MAX;
+		this->update();
+		m_max_publish = max_publish;
+	}
+}
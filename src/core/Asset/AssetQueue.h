@@ -0,0 +1,89 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#pragma once
+
+#include <stl/vector.h>
+#include <stl/string.h>
+#include <stl/map.h>
+#include <stl/function.h>
+#include <core/Forward.h>
+
+#include <atomic>
+#include <memory>
+
+namespace toy
+{
+	// an asset being loaded : the handles to it share it, and the load is cancelled once none is left
+	struct TOY_CORE_EXPORT AssetLoad
+	{
+		enum State : unsigned int { Queued, Loading, Loaded, Ready, Failed };
+
+		string m_key;
+		State m_state = Queued;
+
+		// reads and parses the asset on a job, into data owned by the load : false when it couldn't be read
+		function<bool()> m_load;
+		// swaps the loaded data into the asset on the main thread : false to be tried again on the next update
+		function<bool()> m_publish;
+		// loaded even when no handle is held, for assets owned by a store
+		bool m_detached = false;
+
+		bool ready() const { return m_state == Ready; }
+		bool done() const { return m_state == Ready || m_state == Failed; }
+
+		// called on the main thread once the asset is published or failed, right away when it already is
+		void then(function<void(bool)> callback);
+
+		std::atomic<bool> m_loaded = { false };
+		bool m_success = false;
+		Job* m_job = nullptr;
+		vector<function<void(bool)>> m_callbacks;
+	};
+
+	/* Loads assets on jobs, and publishes them on the main thread :
+		- a load reads and parses on a job, never into the asset in use, which keeps its placeholder state meanwhile
+		- the loaded data is swapped into the asset in update(), called between frames : no load ever happens inside a frame step
+		- an asset only the main thread can create, like a gpu resource, has no job stage : it's created in update(), a few per frame
+		- loads of the same key are shared, the loads no handle holds anymore are cancelled before they're published
+	*/
+
+	class TOY_CORE_EXPORT AssetQueue
+	{
+	public:
+		AssetQueue(JobSystem& job_system);
+		~AssetQueue();
+
+		AssetQueue(const AssetQueue& other) = delete;
+		AssetQueue& operator=(const AssetQueue& other) = delete;
+
+		JobSystem& m_job_system;
+
+		size_t m_max_loading = 4;
+		size_t m_max_publish = 8;
+
+		size_t m_published = 0;
+		size_t m_failed = 0;
+		size_t m_cancelled = 0;
+
+		// an empty key is never shared
+		std::shared_ptr<AssetLoad> load(const string& key, function<bool()> load, function<bool()> publish, bool detached = false);
+
+		// called once per frame, between frames : starts the queued loads, and publishes the loaded ones
+		void update();
+		// waits until all the loads are published, or failed
+		void flush();
+
+		size_t pending() const { return m_queued.size() + m_loading.size() + m_loaded.size(); }
+
+	private:
+		void finish(AssetLoad& load, bool success);
+
+		vector<std::shared_ptr<AssetLoad>> m_queued;
+		vector<std::shared_ptr<AssetLoad>> m_loading;
+		vector<std::shared_ptr<AssetLoad>> m_loaded;
+		map<string, std::weak_ptr<AssetLoad>> m_loads;
+	};
+}
@@ -40,6 +40,8 @@
 #	pragma warning (pop)
 #endif
 
+#include <cstring>
+
 namespace toy
 {
 	BulletShape::BulletShape(unique<btCollisionShape> shape)
@@ -54,19 +56,30 @@ namespace toy
 	BulletShape::BulletShape(BulletShape&& other)
 		: shape(move(other.shape))
 		, mesh(move(other.mesh))
-	{}
+		, children(move(other.children))
+		, bvh(other.bvh)
+	{
+		other.bvh = nullptr;
+	}
 
 	BulletShape& BulletShape::operator=(BulletShape&& other)
 	{
 		this->shape = move(other.shape);
 		this->mesh = move(other.mesh);
+		this->children = move(other.children);
+		std::swap(this->bvh, other.bvh);
 		return *this;
 	}
 
 	BulletShape::~BulletShape()
-	{}
+	{
+		// the shape doesn't own a bvh set from outside, it is destroyed before its buffer
+		shape = nullptr;
+		if(bvh)
+			btAlignedFree(bvh);
+	}
 
-	BulletShape createGeometryShape(Geometry& geometry)
+	static unique<btTriangleMesh> geometry_trimesh(Geometry& geometry)
 	{
 		unique<btTriangleMesh> trimesh = make_unique<btTriangleMesh>();
 
@@ -83,12 +96,62 @@ namespace toy
 			trimesh->addTriangle(vertex[0], vertex[1], vertex[2]);
 		}
 
+		return trimesh;
+	}
+
+	BulletShape createGeometryShape(Geometry& geometry)
+	{
+		unique<btTriangleMesh> trimesh = geometry_trimesh(geometry);
+
 		const bool useQuantizedAABB = true;
 		unique<btCollisionShape> meshShape(make_unique<btBvhTriangleMeshShape>(trimesh.get(), useQuantizedAABB));
 
 		return BulletShape(move(meshShape), move(trimesh));
 	}
 
+	bool save_bvh(const BulletShape& shape, vector<uint8_t>& data)
+	{
+		if(!shape.shape || shape.shape->getShapeType() != TRIANGLE_MESH_SHAPE_PROXYTYPE)
+			return false;
+
+		const btOptimizedBvh* bvh = static_cast<btBvhTriangleMeshShape&>(*shape.shape).getOptimizedBvh();
+		if(!bvh)
+			return false;
+
+		// bullet serializes in place into a 16 bytes aligned buffer
+		const unsigned size = bvh->calculateSerializeBufferSize();
+		void* buffer = btAlignedAlloc(size, 16);
+		const bool success = bvh->serializeInPlace(buffer, size, false);
+		if(success)
+			data.assign((uint8_t*)buffer, (uint8_t*)buffer + size);
+		btAlignedFree(buffer);
+		return success;
+	}
+
+	BulletShape load_bvh(Geometry& geometry, const uint8_t* data, size_t size)
+	{
+		void* buffer = btAlignedAlloc(size, 16);
+		memcpy(buffer, data, size);
+
+		btOptimizedBvh* bvh = static_cast<btOptimizedBvh*>(btQuantizedBvh::deSerializeInPlace(buffer, unsigned(size), false));
+		if(!bvh)
+		{
+			btAlignedFree(buffer);
+			return BulletShape(nullptr);
+		}
+
+		unique<btTriangleMesh> trimesh = geometry_trimesh(geometry);
+
+		const bool useQuantizedAABB = true;
+		const bool buildBvh = false;
+		unique<btBvhTriangleMeshShape> meshShape = make_unique<btBvhTriangleMeshShape>(trimesh.get(), useQuantizedAABB, buildBvh);
+		meshShape->setOptimizedBvh(bvh);
+
+		BulletShape result = BulletShape(move(meshShape), move(trimesh));
+		result.bvh = buffer;
+		return result;
+	}
+
 	BulletShape createConvexHullShape(ConvexHull& hull)
 	{
 		unique<btConvexHullShape> convexHull = make_unique<btConvexHullShape>();
@@ -97,6 +160,27 @@ namespace toy
 		return BulletShape(move(convexHull));
 	}
 
+	BulletShape createCompoundShape(CompoundShape& compound)
+	{
+		unique<btCompoundShape> shape = make_unique<btCompoundShape>(true, int(compound.m_children.size()));
+
+		vector<BulletShape> children;
+		children.reserve(compound.m_shapes.size());
+		for(CollisionShape& child : compound.m_shapes)
+			children.push_back(DispatchBulletShape::me().dispatch(child));
+
+		for(const CompoundShape::Child& child : compound.m_children)
+		{
+			const CollisionShape& child_shape = compound.m_shapes[child.m_shape];
+			const vec3 position = child.m_position + rotate(child.m_rotation, child_shape.m_center);
+			shape->addChildShape(btTransform(to_btquat(child.m_rotation), to_btvec3(position)), children[child.m_shape].shape.get());
+		}
+
+		BulletShape result = { move(shape) };
+		result.children = move(children);
+		return result;
+	}
+
 	DispatchBulletShape::DispatchBulletShape()
 	{
 		dispatch_branch<Plane>	    (*this, +[](Plane& plane) -> BulletShape { return{ make_unique<btStaticPlaneShape>(to_btvec3(plane.m_normal), plane.m_distance) }; });
@@ -107,6 +191,7 @@ namespace toy
 		dispatch_branch<Cube>       (*this, +[](Cube& box) -> BulletShape { return{ make_unique<btBoxShape>(to_btvec3(box.m_extents)) }; });
 		dispatch_branch<ConvexHull> (*this, createConvexHullShape);
 		dispatch_branch<Geometry>   (*this, createGeometryShape);
+		dispatch_branch<CompoundShape> (*this, createCompoundShape);
 	};
 
 	BulletShape DispatchBulletShape::dispatch(CollisionShape& collision_shape)
@@ -115,11 +200,22 @@ namespace toy
 		return Dispatch::dispatch(shape); 
 	}
 
+	static BulletShape collider_shape(CollisionShape& collision_shape)
+	{
+		if(collision_shape.m_cooked)
+		{
+			BulletShape& cooked = static_cast<BulletCookedShape&>(*collision_shape.m_cooked).m_shape;
+			if(cooked.shape)
+				return move(cooked);
+		}
+		return DispatchBulletShape::me().dispatch(collision_shape);
+	}
+
 	BulletCollider::BulletCollider(BulletMedium& bullet_world, HSpatial spatial, HCollider collider, CollisionShape& collision_shape, bool create)
 		: m_bullet_world(bullet_world)
 		, m_spatial(spatial)
 		, m_collider(collider)
-		, m_collision_shape(DispatchBulletShape::me().dispatch(collision_shape))
+		, m_collision_shape(collider_shape(collision_shape))
 	{
 		collider->m_motion_state.m_transform_source = this;
 
@@ -130,6 +226,7 @@ namespace toy
 		}
 
 		collision_shape.m_shape = {};
+		collision_shape.m_cooked = nullptr;
 	}
 
 	BulletCollider::~BulletCollider()
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <stl/vector.h>
 #include <infra/Global.h>
 #include <type/Dispatch.h>
 #include <core/Forward.h>
@@ -30,8 +31,24 @@ namespace toy
 
 		unique<btCollisionShape> shape;
 		unique<btStridingMeshInterface> mesh;
+		// shapes referenced by a compound shape
+		vector<BulletShape> children;
+		// buffer of a bvh loaded in place from a cache, it must outlive the shape
+		void* bvh = nullptr;
 	};
 
+	class TOY_CORE_EXPORT BulletCookedShape : public CookedShape
+	{
+	public:
+		BulletCookedShape(BulletShape shape) : m_shape(move(shape)) {}
+
+		BulletShape m_shape;
+	};
+
+	// the bvh of a triangle mesh shape in the bullet in-place format, so that it doesn't have to be built again
+	TOY_CORE_EXPORT bool save_bvh(const BulletShape& shape, vector<uint8_t>& data);
+	TOY_CORE_EXPORT BulletShape load_bvh(Geometry& geometry, const uint8_t* data, size_t size);
+
 	class TOY_CORE_EXPORT DispatchBulletShape : public Dispatch<BulletShape>, public LazyGlobal<DispatchBulletShape>
 	{
 	public:
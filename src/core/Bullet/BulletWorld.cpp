@@ -9,6 +9,7 @@
 #include <math/Timer.h>
 #include <geom/Geom.h>
 #include <geom/Shape.h>
+#include <geom/Geometry.h>
 #include <core/Types.h>
 #include <core/Bullet/BulletWorld.h>
 #include <core/World/World.hpp>
@@ -344,6 +345,8 @@ namespace toy
 		gCollisionStartedCallback = collisionStarted;
 		gCollisionEndedCallback = collisionEnded;
 #endif
+		// the shape dispatch is created here, so that cooking jobs only ever read it
+		DispatchBulletShape::me();
 	}
 
 	BulletWorld::~BulletWorld()
@@ -365,4 +368,36 @@ namespace toy
 		BulletMedium& bullet_medium = as<BulletMedium>(this->sub_world(SolidMedium::me));
 		return bullet_medium.raycast(HCollider(), ray.m_start, ray.m_end, mask);
 	}
+
+	void BulletWorld::cook(CollisionShape& shape)
+	{
+		if(!shape.m_shape)
+			return;
+
+		// triangle meshes build their bvh and bounds here, this is the costly part of creating a collider
+		shape.m_cooked = std::make_shared<BulletCookedShape>(DispatchBulletShape::me().dispatch(shape));
+		shape.m_shape = {};
+	}
+
+	bool BulletWorld::save_cooked(const CollisionShape& shape, vector<uint8_t>& data)
+	{
+		if(!shape.m_cooked)
+			return false;
+		return save_bvh(static_cast<const BulletCookedShape&>(*shape.m_cooked).m_shape, data);
+	}
+
+	bool BulletWorld::load_cooked(CollisionShape& shape, const uint8_t* data, size_t size)
+	{
+		// only triangle meshes have a bvh
+		if(!shape.m_shape || &shape.m_shape->m_type != &type<Geometry>())
+			return false;
+
+		BulletShape cooked = load_bvh(static_cast<Geometry&>(*shape.m_shape), data, size);
+		if(!cooked.shape)
+			return false;
+
+		shape.m_cooked = std::make_shared<BulletCookedShape>(move(cooked));
+		shape.m_shape = {};
+		return true;
+	}
 }
@@ -104,5 +104,9 @@ namespace toy
 
 		vec3 ground_point(const Ray& ray);
 		Collision raycast(const Ray& ray, short int mask);
+
+		void cook(CollisionShape& shape);
+		bool save_cooked(const CollisionShape& shape, vector<uint8_t>& data);
+		bool load_cooked(CollisionShape& shape, const uint8_t* data, size_t size);
     };
 }
@@ -44,9 +44,14 @@ namespace toy
     class Navmesh;
     class Navblock;
     class NavmeshShape;
+    class MappedFile;
+    class NavmeshCache;
+    class GroundCache;
     class Core;
     class DefaultWorld;
     class CollisionShape;
+    class CompoundShape;
+    class CookedShape;
     class Movable;
     class MotionSource;
     class MotionState;
@@ -58,6 +63,7 @@ namespace toy
     class Solid;
     struct Contact;
     class BulletShape;
+    class BulletCookedShape;
     class DispatchBulletShape;
     class BulletCollider;
     class BulletSolid;
@@ -76,6 +82,10 @@ namespace toy
     struct rcChunkyTriMesh;
     class Waypoint;
     class DetourPath;
+    class PathCache;
+    class PathGraph;
+    class CrowdAgent;
+    class Crowd;
     class Pathfinder;
     class Obstacle;
     class Obstacle;
@@ -89,6 +99,30 @@ namespace toy
     class WorldClock;
     class WorldMedium;
     class WorldPage;
+    struct WorldPageCook;
+    struct PageKey;
+    class PageCache;
+    struct PageChunk;
+    struct PageSection;
+    struct StreamAnchor;
+    struct PageSource;
+    class WorldStream;
+    class WorldSnapshot;
+    struct AutosaveTask;
+    class WorldAutosave;
+    struct JobTask;
+    class JobTasks;
+    struct ReplayEvent;
+    struct ReplayFrame;
+    struct WorldRecording;
+    class WorldRecorder;
+    struct BitWriter;
+    struct BitReader;
+    class WorldDelta;
+    class DeltaEncoder;
+    class DeltaDecoder;
+    struct AssetLoad;
+    class AssetQueue;
 }
 
 #ifdef TWO_META_GENERATOR
@@ -114,6 +148,7 @@ namespace two
 
 	extern template struct refl_ ComponentHandle<toy::Origin>;
 	extern template struct refl_ ComponentHandle<toy::Waypoint>;
+	extern template struct refl_ ComponentHandle<toy::CrowdAgent>;
 }
 #endif
 
@@ -135,6 +170,7 @@ namespace toy
 
 	using HOrigin = ComponentHandle<Origin>;
 	using HWaypoint = ComponentHandle<Waypoint>;
+	using HCrowdAgent = ComponentHandle<CrowdAgent>;
 }
 
 #ifdef TWO_META_GENERATOR
@@ -15,6 +15,7 @@
 #include <core/WorldPage/WorldPage.h>
 #include <core/Navmesh/Navmesh.h>
 #include <core/Path/DetourPath.h>
+#include <core/Path/Crowd.h>
 #include <core/World/Origin.h>
 
 namespace two
@@ -37,4 +38,5 @@ namespace two
 
 	template struct ComponentHandle<toy::Origin>;
 	template struct ComponentHandle<toy::Waypoint>;
+	template struct ComponentHandle<toy::CrowdAgent>;
 }
@@ -23,4 +23,5 @@ namespace two
 
 	template <> struct TypedBuffer<toy::Origin>			{ static uint32_t index() { return 10; } };
 	template <> struct TypedBuffer<toy::Waypoint>		{ static uint32_t index() { return 11; } };
+	template <> struct TypedBuffer<toy::CrowdAgent>		{ static uint32_t index() { return 17; } };
 }
@@ -0,0 +1,152 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#include <core/Types.h>
+#include <core/Navmesh/GroundCache.h>
+
+#include <DetourNavMesh.h>
+#include <DetourNavMeshQuery.h>
+
+#include <float.h>
+
+namespace toy
+{
+	GroundCache::GroundCache()
+		: m_query(make_unique<dtNavMeshQuery>())
+	{}
+
+	GroundCache::~GroundCache()
+	{}
+
+	void GroundCache::setup(const dtNavMesh& navmesh)
+	{
+		m_navmesh = &navmesh;
+		m_query->init(&navmesh, 64);
+
+		m_tiles.clear();
+		m_tiles.resize(navmesh.getMaxTiles());
+
+		for(int i = 0; i < navmesh.getMaxTiles(); ++i)
+		{
+			const dtMeshTile* mesh_tile = navmesh.getTile(i);
+			if(mesh_tile && mesh_tile->header)
+				this->build_tile(m_tiles[i], *mesh_tile);
+		}
+	}
+
+	void GroundCache::clear()
+	{
+		m_navmesh = nullptr;
+		m_tiles.clear();
+	}
+
+	const GroundCache::Tile* GroundCache::tile_at(const vec3& position) const
+	{
+		int tx, ty;
+		m_navmesh->calcTileLoc(value_ptr(position), &tx, &ty);
+		const dtMeshTile* mesh_tile = m_navmesh->getTileAt(tx, ty, 0);
+		if(!mesh_tile || !mesh_tile->header)
+			return nullptr;
+
+		const dtTileRef ref = m_navmesh->getTileRef(mesh_tile);
+		const Tile& tile = m_tiles[m_navmesh->decodePolyIdTile(ref)];
+
+		// a different salt means the tile was rebuilt since the grids were built
+		return tile.m_ref == ref ? &tile : nullptr;
+	}
+
+	void GroundCache::build_tile(Tile& tile, const dtMeshTile& mesh_tile)
+	{
+		const dtMeshHeader& header = *mesh_tile.header;
+
+		tile.m_ref = m_navmesh->getTileRef(&mesh_tile);
+		tile.m_min = vec2(header.bmin[0], header.bmin[2]);
+		tile.m_cell = vec2(header.bmax[0] - header.bmin[0], header.bmax[2] - header.bmin[2]) / float(c_cells);
+		tile.m_offsets.assign(c_cells * c_cells + 1, 0);
+		tile.m_polys.clear();
+
+		const dtPolyRef base = m_navmesh->getPolyRefBase(&mesh_tile);
+
+		auto cell_range = [&](const dtPoly& poly, ivec2& lo, ivec2& hi)
+		{
+			vec2 pmin = vec2(FLT_MAX);
+			vec2 pmax = vec2(-FLT_MAX);
+			for(int v = 0; v < poly.vertCount; ++v)
+			{
+				const float* vert = &mesh_tile.verts[poly.verts[v] * 3];
+				pmin = min(pmin, vec2(vert[0], vert[2]));
+				pmax = max(pmax, vec2(vert[0], vert[2]));
+			}
+			lo = clamp(ivec2((pmin - tile.m_min) / tile.m_cell), ivec2(0), ivec2(c_cells - 1));
+			hi = clamp(ivec2((pmax - tile.m_min) / tile.m_cell), ivec2(0), ivec2(c_cells - 1));
+		};
+
+		// two passes : count the polygons of each cell, then fill them in place
+		for(int pass = 0; pass < 2; ++pass)
+		{
+			vector<uint32_t> cursor = tile.m_offsets;
+			for(int i = 0; i < header.polyCount; ++i)
+			{
+				const dtPoly& poly = mesh_tile.polys[i];
+				if(poly.getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+					continue;
+
+				ivec2 lo, hi;
+				cell_range(poly, lo, hi);
+				for(int y = lo.y; y <= hi.y; ++y)
+					for(int x = lo.x; x <= hi.x; ++x)
+					{
+						const int cell = x + y * c_cells;
+						if(pass == 0)
+							tile.m_offsets[cell + 1]++;
+						else
+							tile.m_polys[cursor[cell]++] = base | dtPolyRef(i);
+					}
+			}
+
+			if(pass == 0)
+			{
+				for(int cell = 0; cell < c_cells * c_cells; ++cell)
+					tile.m_offsets[cell + 1] += tile.m_offsets[cell];
+				tile.m_polys.resize(tile.m_offsets.back());
+			}
+		}
+	}
+
+	bool GroundCache::ground_height(const vec3& position, float end, float& height) const
+	{
+		if(!m_navmesh)
+			return false;
+
+		const Tile* tile = this->tile_at(position);
+		if(!tile)
+			return false;
+
+		const ivec2 coord = clamp(ivec2((vec2(position.x, position.z) - tile->m_min) / tile->m_cell), ivec2(0), ivec2(c_cells - 1));
+		const int cell = coord.x + coord.y * c_cells;
+
+		const float low = min(position.y, end);
+		const float high = max(position.y, end);
+
+		// the point can lie on several layers : keep the surface closest to the start of the segment
+		bool found = false;
+		float distance = FLT_MAX;
+		for(uint32_t i = tile->m_offsets[cell]; i < tile->m_offsets[cell + 1]; ++i)
+		{
+			float h;
+			// getPolyHeight fails when the point is outside of the polygon footprint
+			if(dtStatusFailed(m_query->getPolyHeight(tile->m_polys[i], value_ptr(position), &h)))
+				continue;
+			if(h < low || h > high || abs(h - position.y) >= distance)
+				continue;
+
+			height = h;
+			distance = abs(h - position.y);
+			found = true;
+		}
+
+		return found;
+	}
+}
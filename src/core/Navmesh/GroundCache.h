@@ -0,0 +1,57 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#pragma once
+
+#include <stl/vector.h>
+#include <stl/memory.h>
+#include <math/Vec.h>
+#include <core/Forward.h>
+
+#include <DetourNavMesh.h>
+
+class dtNavMeshQuery;
+
+namespace toy
+{
+	/* Ground height queries on the navmesh detail mesh :
+		- each tile is divided in a 2D grid of cells, each cell lists the polygons overlapping it
+		- a query only tests the polygons of its cell, no spatial search in the navmesh
+		- the grids are built once per navmesh build, queries are then read-only and can run from parallel loops
+	*/
+
+	class TOY_CORE_EXPORT GroundCache
+	{
+	public:
+		GroundCache();
+		~GroundCache();
+
+		static const int c_cells = 16;
+
+		struct Tile
+		{
+			dtTileRef m_ref = 0;
+			vec2 m_min = vec2(0.f);
+			vec2 m_cell = vec2(0.f);
+			vector<uint32_t> m_offsets;
+			vector<dtPolyRef> m_polys;
+		};
+
+		const dtNavMesh* m_navmesh = nullptr;
+		unique<dtNavMeshQuery> m_query;
+
+		vector<Tile> m_tiles;
+
+		void setup(const dtNavMesh& navmesh);
+		void clear();
+
+		// first ground surface crossed going vertically from position down (or up) to the height end
+		bool ground_height(const vec3& position, float end, float& height) const;
+
+	private:
+		const Tile* tile_at(const vec3& position) const;
+		void build_tile(Tile& tile, const dtMeshTile& mesh_tile);
+	};
+}
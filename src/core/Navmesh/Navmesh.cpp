@@ -9,12 +9,19 @@
 #include <infra/ToString.h>
 #include <geom/Shape/ProcShape.h>
 #include <geom/Shape/DrawShape.h>
+#include <geom/Geometry.h>
+#include <geom/Geom.h>
 #include <math/Random.h>
+#include <util/Hash.h>
+#include <ecs/Complex.h>
 
 #include <core/World/World.h>
 #include <core/World/Section.h>
 #include <core/WorldPage/WorldPage.h>
 #include <core/Spatial/Spatial.h>
+#include <core/Physic/PhysicWorld.h>
+#include <core/Navmesh/ChunkyTriMesh.h>
+#include <core/Path/PathGraph.h>
 
 #define _USE_MATH_DEFINES
 #include <math.h>
@@ -191,6 +198,8 @@ namespace toy
 		static NavmeshShapeDeclaration decl;
 
 		m_navgeom = make_unique<NavGeom>(m_geometry, m_world.m_name.c_str());
+		m_ground = make_unique<GroundCache>();
+		m_graph = make_unique<PathGraph>(*this);
 	}
 
 	Navmesh::~Navmesh()
@@ -198,15 +207,18 @@ namespace toy
 
 	void Navmesh::update_block(Navblock& navblock)
 	{
-		// @todo we are just appending here, should clear and update
-
 		const Spatial& spatial = navblock.m_spatial;
 		const WorldPage& world_page = navblock.m_world_page;
 
+		// the previous geometry of the block is replaced
+		this->remove_block(navblock);
+
+		BlockGeometry range = { uint32_t(m_geometry.m_vertices.size()), 0U, uint32_t(m_geometry.m_triangles.size()), 0U };
+
 		for(const Geometry& geom : world_page.m_chunks)
 		{
 			if(geom.m_vertices.empty())
-				return;
+				continue;
 
 			printf("[info] Updating Navmesh geometry block with %zu vertices\n", geom.m_vertices.size());
 
@@ -221,6 +233,99 @@ namespace toy
 			m_dirty = true;
 		}
 
+		for(const CompoundShape& compound : world_page.m_instances)
+			this->add_instances(spatial, compound);
+
+		// the sections supplied by the contents of the page, like voxel blocks, are relative to their own spatial
+		for(auto& key_section : world_page.m_sections)
+		{
+			const PageSection& section = key_section.second;
+			const vec3 position = section.m_spatial->absolute_position();
+			ShapeIndex offset = ShapeIndex(m_geometry.m_vertices.size());
+
+			for(const Vertex& vertex : section.m_geometry.m_vertices)
+				m_geometry.m_vertices.push_back({ position + vertex.m_position });
+
+			for(const Tri& tri : section.m_geometry.m_triangles)
+				m_geometry.m_triangles.push_back({ ShapeIndex(offset + tri.a), ShapeIndex(offset + tri.b), ShapeIndex(offset + tri.c) });
+
+			m_dirty = true;
+		}
+
+		range.m_vertices = uint32_t(m_geometry.m_vertices.size()) - range.m_vertex;
+		range.m_triangles = uint32_t(m_geometry.m_triangles.size()) - range.m_triangle;
+		if(range.m_vertices > 0)
+			m_blocks[navblock.m_spatial.m_handle] = range;
+	}
+
+	void Navmesh::remove_block(Navblock& navblock)
+	{
+		auto it = m_blocks.find(navblock.m_spatial.m_handle);
+		if(it == m_blocks.end())
+			return;
+
+		const BlockGeometry range = it->second;
+		m_blocks.erase(it);
+
+		vector<Vertex>& vertices = m_geometry.m_vertices;
+		vector<Tri>& triangles = m_geometry.m_triangles;
+		vertices.erase(vertices.begin() + range.m_vertex, vertices.begin() + range.m_vertex + range.m_vertices);
+		triangles.erase(triangles.begin() + range.m_triangle, triangles.begin() + range.m_triangle + range.m_triangles);
+
+		// the blocks added after this one move down
+		for(size_t i = range.m_triangle; i < triangles.size(); ++i)
+		{
+			triangles[i].a -= range.m_vertices;
+			triangles[i].b -= range.m_vertices;
+			triangles[i].c -= range.m_vertices;
+		}
+
+		for(auto& block : m_blocks)
+			if(block.second.m_vertex > range.m_vertex)
+			{
+				block.second.m_vertex -= range.m_vertices;
+				block.second.m_triangle -= range.m_triangles;
+			}
+
+		m_dirty = true;
+	}
+
+	void Navmesh::add_instances(const Spatial& spatial, const CompoundShape& compound)
+	{
+		// each shape is tessellated once, then copied at each of its placements
+		for(uint32_t i = 0; i < compound.m_shapes.size(); ++i)
+		{
+			const CollisionShape& shape = compound.m_shapes[i];
+			if(!shape.m_shape)
+				continue;
+
+			ProcShape proc = { Symbol(), shape.m_shape.get(), PLAIN };
+			ShapeSize size = symbol_triangle_size(proc);
+
+			Geometry geom;
+			geom.allocate(size.vertex_count, size.index_count);
+
+			span<Vertex> vertices = geom.vertices();
+			span<uint32_t> indices = geom.indices();
+			MeshAdapter data(Vertex::vertex_format, { vertices.data(), vertices.size() }, { indices.data(), indices.size() }, true);
+			symbol_draw_triangles(proc, data);
+
+			for(const CompoundShape::Child& child : compound.m_children)
+			{
+				if(child.m_shape != i)
+					continue;
+
+				ShapeIndex offset = ShapeIndex(m_geometry.m_vertices.size());
+
+				for(const Vertex& vertex : geom.m_vertices)
+					m_geometry.m_vertices.push_back({ spatial.m_position + child.m_position + rotate(child.m_rotation, shape.m_center + vertex.m_position) });
+
+				for(const Tri& tri : geom.m_triangles)
+					m_geometry.m_triangles.push_back({ ShapeIndex(offset + tri.a), ShapeIndex(offset + tri.b), ShapeIndex(offset + tri.c) });
+
+				m_dirty = true;
+			}
+		}
 	}
 
 	void Navmesh::next_frame(size_t tick, size_t delta)
@@ -228,9 +333,13 @@ namespace toy
 		UNUSED(tick); UNUSED(delta);
 		if(m_dirty)
 		{
-			this->build();
+			// cleared first : a build whose cache could not be loaded back asks for another one
 			m_dirty = false;
+			if(!m_geometry.m_vertices.empty())
+				this->build();
 		}
+
+		m_graph->update();
 	}
 
 	void Navmesh::build()
@@ -238,10 +347,30 @@ namespace toy
 		m_navgeom->build();
 
 		this->setupSettings();
-		this->handleBuild();
 
+		// tiles whose input did not change are added straight from the mapping of the previous bake
 		string name = m_world.m_name + ".nav";
-		this->save(name.c_str());
+		unique<NavmeshCache> previous = move(m_cache);
+		m_cache = make_unique<NavmeshCache>();
+		m_cache->open(name.c_str(), this->settings_hash());
+		m_tiles.clear();
+
+		this->handleBuild();
+
+		// the previous navmesh and its tiles are gone, its mapping can be released
+		previous = nullptr;
+
+		if(m_navmesh)
+			m_ground->setup(*m_navmesh);
+		else
+			m_ground->clear();
+
+		m_graph->m_dirty = true;
+
+		printf("[info] Navmesh built, %zu tiles reused from cache, %zu rebuilt\n", m_cache->m_hits, m_cache->m_misses);
+
+		if(m_cache->m_misses > 0 || m_tiles.size() != m_cache->m_tiles.size())
+			this->save(name.c_str());
 	}
 
 	void Navmesh::load()
@@ -252,123 +381,135 @@ namespace toy
 		this->load(name.c_str());
 	}
 
-	static const int NAVMESHSET_MAGIC = 'M'<<24 | 'S'<<16 | 'E'<<8 | 'T'; //'MSET';
-	static const int NAVMESHSET_VERSION = 1;
-
-	struct NavmeshSetHeader
+	bool Navmesh::load(const char* path)
 	{
-		int magic;
-		int version;
-		int numTiles;
-		dtNavMeshParams params;
-	};
+		unique<NavmeshCache> cache = make_unique<NavmeshCache>();
+		if(!cache->open(path))
+			return false;
+
+		dtNavMesh* navmesh = cache->load();
+		if(!navmesh)
+			return false;
+
+		dtFreeNavMesh(m_navmesh);
+		m_navmesh = navmesh;
+		m_version++;
+		m_cache = move(cache);
+		m_tiles = m_cache->m_tiles;
+
+		m_ground->setup(*m_navmesh);
+		m_graph->m_dirty = true;
+		return true;
+	}
 
-	struct NavmeshTileHeader
+	void Navmesh::save(const char* path)
 	{
-		dtTileRef tileRef;
-		int dataSize;
-	};
+		if(!m_navmesh) return;
 
-	void Navmesh::load(const char* path)
-	{
-		m_navmesh = this->_load(path);
+		// the tiles reused from the cache point into its mapping : when it maps the file being replaced, the mapping is released
+		// before the swap, and the navmesh is loaded back from the file, so that its tiles point into the new mapping
+		MappedFile* mapping = m_cache && m_cache->m_path == path && m_cache->m_file.m_data ? &m_cache->m_file : nullptr;
+		NavmeshCache::save(path, *m_navmesh, this->settings_hash(), m_tiles, mapping);
+		if(!mapping || this->load(path))
+			return;
+
+		// the file can't be read back : the tiles of the navmesh are gone with the mapping, it is built again
+		printf("[warning] Navmesh cache %s could not be loaded back, the navmesh is rebuilt\n", path);
+		dtFreeNavMesh(m_navmesh);
+		m_navmesh = nullptr;
+		m_version++;
+		m_cache = nullptr;
+		m_tiles.clear();
+		m_ground->clear();
+		m_dirty = true;
 	}
 
-	void Navmesh::save(const char* path)
+	// only the settings a tile is built with : the world bounds are left out, growing them must not invalidate the tiles that didn't change
+	uint64_t Navmesh::settings_hash() const
 	{
-		this->_save(path, m_navmesh);
+		const float floats[] = { m_cellSize, m_cellHeight, m_agentHeight, m_agentRadius, m_agentMaxClimb, m_agentMaxSlope, m_edgeMaxLen, m_edgeMaxError,
+								 m_detailSampleDist, m_detailSampleMaxError, m_tileSize };
+		const int ints[] = { m_regionMinSize, m_regionMergeSize, int(m_monotonePartitioning), m_vertsPerPoly, m_maxTiles, m_maxPolysPerTile };
+
+		uint64_t hash = hash_bytes(floats, sizeof(floats));
+		hash = hash_bytes(ints, sizeof(ints), hash);
+		hash = hash_bytes(&m_navgeom->m_volumeCount, sizeof(int), hash);
+		hash = hash_bytes(m_navgeom->m_volumes, m_navgeom->m_volumeCount * sizeof(ConvexVolume), hash);
+		return hash;
 	}
 
-	void Navmesh::_save(const char* path, const dtNavMesh* mesh)
+	uint64_t Navmesh::tile_hash(const float* bmin, const float* bmax) const
 	{
-		if(!mesh) return;
-	
-		FILE* fp = fopen(path, "wb");
-		if(!fp)
-			return;
-	
-		// Array header.
-		NavmeshSetHeader header;
-		header.magic = NAVMESHSET_MAGIC;
-		header.version = NAVMESHSET_VERSION;
-		header.numTiles = 0;
-		for(int i = 0; i < mesh->getMaxTiles(); ++i)
+		const rcChunkyTriMesh* chunky_mesh = m_navgeom->m_chunkyMesh.get();
+		if(!chunky_mesh)
+			return 0;
+
+		// same border as the one rasterized by buildTileMesh
+		const int walkable_radius = int(ceilf(m_agentRadius / m_cellSize));
+		const float border = float(walkable_radius + 3) * m_cellSize;
+
+		const vec2 tbmin = { bmin[0] - border, bmin[2] - border };
+		const vec2 tbmax = { bmax[0] + border, bmax[2] + border };
+
+		// every chunk overlapping the tile is hashed : a bounded list would miss the edits of the chunks past its end
+		vector<int> cid(size_t(chunky_mesh->nnodes));
+		const int ncid = rcGetChunksOverlappingRect(chunky_mesh, tbmin, tbmax, cid.data(), chunky_mesh->nnodes);
+
+		// the tile rect is hashed with its input : the grid of tiles moves with the world bounds, a cached tile only matches the same rect
+		uint64_t hash = hash_bytes(bmin, 3 * sizeof(float));
+		hash = hash_bytes(bmax, 3 * sizeof(float), hash);
+		hash = hash_bytes(&ncid, sizeof(int), hash);
+		for(int i = 0; i < ncid; ++i)
 		{
-			const dtMeshTile* tile = mesh->getTile(i);
-			if(!tile || !tile->header || !tile->dataSize) continue;
-			header.numTiles++;
+			const rcChunkyTriMeshNode& node = chunky_mesh->nodes[cid[i]];
+			const int* tris = &chunky_mesh->tris[node.i * 3];
+			for(int t = 0; t < node.n * 3; ++t)
+				hash = hash_bytes(&m_geometry.m_vertices[tris[t]].m_position, sizeof(vec3), hash);
 		}
-		memcpy(&header.params, mesh->getParams(), sizeof(dtNavMeshParams));
-		fwrite(&header, sizeof(NavmeshSetHeader), 1, fp);
+		return hash;
+	}
 
-		// Array tiles.
-		for(int i = 0; i < mesh->getMaxTiles(); ++i)
-		{
-			const dtMeshTile* tile = mesh->getTile(i);
-			if(!tile || !tile->header || !tile->dataSize) continue;
+	bool Navmesh::loadTile(const int tx, const int ty, const float* bmin, const float* bmax)
+	{
+		NavmeshCache::Tile tile;
+		tile.m_x = tx;
+		tile.m_y = ty;
+		tile.m_hash = this->tile_hash(bmin, bmax);
+		m_tiles.push_back(tile);
 
-			NavmeshTileHeader tileHeader;
-			tileHeader.tileRef = mesh->getTileRef(tile);
-			tileHeader.dataSize = tile->dataSize;
-			fwrite(&tileHeader, sizeof(tileHeader), 1, fp);
+		return m_cache && m_cache->add_tile(*m_navmesh, tx, ty, tile.m_hash);
+	}
 
-			fwrite(tile->data, tile->dataSize, 1, fp);
-		}
+	bool Navmesh::ground_height(const vec3& position, float end, float& height) const
+	{
+		return m_ground->ground_height(position, end, height);
+	}
+
+	vec3 Navmesh::ground_point(const vec3& start, const vec3& end)
+	{
+		float height;
+		if(start.x == end.x && start.z == end.z && this->ground_height(start, end.y, height))
+			return vec3(start.x, height, start.z);
 
-		fclose(fp);
+		Ray ray = { start, end, normalize(end - start), normalize(start - end) };
+		return as<PhysicWorld>(m_world.m_complex).ground_point(ray);
 	}
 
-	dtNavMesh* Navmesh::_load(const char* path)
+	size_t Navmesh::ground_points(span<vec3> points, float depth)
 	{
-		FILE* fp = fopen(path, "rb");
-		if(!fp) return 0;
-	
-		// Read header.
-		NavmeshSetHeader header;
-		fread(&header, sizeof(NavmeshSetHeader), 1, fp);
-		if(header.magic != NAVMESHSET_MAGIC)
-		{
-			fclose(fp);
-			return 0;
-		}
-		if(header.version != NAVMESHSET_VERSION)
+		size_t resolved = 0;
+		for(vec3& point : points)
 		{
-			fclose(fp);
-			return 0;
-		}
-	
-		dtNavMesh* mesh = dtAllocNavMesh();
-		if(!mesh)
-		{
-			fclose(fp);
-			return 0;
-		}
-		dtStatus status = mesh->init(&header.params);
-		if(dtStatusFailed(status))
-		{
-			fclose(fp);
-			return 0;
-		}
-		
-		// Read tiles.
-		for(int i = 0; i < header.numTiles; ++i)
-		{
-			NavmeshTileHeader tileHeader;
-			fread(&tileHeader, sizeof(tileHeader), 1, fp);
-			if(!tileHeader.tileRef || !tileHeader.dataSize)
-				break;
-
-			unsigned char* data = (unsigned char*)dtAlloc(tileHeader.dataSize, DT_ALLOC_PERM);
-			if(!data) break;
-			memset(data, 0, tileHeader.dataSize);
-			fread(data, tileHeader.dataSize, 1, fp);
-		
-			mesh->addTile(data, tileHeader.dataSize, DT_TILE_FREE_DATA, tileHeader.tileRef, 0);
+			float height;
+			if(this->ground_height(point, point.y - depth, height))
+			{
+				point.y = height;
+				++resolved;
+			}
+			else
+				point = this->ground_point(point, point - vec3(0.f, depth, 0.f));
 		}
-	
-		fclose(fp);
-	
-		return mesh;
+		return resolved;
 	}
 
 	NavmeshShape::NavmeshShape(Navmesh& navmesh)
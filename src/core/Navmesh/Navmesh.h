@@ -5,12 +5,16 @@
 
 #pragma once
 
+#include <stl/span.h>
+#include <stl/map.h>
 #include <geom/Shape/ProcShape.h>
 #include <core/Forward.h>
 #include <core/Spatial/Spatial.h>
 #include <core/WorldPage/WorldPage.h>
 #include <core/Navmesh/rcTileMesh.h>
 #include <core/Navmesh/NavGeom.h>
+#include <core/Navmesh/NavmeshCache.h>
+#include <core/Navmesh/GroundCache.h>
 
 namespace toy
 {
@@ -33,6 +37,8 @@ namespace toy
 		attr_ bool m_dirty = false;
 
 		void update_block(Navblock& navblock);
+		void remove_block(Navblock& navblock);
+		void add_instances(const Spatial& spatial, const CompoundShape& compound);
 
 		void next_frame(size_t tick, size_t delta);
 
@@ -40,11 +46,34 @@ namespace toy
 		void build();
 
 		void save(const char* path);
-		void load(const char* path);
+		bool load(const char* path);
 
-	private:
-		dtNavMesh* _load(const char* path);
-		void _save(const char* path, const dtNavMesh* mesh);
+		virtual bool loadTile(const int tx, const int ty, const float* bmin, const float* bmax) override;
+
+		uint64_t settings_hash() const;
+		uint64_t tile_hash(const float* bmin, const float* bmax) const;
+
+		// the mapped cache owns the data of the tiles loaded from it, it must outlive them
+		unique<NavmeshCache> m_cache;
+		vector<NavmeshCache::Tile> m_tiles;
+
+		// height of the first navmesh surface met going vertically from position to the height end, false when off-mesh
+		bool ground_height(const vec3& position, float end, float& height) const;
+
+		// ground point on the segment, from the navmesh when the segment is vertical and on-mesh, from a physics raycast otherwise
+		meth_ vec3 ground_point(const vec3& start, const vec3& end);
+
+		// moves each point down (or up) to the ground within depth, returns how many were resolved without physics
+		size_t ground_points(span<vec3> points, float depth);
+
+		unique<GroundCache> m_ground;
+
+		// coarse graph of the tile portals, for long distance paths
+		unique<PathGraph> m_graph;
+
+		// range of each block in the input geometry, keyed by the block entity, so that a block can be replaced or removed
+		struct BlockGeometry { uint32_t m_vertex; uint32_t m_vertices; uint32_t m_triangle; uint32_t m_triangles; };
+		map<uint32_t, BlockGeometry> m_blocks;
     };
 
 	class refl_ TOY_CORE_EXPORT Navblock
@@ -0,0 +1,307 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#include <core/Types.h>
+#include <core/Navmesh/NavmeshCache.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include <DetourNavMesh.h>
+#include <DetourAlloc.h>
+
+namespace toy
+{
+	MappedFile::MappedFile()
+	{}
+
+	MappedFile::~MappedFile()
+	{
+		this->close();
+	}
+
+#ifdef _WIN32
+	bool MappedFile::open(const char* path)
+	{
+		this->close();
+
+		m_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if(m_file == INVALID_HANDLE_VALUE)
+		{
+			m_file = nullptr;
+			return false;
+		}
+
+		LARGE_INTEGER size;
+		GetFileSizeEx(m_file, &size);
+		m_size = size_t(size.QuadPart);
+
+		m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+		if(m_mapping)
+			m_data = (unsigned char*)MapViewOfFile(m_mapping, FILE_MAP_COPY, 0, 0, 0);
+
+		if(!m_data)
+		{
+			this->close();
+			return false;
+		}
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if(m_data) UnmapViewOfFile(m_data);
+		if(m_mapping) CloseHandle(m_mapping);
+		if(m_file) CloseHandle(m_file);
+		m_data = nullptr;
+		m_mapping = nullptr;
+		m_file = nullptr;
+		m_size = 0;
+	}
+#else
+	bool MappedFile::open(const char* path)
+	{
+		this->close();
+
+		m_file = ::open(path, O_RDONLY);
+		if(m_file < 0)
+			return false;
+
+		struct stat st;
+		if(fstat(m_file, &st) != 0 || st.st_size == 0)
+		{
+			this->close();
+			return false;
+		}
+
+		m_size = size_t(st.st_size);
+		void* data = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, m_file, 0);
+		if(data == MAP_FAILED)
+		{
+			this->close();
+			return false;
+		}
+
+		m_data = (unsigned char*)data;
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if(m_data) munmap(m_data, m_size);
+		if(m_file >= 0) ::close(m_file);
+		m_data = nullptr;
+		m_file = -1;
+		m_size = 0;
+	}
+#endif
+
+	static const uint32_t NAVMESHCACHE_MAGIC = 'N'<<24 | 'T'<<16 | 'C'<<8 | 'H'; //'NTCH';
+	static const uint32_t NAVMESHCACHE_VERSION = 2;
+	static const uint64_t NAVMESHCACHE_ALIGN = 16;
+
+	struct NavmeshCacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t numTiles;
+		uint32_t padding;
+		uint64_t settings;
+		dtNavMeshParams params;
+	};
+
+	NavmeshCache::NavmeshCache()
+	{}
+
+	NavmeshCache::~NavmeshCache()
+	{}
+
+	bool NavmeshCache::open(const char* path, uint64_t settings)
+	{
+		this->close();
+		m_path = path;
+
+		if(!m_file.open(path))
+			return false;
+
+		if(m_file.m_size < sizeof(NavmeshCacheHeader))
+		{
+			this->close();
+			return false;
+		}
+
+		const NavmeshCacheHeader& header = *(const NavmeshCacheHeader*)m_file.m_data;
+		const size_t index_end = sizeof(NavmeshCacheHeader) + header.numTiles * sizeof(Tile);
+		if(header.magic != NAVMESHCACHE_MAGIC || header.version != NAVMESHCACHE_VERSION || index_end > m_file.m_size)
+		{
+			printf("[warning] Navmesh cache %s is invalid or outdated\n", path);
+			this->close();
+			return false;
+		}
+
+		// different build settings invalidate every tile
+		if(settings != 0 && header.settings != settings)
+		{
+			this->close();
+			return false;
+		}
+
+		m_settings = header.settings;
+
+		const Tile* tiles = (const Tile*)(m_file.m_data + sizeof(NavmeshCacheHeader));
+		m_tiles.assign(tiles, tiles + header.numTiles);
+
+		for(const Tile& tile : m_tiles)
+			if(tile.m_offset + tile.m_size > m_file.m_size)
+			{
+				printf("[warning] Navmesh cache %s is truncated\n", path);
+				this->close();
+				return false;
+			}
+
+		return true;
+	}
+
+	void NavmeshCache::close()
+	{
+		m_file.close();
+		m_tiles.clear();
+		m_settings = 0;
+	}
+
+	const NavmeshCache::Tile* NavmeshCache::find(int x, int y, int layer) const
+	{
+		for(const Tile& tile : m_tiles)
+			if(tile.m_x == x && tile.m_y == y && tile.m_layer == layer)
+				return &tile;
+		return nullptr;
+	}
+
+	bool NavmeshCache::add_tile(dtNavMesh& navmesh, const Tile& tile)
+	{
+		if(tile.m_size == 0)
+			return true;
+
+		unsigned char* data = m_file.m_data + tile.m_offset;
+		dtStatus status = navmesh.addTile(data, int(tile.m_size), 0, 0, 0);
+		return !dtStatusFailed(status);
+	}
+
+	bool NavmeshCache::add_tile(dtNavMesh& navmesh, int x, int y, uint64_t hash)
+	{
+		const Tile* tile = this->find(x, y);
+		if(!tile || tile->m_hash != hash)
+		{
+			m_misses++;
+			return false;
+		}
+
+		navmesh.removeTile(navmesh.getTileRefAt(x, y, 0), 0, 0);
+		if(!this->add_tile(navmesh, *tile))
+		{
+			m_misses++;
+			return false;
+		}
+
+		m_hits++;
+		return true;
+	}
+
+	dtNavMesh* NavmeshCache::load()
+	{
+		if(!m_file.m_data)
+			return nullptr;
+
+		const NavmeshCacheHeader& header = *(const NavmeshCacheHeader*)m_file.m_data;
+
+		dtNavMesh* mesh = dtAllocNavMesh();
+		if(!mesh)
+			return nullptr;
+
+		dtStatus status = mesh->init(&header.params);
+		if(dtStatusFailed(status))
+		{
+			dtFreeNavMesh(mesh);
+			return nullptr;
+		}
+
+		for(const Tile& tile : m_tiles)
+			this->add_tile(*mesh, tile);
+
+		return mesh;
+	}
+
+	bool NavmeshCache::save(const char* path, const dtNavMesh& navmesh, uint64_t settings, const vector<Tile>& built, MappedFile* mapping)
+	{
+		auto align = [](uint64_t offset) { return (offset + NAVMESHCACHE_ALIGN - 1) & ~(NAVMESHCACHE_ALIGN - 1); };
+
+		NavmeshCacheHeader header = {};
+		header.magic = NAVMESHCACHE_MAGIC;
+		header.version = NAVMESHCACHE_VERSION;
+		header.numTiles = uint32_t(built.size());
+		header.settings = settings;
+		memcpy(&header.params, navmesh.getParams(), sizeof(dtNavMeshParams));
+
+		vector<Tile> tiles = built;
+		vector<const dtMeshTile*> sources(tiles.size(), nullptr);
+
+		uint64_t offset = align(sizeof(NavmeshCacheHeader) + tiles.size() * sizeof(Tile));
+		for(size_t i = 0; i < tiles.size(); ++i)
+		{
+			const dtMeshTile* tile = navmesh.getTileAt(tiles[i].m_x, tiles[i].m_y, tiles[i].m_layer);
+			sources[i] = tile && tile->header && tile->dataSize ? tile : nullptr;
+			tiles[i].m_size = sources[i] ? uint32_t(tile->dataSize) : 0U;
+			tiles[i].m_offset = sources[i] ? offset : 0U;
+			offset = align(offset + tiles[i].m_size);
+		}
+
+		// write aside then swap, so that a crash never leaves a truncated cache
+		string temp = string(path) + ".tmp";
+		FILE* fp = fopen(temp.c_str(), "wb");
+		if(!fp)
+			return false;
+
+		static const unsigned char zeros[NAVMESHCACHE_ALIGN] = {};
+		auto pad = [&](uint64_t position) { uint64_t size = align(position) - position; if(size) fwrite(zeros, size_t(size), 1, fp); };
+
+		fwrite(&header, sizeof(NavmeshCacheHeader), 1, fp);
+		if(!tiles.empty())
+			fwrite(tiles.data(), sizeof(Tile), tiles.size(), fp);
+		pad(sizeof(NavmeshCacheHeader) + tiles.size() * sizeof(Tile));
+
+		for(size_t i = 0; i < tiles.size(); ++i)
+			if(sources[i])
+			{
+				fwrite(sources[i]->data, tiles[i].m_size, 1, fp);
+				pad(tiles[i].m_offset + tiles[i].m_size);
+			}
+
+		bool success = ferror(fp) == 0;
+		fclose(fp);
+
+		// the tiles were written from the mapping : it can only be released now
+		if(mapping && success)
+			mapping->close();
+
+#ifdef _WIN32
+		success = success && MoveFileExA(temp.c_str(), path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		success = success && rename(temp.c_str(), path) == 0;
+#endif
+		if(!success)
+			remove(temp.c_str());
+		return success;
+	}
+}
@@ -0,0 +1,88 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#pragma once
+
+#include <stl/vector.h>
+#include <stl/string.h>
+#include <core/Forward.h>
+
+#include <stdint.h>
+
+class dtNavMesh;
+
+namespace toy
+{
+	// read-write, copy-on-write mapping of a whole file : detour patches links in the tile data it is given
+	class TOY_CORE_EXPORT MappedFile
+	{
+	public:
+		MappedFile();
+		~MappedFile();
+
+		MappedFile(const MappedFile& other) = delete;
+		MappedFile& operator=(const MappedFile& other) = delete;
+
+		bool open(const char* path);
+		void close();
+
+		unsigned char* m_data = nullptr;
+		size_t m_size = 0;
+
+	private:
+#ifdef _WIN32
+		void* m_file = nullptr;
+		void* m_mapping = nullptr;
+#else
+		int m_file = -1;
+#endif
+	};
+
+	/* Navmesh tile cache file :
+		- header : magic, version, tile count, settings hash, navmesh params
+		- tile index : coordinate, hash of the tile input geometry, offset and size of the data
+		- tile data, each tile aligned on 16 bytes
+	*/
+
+	class TOY_CORE_EXPORT NavmeshCache
+	{
+	public:
+		NavmeshCache();
+		~NavmeshCache();
+
+		struct Tile
+		{
+			int32_t m_x = 0;
+			int32_t m_y = 0;
+			int32_t m_layer = 0;
+			uint32_t m_size = 0;
+			uint64_t m_hash = 0;
+			uint64_t m_offset = 0;
+		};
+
+		string m_path;
+		MappedFile m_file;
+
+		uint64_t m_settings = 0;
+		vector<Tile> m_tiles;
+
+		size_t m_hits = 0;
+		size_t m_misses = 0;
+
+		bool open(const char* path, uint64_t settings = 0);
+		void close();
+
+		const Tile* find(int x, int y, int layer = 0) const;
+
+		// adds the tile to the navmesh straight from the mapping, the data is not copied nor owned by the navmesh
+		bool add_tile(dtNavMesh& navmesh, const Tile& tile);
+		bool add_tile(dtNavMesh& navmesh, int x, int y, uint64_t hash);
+
+		dtNavMesh* load();
+
+		// the mapping of the file being replaced, if any, is released before the swap : a mapped file can't be replaced on windows
+		static bool save(const char* path, const dtNavMesh& navmesh, uint64_t settings, const vector<Tile>& tiles, MappedFile* mapping = nullptr);
+	};
+}
@@ -138,6 +138,7 @@ namespace toy
 
 		dtFreeNavMesh(m_navmesh);
 		m_navmesh = 0;
+		m_version++;
 	}
 
 	bool rcTileMesh::handleBuild()
@@ -151,6 +152,7 @@ namespace toy
 		dtFreeNavMesh(m_navmesh);
 
 		m_navmesh = dtAllocNavMesh();
+		m_version++;
 		if(!m_navmesh)
 		{
 			m_ctx->log(RC_LOG_ERROR, "buildTiledNavigation: Could not allocate navmesh.");
@@ -281,6 +283,9 @@ namespace toy
 				m_tileBmax[0] = bmin[0] + (x+1)*tcs;
 				m_tileBmax[1] = bmax[1];
 				m_tileBmax[2] = bmin[2] + (y+1)*tcs;
+
+				if(loadTile(x, y, m_tileBmin, m_tileBmax))
+					continue;
 			
 				int dataSize = 0;
 				unsigned char* data = buildTileMesh(x, y, m_tileBmin, m_tileBmax, dataSize);
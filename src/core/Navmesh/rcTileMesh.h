@@ -87,6 +87,8 @@ namespace toy
 
 		Geometry m_geometry;
 		dtNavMesh* m_navmesh = nullptr;
+		// incremented each time the navmesh is replaced : a new navmesh can be allocated at the address of the freed one
+		size_t m_version = 0;
 		unique<NavGeom> m_navgeom;
 		unsigned char* m_triareas = nullptr;
 		rcHeightfield* m_solid = nullptr;
@@ -118,6 +120,9 @@ namespace toy
 
 		virtual void handleMeshChanged(Geometry& geom);
 		virtual bool handleBuild();
+
+		// lets a derived mesh provide a tile without building it, e.g from a cache
+		virtual bool loadTile(const int tx, const int ty, const float* bmin, const float* bmax) { UNUSED(tx); UNUSED(ty); UNUSED(bmin); UNUSED(bmax); return false; }
 	
 		void getTilePos(const float* pos, int& tx, int& ty);
 	
@@ -0,0 +1,209 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#ifdef TWO_MODULES
+module toy.core
+#else
+#include <ecs/ECS.hpp>
+#include <math/Timer.h>
+#include <core/Types.h>
+#include <core/Path/Crowd.h>
+#include <core/Spatial/Spatial.h>
+#include <core/Movable/Movable.h>
+#include <core/Navmesh/Navmesh.h>
+#include <core/World/World.hpp>
+#include <core/World/Section.h>
+#endif
+
+#include <DetourNavMesh.h>
+#include <DetourNavMeshQuery.h>
+#include <DetourCrowd.h>
+#include <DetourCommon.h>
+
+namespace toy
+{
+	CrowdAgent::CrowdAgent(HSpatial spatial, HMovable movable, Crowd& crowd, float radius, float speed)
+		: m_spatial(spatial)
+		, m_movable(movable)
+		, m_crowd(&crowd)
+		, m_radius(radius)
+		, m_speed(speed)
+	{}
+
+	void CrowdAgent::set_target(const vec3& target)
+	{
+		m_target = target;
+		m_moving = true;
+		m_target_dirty = true;
+	}
+
+	void CrowdAgent::stop()
+	{
+		m_moving = false;
+		m_target_dirty = true;
+	}
+
+	void CrowdAgent::next_frame(Spatial& spatial, Movable& movable, size_t tick, size_t delta)
+	{
+		UNUSED(tick); UNUSED(delta);
+		if(!m_crowd || m_index < 0)
+			return;
+
+		// vertical velocity stays with physics, the crowd only steers on the ground plane
+		const vec3 velocity = m_crowd->agent_velocity(m_index);
+		movable.set_linear_velocity(vec3(velocity.x, movable.m_linear_velocity.y, velocity.z));
+
+		if(length2(vec2(velocity.x, velocity.z)) > 0.01f)
+			spatial.set_rotation(look_at(vec3(0.f), vec3(velocity.x, 0.f, velocity.z)));
+	}
+
+	Crowd::Crowd(World& world, Navmesh& navmesh, size_t max_agents, float max_radius)
+		: m_world(world)
+		, m_navmesh(navmesh)
+		, m_max_agents(max_agents)
+		, m_max_radius(max_radius)
+		, m_crowd(make_unique<dtCrowd>())
+		, m_query(make_unique<dtNavMeshQuery>())
+		, m_touched(max_agents, 0)
+	{
+		// the steps belong to the crowd, they are removed along with it
+		m_world.m_pump.m_owner = this;
+		m_world.m_pump.add_step({ Task::Spatial, [&](size_t tick, size_t delta) { this->next_frame(tick, delta); } });
+		m_world.add_parallel_loop<CrowdAgent, Spatial, Movable>(Task::Spatial);
+		m_world.m_pump.m_owner = nullptr;
+	}
+
+	Crowd::~Crowd()
+	{
+		m_world.m_pump.remove_steps((void*)this);
+
+		m_world.m_ecs.loop<CrowdAgent>([&](CrowdAgent& agent)
+		{
+			if(agent.m_crowd == this)
+			{
+				agent.m_crowd = nullptr;
+				agent.m_index = -1;
+			}
+		});
+	}
+
+	bool Crowd::setup()
+	{
+		if(!m_navmesh.m_navmesh)
+			return false;
+
+		if(m_setup == m_navmesh.m_version)
+			return true;
+
+		// the navmesh was rebuilt : every agent has to be registered again
+		m_crowd->init(int(m_max_agents), m_max_radius, m_navmesh.m_navmesh);
+		m_query->init(m_navmesh.m_navmesh, 2048);
+
+		m_world.m_ecs.loop<CrowdAgent>([&](CrowdAgent& agent)
+		{
+			if(agent.m_crowd == this)
+			{
+				agent.m_index = -1;
+				agent.m_target_dirty = agent.m_moving;
+			}
+		});
+
+		m_setup = m_navmesh.m_version;
+		return true;
+	}
+
+	vec3 Crowd::agent_velocity(int index) const
+	{
+		const dtCrowdAgent* agent = m_crowd->getAgent(index);
+		return agent && agent->active ? vec3(agent->vel[0], agent->vel[1], agent->vel[2]) : vec3(0.f);
+	}
+
+	int Crowd::add_agent(CrowdAgent& agent, const vec3& position)
+	{
+		dtCrowdAgentParams params = {};
+		params.radius = agent.m_radius;
+		params.height = m_navmesh.m_agentHeight;
+		params.maxAcceleration = agent.m_speed * 2.f;
+		params.maxSpeed = agent.m_speed;
+		params.collisionQueryRange = params.radius * 12.f;
+		params.pathOptimizationRange = params.radius * 30.f;
+		params.separationWeight = 2.f;
+		params.updateFlags = DT_CROWD_ANTICIPATE_TURNS | DT_CROWD_OPTIMIZE_VIS | DT_CROWD_OPTIMIZE_TOPO | DT_CROWD_OBSTACLE_AVOIDANCE | DT_CROWD_SEPARATION;
+		params.obstacleAvoidanceType = 3;
+		params.queryFilterType = 0;
+
+		return m_crowd->addAgent(value_ptr(position), &params);
+	}
+
+	void Crowd::sync_agent(CrowdAgent& agent, const vec3& position)
+	{
+		// physics stays authoritative on positions : pull the agent back where its spatial actually is
+		dtCrowdAgent* crowd_agent = m_crowd->getEditableAgent(agent.m_index);
+		if(dtVdist2DSqr(crowd_agent->npos, value_ptr(position)) > 0.0001f)
+		{
+			crowd_agent->corridor.movePosition(value_ptr(position), m_query.get(), m_crowd->getFilter(0));
+			dtVcopy(crowd_agent->npos, crowd_agent->corridor.getPos());
+		}
+	}
+
+	void Crowd::next_frame(size_t tick, size_t delta)
+	{
+		UNUSED(tick);
+		if(!this->setup())
+			return;
+
+		double start = m_clock.read();
+		++m_frame;
+
+		size_t requests = 0;
+		const float extents[3] = { m_max_radius, m_navmesh.m_agentHeight, m_max_radius };
+
+		m_world.m_ecs.loop<CrowdAgent, Spatial>([&](CrowdAgent& agent, Spatial& spatial)
+		{
+			if(agent.m_crowd != this)
+				return;
+
+			if(agent.m_index < 0)
+				agent.m_index = this->add_agent(agent, spatial.m_position);
+			if(agent.m_index < 0)
+				return;
+
+			m_touched[agent.m_index] = m_frame;
+			this->sync_agent(agent, spatial.m_position);
+
+			if(!agent.m_target_dirty || requests >= m_max_requests)
+				return;
+
+			if(agent.m_moving)
+			{
+				dtPolyRef poly = 0;
+				float target[3];
+				m_query->findNearestPoly(value_ptr(agent.m_target), extents, m_crowd->getFilter(0), &poly, target);
+				if(poly)
+					m_crowd->requestMoveTarget(agent.m_index, poly, target);
+			}
+			else
+				m_crowd->resetMoveTarget(agent.m_index);
+
+			agent.m_target_dirty = false;
+			++requests;
+		});
+
+		// agents whose entity is gone were not visited this frame
+		m_active_agents = 0;
+		for(int i = 0; i < m_crowd->getAgentCount(); ++i)
+			if(m_crowd->getAgent(i)->active)
+			{
+				if(m_touched[i] != m_frame)
+					m_crowd->removeAgent(i);
+				else
+					++m_active_agents;
+			}
+
+		m_crowd->update(float(delta * c_tick_interval), nullptr);
+
+		m_update_time = float(m_clock.read() - start);
+	}
+}
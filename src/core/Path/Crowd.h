@@ -0,0 +1,82 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#pragma once
+
+#include <stl/vector.h>
+#include <stl/memory.h>
+#include <math/Vec.h>
+#include <math/Timer.h>
+#include <core/Forward.h>
+#include <core/Spatial/Spatial.h>
+
+class dtCrowd;
+class dtNavMesh;
+class dtNavMeshQuery;
+
+namespace toy
+{
+	class refl_ TOY_CORE_EXPORT CrowdAgent
+	{
+	public:
+		constr_ CrowdAgent() {}
+		constr_ CrowdAgent(HSpatial spatial, HMovable movable, Crowd& crowd, float radius = 0.35f, float speed = 3.f);
+
+		comp_ HSpatial m_spatial;
+		comp_ HMovable m_movable;
+
+		Crowd* m_crowd = nullptr;
+		int m_index = -1;
+
+		attr_ float m_radius = 0.35f;
+		attr_ float m_speed = 3.f;
+
+		attr_ vec3 m_target = vec3(0.f);
+		attr_ bool m_moving = false;
+		bool m_target_dirty = false;
+
+		meth_ void set_target(const vec3& target);
+		meth_ void stop();
+
+		void next_frame(Spatial& spatial, Movable& movable, size_t tick, size_t delta);
+	};
+
+	class TOY_CORE_EXPORT Crowd
+	{
+	public:
+		Crowd(World& world, Navmesh& navmesh, size_t max_agents = 10000U, float max_radius = 1.f);
+		~Crowd();
+
+		World& m_world;
+		Navmesh& m_navmesh;
+
+		size_t m_max_agents;
+		float m_max_radius;
+
+		// how many new move requests are submitted to detour each frame, the rest waits for the next frames
+		size_t m_max_requests = 64U;
+
+		unique<dtCrowd> m_crowd;
+		unique<dtNavMeshQuery> m_query;
+
+		float m_update_time = 0.f;
+		size_t m_active_agents = 0;
+
+		vec3 agent_velocity(int index) const;
+
+		void next_frame(size_t tick, size_t delta);
+
+	private:
+		bool setup();
+		int add_agent(CrowdAgent& agent, const vec3& position);
+		void sync_agent(CrowdAgent& agent, const vec3& position);
+
+		Clock m_clock;
+		// version of the navmesh the crowd was set up for
+		size_t m_setup = SIZE_MAX;
+		size_t m_frame = 0;
+		vector<size_t> m_touched;
+	};
+}
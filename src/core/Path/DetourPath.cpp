@@ -14,6 +14,7 @@ module toy.core
 #endif
 
 #include <DetourNavMeshQuery.h>
+#include <DetourPathCorridor.h>
 
 namespace toy
 {
@@ -29,11 +30,23 @@ namespace toy
 		: m_pathfinder(pathfinder)
 		, m_origin(origin)
 		, m_destination(destination)
+		, m_corridor(make_unique<dtPathCorridor>())
+	{
+		m_corridor->init(int(m_pathfinder.m_max_polys));
+
+		// reserve once so that re-pathing never reallocates
+		m_path.reserve(m_pathfinder.m_max_waypoints);
+		m_waypoints.reserve(m_pathfinder.m_max_waypoints);
+		m_poly_path.reserve(m_pathfinder.m_max_waypoints);
+	}
+
+	DetourPath::~DetourPath()
 	{}
 	
 	void DetourPath::clear()
 	{
 		m_currentPoly = 0;
+		m_path.clear();
 		m_waypoints.clear();
 		m_poly_path.clear();
 	}
@@ -41,36 +54,129 @@ namespace toy
 	bool DetourPath::compute()
 	{
 		dtNavMeshQuery& query = *m_pathfinder.m_query;
-		dtQueryFilter& filter = *m_pathfinder.m_filter;
 
 		this->clear();
+		m_computes++;
+		m_planned = m_destination;
 
-		vec3 extents = { 0.0f, 2.0f, 0.0f };
 		dtPolyRef start_poly;
 		dtPolyRef end_poly;
 		vec3 start_pos;
 		vec3 end_pos;
 
-		if(!query.findNearestPoly(&m_origin[0], &extents[0], &filter, &start_poly, &start_pos[0]))
+		if(!m_pathfinder.find_poly(m_origin, start_poly, start_pos))
 			return false;
 
-		if(!query.findNearestPoly(&m_destination[0], &extents[0], &filter, &end_poly, &end_pos[0]))
+		if(!m_pathfinder.find_poly(m_destination, end_poly, end_pos))
 			return false;
 
-		vector<dtPolyRef> poly_path(m_pathfinder.m_max_polys);
-		int polyCount = 0;
+		int count = 0;
+		if(!m_pathfinder.find_path(start_poly, end_poly, start_pos, end_pos, count))
+			return false;
+
+		const dtPolyRef* polys = m_pathfinder.m_polys.data();
+
+		// partial path : aim for the closest reachable point
+		m_complete = polys[count - 1] == end_poly;
+		if(!m_complete)
+			query.closestPointOnPoly(polys[count - 1], value_ptr(end_pos), value_ptr(end_pos), nullptr);
+
+		m_corridor->reset(start_poly, value_ptr(start_pos));
+		m_corridor->setCorridor(value_ptr(end_pos), polys, count);
+
+		return this->straighten();
+	}
+
+	bool DetourPath::update(const vec3& origin, const vec3& destination)
+	{
+		dtNavMeshQuery& query = *m_pathfinder.m_query;
+		dtQueryFilter& filter = *m_pathfinder.m_filter;
+
+		m_origin = origin;
+		m_destination = destination;
+
+		if(m_corridor->getPathCount() == 0)
+			return this->compute();
+
+		static const float c_replan_distance = 2.f;
+		static const int c_max_look_ahead = 10;
+		static const int c_refine_ahead = 8;
+
+		auto distance2d = [](const float* a, const vec3& b) { return length(vec2(a[0] - b.x, a[2] - b.z)); };
+
+		// moves along the surface only cover local displacements, a teleport or a far target needs a full replan
+		const bool moved = m_corridor->movePosition(value_ptr(origin), &query, &filter);
+		const bool retargeted = !m_complete || m_corridor->moveTargetPosition(value_ptr(destination), &query, &filter);
+
+		if(!moved || !retargeted
+		|| distance2d(m_corridor->getPos(), origin) > c_replan_distance
+		|| (m_complete && distance2d(m_corridor->getTarget(), destination) > c_replan_distance)
+		|| (!m_complete && length(vec2(m_planned.x - destination.x, m_planned.z - destination.z)) > c_replan_distance))
+			return this->compute();
+
+		// a partial corridor is extended when the agent nears its end
+		if(!m_complete && m_corridor->getPathCount() <= c_refine_ahead)
+			return this->compute();
 
-		if(!query.findPath(start_poly, end_poly, &start_pos[0], &end_pos[0], &filter, poly_path.data(), &polyCount, int(m_pathfinder.m_max_polys)))
+		if(!m_corridor->isValid(c_max_look_ahead, &query, &filter))
+		{
+			vec3 safe_pos = { m_corridor->getPos()[0], m_corridor->getPos()[1], m_corridor->getPos()[2] };
+			dtPolyRef safe_ref = m_corridor->getFirstPoly();
+			if(!m_corridor->trimInvalidPath(safe_ref, value_ptr(safe_pos), &query, &filter) || m_corridor->getPathCount() == 0)
+				return this->compute();
+		}
+
+		m_repairs++;
+		return this->straighten();
+	}
+
+	void DetourPath::optimize(float range)
+	{
+		dtNavMeshQuery& query = *m_pathfinder.m_query;
+		dtQueryFilter& filter = *m_pathfinder.m_filter;
+
+		if(m_corridor->getPathCount() < 2)
+			return;
+
+		vector<vec3>& corners = m_pathfinder.m_points;
+		const int count = m_corridor->findCorners(value_ptr(corners[0]), m_pathfinder.m_point_flags.data(), m_pathfinder.m_point_refs.data(), int(corners.size()), &query, &filter);
+
+		if(count > 0)
+			m_corridor->optimizePathVisibility(value_ptr(corners[min(1, count - 1)]), range, &query, &filter);
+
+		m_corridor->optimizePathTopology(&query, &filter);
+
+		this->straighten();
+	}
+
+	bool DetourPath::move_over_offmesh(dtPolyRef offmesh, vec3& start, vec3& end)
+	{
+		dtPolyRef refs[2];
+		if(!m_corridor->moveOverOffmeshConnection(offmesh, refs, value_ptr(start), value_ptr(end), m_pathfinder.m_query.get()))
 			return false;
 
-		vector<vec3> point_path(m_pathfinder.m_max_waypoints);
-		vector<dtPolyRef> poly_refs(m_pathfinder.m_max_waypoints);
+		return this->straighten();
+	}
 
-		int count;
+	bool DetourPath::straighten()
+	{
+		dtNavMeshQuery& query = *m_pathfinder.m_query;
 
-		if(!query.findStraightPath(&start_pos[0], &end_pos[0], poly_path.data(), polyCount, value_ptr(point_path[0]), 0, poly_refs.data(), &count, int(m_pathfinder.m_max_waypoints)))
+		m_path.clear();
+		m_waypoints.clear();
+		m_poly_path.clear();
+
+		vector<vec3>& point_path = m_pathfinder.m_points;
+		vector<dtPolyRef>& poly_refs = m_pathfinder.m_point_refs;
+
+		int count = 0;
+		dtStatus status = query.findStraightPath(m_corridor->getPos(), m_corridor->getTarget(), m_corridor->getPath(), m_corridor->getPathCount(),
+												 value_ptr(point_path[0]), m_pathfinder.m_point_flags.data(), poly_refs.data(), &count, int(point_path.size()));
+		if(dtStatusFailed(status))
 			return false;
 
+		m_currentPoly = m_corridor->getFirstPoly();
+
 		for(int i = count - 1; i >= 0; i--)
 			m_path.push_back(point_path[i]);
 
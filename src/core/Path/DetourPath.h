@@ -11,6 +11,8 @@
 #include <core/Forward.h>
 #include <core/Spatial/Spatial.h>
 
+class dtPathCorridor;
+
 namespace toy
 {
 	typedef unsigned int dtPolyRef;
@@ -27,6 +29,7 @@ namespace toy
     {
 	public:
 		DetourPath(Pathfinder& pathfinder, const vec3& origin, const vec3& destination);
+		~DetourPath();
 
 		Pathfinder& m_pathfinder;
 
@@ -37,10 +40,27 @@ namespace toy
 		vector<vec3> m_waypoints;
 		vector<dtPolyRef> m_poly_path;
 
+		// the polygon corridor is kept across frames and repaired locally when origin or destination move
+		unique<dtPathCorridor> m_corridor;
+
+		// false while the corridor only covers the first part of a long path
+		bool m_complete = false;
+		// destination the corridor was last computed for : a partial corridor doesn't follow its target, it is computed again when it moves away
+		vec3 m_planned = vec3(0.f);
+
+		size_t m_computes = 0;
+		size_t m_repairs = 0;
+
 		void clear();
 		bool compute();
 
+		bool update(const vec3& origin, const vec3& destination);
+		void optimize(float range = 30.f);
+		bool move_over_offmesh(dtPolyRef offmesh, vec3& start, vec3& end);
+
 	private:
-		dtPolyRef m_currentPoly;
+		bool straighten();
+
+		dtPolyRef m_currentPoly = 0;
     };
 }
@@ -0,0 +1,441 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#include <core/Types.h>
+#include <core/Path/PathGraph.h>
+#include <core/Navmesh/Navmesh.h>
+
+#include <algorithm>
+
+#include <DetourNavMesh.h>
+#include <DetourNavMeshQuery.h>
+#include <DetourCommon.h>
+
+#include <float.h>
+
+namespace toy
+{
+	static uint64_t tile_key(int x, int y)
+	{
+		return uint64_t(uint32_t(x)) << 32 | uint64_t(uint32_t(y));
+	}
+
+	static const uint32_t c_no_node = UINT32_MAX;
+
+	PathGraph::PathGraph(Navmesh& navmesh)
+		: m_navmesh(navmesh)
+		, m_query(make_unique<dtNavMeshQuery>())
+		, m_filter(make_unique<dtQueryFilter>())
+		, m_polys(256)
+		, m_points(64)
+	{
+		m_filter->setIncludeFlags(0xFFFF);
+		m_filter->setExcludeFlags(0);
+	}
+
+	PathGraph::~PathGraph()
+	{}
+
+	void PathGraph::update()
+	{
+		const dtNavMesh* navmesh = m_navmesh.m_navmesh;
+		if(!m_dirty || !navmesh)
+			return;
+
+		if(m_setup_version != m_navmesh.m_version)
+		{
+			// local searches stay within a few tiles, a small node pool bounds their cost
+			m_query->init(navmesh, 4096);
+			m_setup = navmesh;
+			m_setup_version = m_navmesh.m_version;
+		}
+
+		++m_visit;
+		size_t updates = 0;
+		bool done = true;
+
+		for(const NavmeshCache::Tile& built : m_navmesh.m_tiles)
+		{
+			Tile& tile = m_tiles[tile_key(built.m_x, built.m_y)];
+			tile.m_visited = m_visit;
+
+			// tiles whose input is unchanged keep their portals, even if the navmesh was rebuilt around them
+			if(tile.m_valid && tile.m_hash == built.m_hash)
+				continue;
+
+			if(updates >= m_max_updates)
+			{
+				done = false;
+				continue;
+			}
+
+			tile.m_coord = ivec2(built.m_x, built.m_y);
+			tile.m_hash = built.m_hash;
+			tile.m_valid = true;
+			this->update_tile(tile);
+			++updates;
+		}
+
+		for(auto it = m_tiles.begin(); it != m_tiles.end();)
+		{
+			if(it->second.m_visited != m_visit)
+			{
+				this->remove_portals(it->second);
+				it = m_tiles.erase(it);
+			}
+			else
+				++it;
+		}
+
+		m_dirty = !done;
+	}
+
+	bool PathGraph::tile_coord(dtPolyRef poly, ivec2& coord) const
+	{
+		const dtMeshTile* tile = nullptr;
+		const dtPoly* mesh_poly = nullptr;
+		if(!m_setup || dtStatusFailed(m_setup->getTileAndPolyByRef(poly, &tile, &mesh_poly)))
+			return false;
+
+		coord = ivec2(tile->header->x, tile->header->y);
+		return true;
+	}
+
+	PathGraph::Tile* PathGraph::find_tile(const ivec2& coord)
+	{
+		auto it = m_tiles.find(tile_key(coord.x, coord.y));
+		return it != m_tiles.end() && it->second.m_valid ? &it->second : nullptr;
+	}
+
+	dtPolyRef PathGraph::portal_ref(const Portal& portal) const
+	{
+		const dtMeshTile* tile = m_setup->getTileAt(portal.m_tile.x, portal.m_tile.y, 0);
+		return tile ? m_setup->getPolyRefBase(tile) | dtPolyRef(portal.m_poly) : 0;
+	}
+
+	void PathGraph::update_tile(Tile& tile)
+	{
+		this->remove_portals(tile);
+
+		const dtMeshTile* mesh_tile = m_setup->getTileAt(tile.m_coord.x, tile.m_coord.y, 0);
+		if(!mesh_tile || !mesh_tile->header)
+			return;
+
+		this->add_portals(tile, *mesh_tile);
+		this->link_inner(tile);
+		this->link_outer(tile, *mesh_tile);
+	}
+
+	void PathGraph::remove_portals(Tile& tile)
+	{
+		for(uint32_t index : tile.m_portals)
+		{
+			Portal& portal = m_portals[index];
+
+			// edges are always added both ways : the reverse edges are found from this portal
+			for(const Edge& edge : portal.m_edges)
+			{
+				vector<Edge>& edges = m_portals[edge.m_to].m_edges;
+				edges.erase(std::remove_if(edges.begin(), edges.end(), [&](const Edge& e) { return e.m_to == index; }), edges.end());
+			}
+
+			portal = Portal();
+			m_free.push_back(index);
+		}
+		tile.m_portals.clear();
+	}
+
+	void PathGraph::add_portals(Tile& tile, const dtMeshTile& mesh_tile)
+	{
+		const int count = mesh_tile.header->polyCount;
+
+		// border edges are the edges linked to another tile, the side of the tile is stored in the edge
+		auto border_side = [&](const dtPoly& poly, int edge) { return (poly.neis[edge] & DT_EXT_LINK) ? int(poly.neis[edge] & 0xff) : -1; };
+
+		auto edge_center = [&](const dtPoly& poly, int edge)
+		{
+			const float* a = &mesh_tile.verts[poly.verts[edge] * 3];
+			const float* b = &mesh_tile.verts[poly.verts[(edge + 1) % poly.vertCount] * 3];
+			return vec3((a[0] + b[0]) * 0.5f, (a[1] + b[1]) * 0.5f, (a[2] + b[2]) * 0.5f);
+		};
+
+		vector<int> group(count);
+		vector<vec3> centers(count);
+
+		for(int side = 0; side < 8; ++side)
+		{
+			// union-find over the polygons touching this side, connected through their inner edges
+			std::fill(group.begin(), group.end(), -1);
+
+			for(int i = 0; i < count; ++i)
+			{
+				const dtPoly& poly = mesh_tile.polys[i];
+				if(poly.getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+					continue;
+				for(int e = 0; e < poly.vertCount; ++e)
+					if(border_side(poly, e) == side)
+					{
+						group[i] = i;
+						centers[i] = edge_center(poly, e);
+						break;
+					}
+			}
+
+			auto root = [&](int i) { while(group[i] != i) i = group[i] = group[group[i]]; return i; };
+
+			for(int i = 0; i < count; ++i)
+			{
+				if(group[i] < 0)
+					continue;
+				const dtPoly& poly = mesh_tile.polys[i];
+				for(int e = 0; e < poly.vertCount; ++e)
+				{
+					const int neighbour = (poly.neis[e] & DT_EXT_LINK) || poly.neis[e] == 0 ? -1 : int(poly.neis[e]) - 1;
+					if(neighbour >= 0 && group[neighbour] >= 0)
+						group[root(neighbour)] = root(i);
+				}
+			}
+
+			map<int, uint32_t> portals;
+			for(int i = 0; i < count; ++i)
+			{
+				if(group[i] < 0)
+					continue;
+
+				const int key = root(i);
+				auto it = portals.find(key);
+				if(it == portals.end())
+				{
+					uint32_t index = uint32_t(m_portals.size());
+					if(!m_free.empty())
+					{
+						index = m_free.back();
+						m_free.pop_back();
+					}
+					else
+						m_portals.emplace_back();
+
+					Portal& portal = m_portals[index];
+					portal.m_tile = tile.m_coord;
+					portal.m_side = side;
+					portal.m_alive = true;
+					tile.m_portals.push_back(index);
+					it = portals.insert({ key, index }).first;
+				}
+
+				Portal& portal = m_portals[it->second];
+				portal.m_polys.push_back(uint32_t(i));
+				portal.m_position += centers[i];
+			}
+
+			// the portal point is the border edge closest to the middle of the group
+			for(auto& key_index : portals)
+			{
+				Portal& portal = m_portals[key_index.second];
+				const vec3 middle = portal.m_position / float(portal.m_polys.size());
+
+				float best = FLT_MAX;
+				for(uint32_t poly : portal.m_polys)
+					if(length2(centers[poly] - middle) < best)
+					{
+						best = length2(centers[poly] - middle);
+						portal.m_poly = poly;
+						portal.m_position = centers[poly];
+					}
+			}
+		}
+	}
+
+	void PathGraph::add_edge(uint32_t from, uint32_t to, float cost)
+	{
+		for(Edge& edge : m_portals[from].m_edges)
+			if(edge.m_to == to)
+			{
+				edge.m_cost = cost;
+				return;
+			}
+		m_portals[from].m_edges.push_back({ to, cost });
+	}
+
+	void PathGraph::link_inner(Tile& tile)
+	{
+		for(size_t a = 0; a < tile.m_portals.size(); ++a)
+			for(size_t b = a + 1; b < tile.m_portals.size(); ++b)
+			{
+				const uint32_t from = tile.m_portals[a];
+				const uint32_t to = tile.m_portals[b];
+
+				float cost;
+				if(this->local_cost(this->portal_ref(m_portals[from]), m_portals[from].m_position, this->portal_ref(m_portals[to]), m_portals[to].m_position, cost))
+				{
+					this->add_edge(from, to, cost);
+					this->add_edge(to, from, cost);
+				}
+			}
+	}
+
+	void PathGraph::link_outer(Tile& tile, const dtMeshTile& mesh_tile)
+	{
+		for(uint32_t index : tile.m_portals)
+		{
+			const int side = m_portals[index].m_side;
+			const int opposite = dtOppositeTile(side);
+
+			for(uint32_t i : m_portals[index].m_polys)
+			{
+				const dtPoly& poly = mesh_tile.polys[i];
+				for(unsigned int l = poly.firstLink; l != DT_NULL_LINK; l = mesh_tile.links[l].next)
+				{
+					const dtLink& link = mesh_tile.links[l];
+					if(link.side != side)
+						continue;
+
+					const dtMeshTile* other = nullptr;
+					const dtPoly* other_poly = nullptr;
+					m_setup->getTileAndPolyByRefUnsafe(link.ref, &other, &other_poly);
+					const uint32_t other_index = m_setup->decodePolyIdPoly(link.ref);
+
+					// the neighbour tile is linked when it gets processed, if it is not yet
+					Tile* neighbour = this->find_tile(ivec2(other->header->x, other->header->y));
+					if(!neighbour)
+						continue;
+
+					for(uint32_t other_portal : neighbour->m_portals)
+					{
+						Portal& portal = m_portals[other_portal];
+						if(portal.m_side != opposite || std::find(portal.m_polys.begin(), portal.m_polys.end(), other_index) == portal.m_polys.end())
+							continue;
+
+						const float cost = distance(m_portals[index].m_position, portal.m_position);
+						this->add_edge(index, other_portal, cost);
+						this->add_edge(other_portal, index, cost);
+					}
+				}
+			}
+		}
+	}
+
+	bool PathGraph::local_cost(dtPolyRef from, const vec3& from_pos, dtPolyRef to, const vec3& to_pos, float& cost)
+	{
+		if(!from || !to)
+			return false;
+
+		int count = 0;
+		dtStatus status = m_query->findPath(from, to, value_ptr(from_pos), value_ptr(to_pos), m_filter.get(), m_polys.data(), &count, int(m_polys.size()));
+		if(dtStatusFailed(status) || count == 0 || m_polys[count - 1] != to)
+			return false;
+
+		int points = 0;
+		status = m_query->findStraightPath(value_ptr(from_pos), value_ptr(to_pos), m_polys.data(), count, value_ptr(m_points[0]), nullptr, nullptr, &points, int(m_points.size()));
+		if(dtStatusFailed(status))
+			return false;
+
+		cost = 0.f;
+		for(int i = 1; i < points; ++i)
+			cost += distance(m_points[i - 1], m_points[i]);
+		return true;
+	}
+
+	bool PathGraph::distant(dtPolyRef start, dtPolyRef end) const
+	{
+		ivec2 a, b;
+		if(!this->tile_coord(start, a) || !this->tile_coord(end, b))
+			return false;
+
+		const ivec2 offset = abs(a - b);
+		if(max(offset.x, offset.y) <= 1)
+			return false;
+
+		auto valid = [&](const ivec2& coord) { auto it = m_tiles.find(tile_key(coord.x, coord.y)); return it != m_tiles.end() && it->second.m_valid; };
+		return valid(a) && valid(b);
+	}
+
+	bool PathGraph::find_path(dtPolyRef start, const vec3& start_pos, dtPolyRef end, const vec3& end_pos, vector<Goal>& goals)
+	{
+		goals.clear();
+
+		ivec2 start_coord, end_coord;
+		if(!this->tile_coord(start, start_coord) || !this->tile_coord(end, end_coord))
+			return false;
+
+		Tile* source = this->find_tile(start_coord);
+		Tile* target = this->find_tile(end_coord);
+		if(!source || !target)
+			return false;
+
+		m_searches++;
+		const uint32_t search = uint32_t(m_searches);
+
+		m_nodes.resize(m_portals.size(), { 0.f, c_no_node, 0, false });
+		m_goal_costs.resize(m_portals.size(), 0.f);
+		m_goal_search.resize(m_portals.size(), 0);
+
+		// the end point is linked to the portals of its tile that can reach it
+		for(uint32_t index : target->m_portals)
+			if(this->local_cost(this->portal_ref(m_portals[index]), m_portals[index].m_position, end, end_pos, m_goal_costs[index]))
+				m_goal_search[index] = search;
+
+		struct Open { float m_estimate; uint32_t m_node; };
+		auto greater = [](const Open& a, const Open& b) { return a.m_estimate > b.m_estimate; };
+		vector<Open> open;
+
+		auto push = [&](uint32_t node, uint32_t parent, float cost)
+		{
+			Node& n = m_nodes[node];
+			if(n.m_search == search && (n.m_closed || n.m_cost <= cost))
+				return;
+			n = { cost, parent, search, false };
+			open.push_back({ cost + distance(m_portals[node].m_position, end_pos), node });
+			std::push_heap(open.begin(), open.end(), greater);
+		};
+
+		// the start point is linked to the portals of its tile it can reach
+		for(uint32_t index : source->m_portals)
+		{
+			float cost;
+			if(this->local_cost(start, start_pos, this->portal_ref(m_portals[index]), m_portals[index].m_position, cost))
+				push(index, c_no_node, cost);
+		}
+
+		uint32_t best = c_no_node;
+		float best_cost = FLT_MAX;
+
+		while(!open.empty())
+		{
+			std::pop_heap(open.begin(), open.end(), greater);
+			const Open current = open.back();
+			open.pop_back();
+
+			// the heuristic never overestimates : nothing left in the open list can beat the best complete path
+			if(current.m_estimate >= best_cost)
+				break;
+
+			Node& node = m_nodes[current.m_node];
+			if(node.m_closed)
+				continue;
+			node.m_closed = true;
+			m_expanded++;
+
+			if(m_goal_search[current.m_node] == search && node.m_cost + m_goal_costs[current.m_node] < best_cost)
+			{
+				best = current.m_node;
+				best_cost = node.m_cost + m_goal_costs[current.m_node];
+			}
+
+			for(const Edge& edge : m_portals[current.m_node].m_edges)
+				push(edge.m_to, current.m_node, node.m_cost + edge.m_cost);
+		}
+
+		if(best == c_no_node)
+			return false;
+
+		for(uint32_t node = best; node != c_no_node; node = m_nodes[node].m_parent)
+			goals.push_back({ this->portal_ref(m_portals[node]), m_portals[node].m_position });
+		std::reverse(goals.begin(), goals.end());
+
+		goals.push_back({ end, end_pos });
+		return true;
+	}
+}
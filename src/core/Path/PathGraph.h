@@ -0,0 +1,118 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#pragma once
+
+#include <stl/vector.h>
+#include <stl/memory.h>
+#include <stl/map.h>
+#include <math/Vec.h>
+#include <core/Forward.h>
+#include <core/Path/DetourPath.h>
+
+class dtNavMesh;
+class dtNavMeshQuery;
+class dtQueryFilter;
+struct dtMeshTile;
+
+namespace toy
+{
+	/* Coarse graph over the navmesh tiles, for long distance queries :
+		- a portal groups the polygons of a tile that touch the same side of the tile and are connected together
+		- portals of a same tile are linked by the length of the detour path between them
+		- portals of adjacent tiles are linked where their polygons are linked across the border
+		- tiles are processed incrementally, a few per update, as the navmesh is built or streamed in
+	*/
+
+	class TOY_CORE_EXPORT PathGraph
+	{
+	public:
+		PathGraph(Navmesh& navmesh);
+		~PathGraph();
+
+		struct Edge
+		{
+			uint32_t m_to;
+			float m_cost;
+		};
+
+		struct Portal
+		{
+			ivec2 m_tile = ivec2(0);
+			int m_side = 0;
+			uint32_t m_poly = 0;
+			vec3 m_position = vec3(0.f);
+			vector<uint32_t> m_polys;
+			vector<Edge> m_edges;
+			bool m_alive = false;
+		};
+
+		struct Tile
+		{
+			ivec2 m_coord = ivec2(0);
+			uint64_t m_hash = 0;
+			bool m_valid = false;
+			size_t m_visited = 0;
+			vector<uint32_t> m_portals;
+		};
+
+		struct Goal
+		{
+			dtPolyRef m_poly;
+			vec3 m_position;
+		};
+
+		Navmesh& m_navmesh;
+
+		unique<dtNavMeshQuery> m_query;
+		unique<dtQueryFilter> m_filter;
+
+		vector<Portal> m_portals;
+		map<uint64_t, Tile> m_tiles;
+
+		// set when the navmesh changed, cleared once every tile is processed
+		bool m_dirty = false;
+		size_t m_max_updates = 4U;
+
+		size_t m_searches = 0;
+		size_t m_expanded = 0;
+
+		void update();
+
+		// true when both polygons are in distinct tiles that are both processed and not adjacent
+		bool distant(dtPolyRef start, dtPolyRef end) const;
+
+		// abstract path : the portals to go through, followed by the end point itself
+		bool find_path(dtPolyRef start, const vec3& start_pos, dtPolyRef end, const vec3& end_pos, vector<Goal>& goals);
+
+	private:
+		bool tile_coord(dtPolyRef poly, ivec2& coord) const;
+		Tile* find_tile(const ivec2& coord);
+		dtPolyRef portal_ref(const Portal& portal) const;
+
+		void update_tile(Tile& tile);
+		void remove_portals(Tile& tile);
+		void add_portals(Tile& tile, const dtMeshTile& mesh_tile);
+		void link_inner(Tile& tile);
+		void link_outer(Tile& tile, const dtMeshTile& mesh_tile);
+		void add_edge(uint32_t from, uint32_t to, float cost);
+
+		bool local_cost(dtPolyRef from, const vec3& from_pos, dtPolyRef to, const vec3& to_pos, float& cost);
+
+		const dtNavMesh* m_setup = nullptr;
+		size_t m_setup_version = SIZE_MAX;
+		size_t m_visit = 0;
+		vector<uint32_t> m_free;
+
+		// scratch buffers for local searches and for the abstract search
+		vector<dtPolyRef> m_polys;
+		vector<vec3> m_points;
+
+		struct Node { float m_cost; uint32_t m_parent; uint32_t m_search; bool m_closed; };
+		vector<Node> m_nodes;
+		vector<float> m_goal_costs;
+		vector<uint32_t> m_goal_search;
+	};
+}
@@ -15,13 +15,76 @@
 
 #include <core/Core.h>
 
+#include <string.h>
 
 namespace toy
 {
+	PathCache::PathCache(size_t capacity, size_t max_polys)
+		: m_entries(capacity)
+	{
+		for(Entry& entry : m_entries)
+			entry.m_polys.resize(max_polys);
+	}
+
+	PathCache::Entry* PathCache::find(dtPolyRef start, dtPolyRef end)
+	{
+		for(Entry& entry : m_entries)
+			if(entry.m_count > 0 && entry.m_start == start && entry.m_end == end)
+			{
+				entry.m_used = ++m_clock;
+				m_hits++;
+				return &entry;
+			}
+
+		m_misses++;
+		return nullptr;
+	}
+
+	void PathCache::insert(dtPolyRef start, dtPolyRef end, const dtPolyRef* polys, int count)
+	{
+		if(m_entries.empty())
+			return;
+
+		Entry* lru = &m_entries[0];
+		for(Entry& entry : m_entries)
+		{
+			if(entry.m_start == start && entry.m_end == end)
+			{
+				lru = &entry;
+				break;
+			}
+			if(entry.m_used < lru->m_used)
+				lru = &entry;
+		}
+
+		const int size = min(count, int(lru->m_polys.size()));
+		memcpy(lru->m_polys.data(), polys, size * sizeof(dtPolyRef));
+		lru->m_start = start;
+		lru->m_end = end;
+		lru->m_count = size;
+		lru->m_used = ++m_clock;
+	}
+
+	void PathCache::clear()
+	{
+		for(Entry& entry : m_entries)
+		{
+			entry.m_count = 0;
+			entry.m_used = 0;
+		}
+	}
+
 	Pathfinder::Pathfinder(Navmesh& navmesh)
 		: m_navmesh(*navmesh.m_navmesh)
 		, m_query(make_unique<dtNavMeshQuery>())
 		, m_filter(make_unique<dtQueryFilter>())
+		, m_polys(m_max_polys)
+		, m_points(m_max_waypoints)
+		, m_point_refs(m_max_waypoints)
+		, m_point_flags(m_max_waypoints)
+		, m_cache(16, m_max_polys)
+		, m_graph(navmesh.m_graph.get())
+		, m_segment(m_max_polys)
 	{
 		m_filter->setIncludeFlags(0xFFFF);
 		m_filter->setExcludeFlags(0);
@@ -56,4 +119,80 @@ namespace toy
 		return (poly != 0);
 	}
 
+	bool Pathfinder::find_poly(const vec3& position, dtPolyRef& poly, vec3& nearest)
+	{
+		const vec3 extents = { 0.0f, 2.0f, 0.0f };
+		poly = 0;
+		dtStatus status = m_query->findNearestPoly(value_ptr(position), value_ptr(extents), m_filter.get(), &poly, value_ptr(nearest));
+		return !dtStatusFailed(status) && poly != 0;
+	}
+
+	bool Pathfinder::valid_path(const dtPolyRef* polys, int count)
+	{
+		for(int i = 0; i < count; ++i)
+			if(!m_query->isValidPolyRef(polys[i], m_filter.get()))
+				return false;
+		return true;
+	}
+
+	bool Pathfinder::find_path(dtPolyRef start, dtPolyRef end, const vec3& start_pos, const vec3& end_pos, int& count)
+	{
+		// group moves often request the same start/end polygons : reuse the corridor instead of running A* again
+		if(PathCache::Entry* entry = m_cache.find(start, end))
+		{
+			if(this->valid_path(entry->m_polys.data(), entry->m_count))
+			{
+				count = entry->m_count;
+				memcpy(m_polys.data(), entry->m_polys.data(), count * sizeof(dtPolyRef));
+				return true;
+			}
+			entry->m_count = 0;
+		}
+
+		// a flat search between distant tiles can exhaust the node pool : go through the tile graph instead
+		if(m_graph && m_graph->distant(start, end) && this->find_distant_path(start, end, start_pos, end_pos, count))
+			return true;
+
+		count = 0;
+		dtStatus status = m_query->findPath(start, end, value_ptr(start_pos), value_ptr(end_pos), m_filter.get(), m_polys.data(), &count, int(m_polys.size()));
+		if(dtStatusFailed(status) || count == 0)
+			return false;
+
+		// partial paths are not cached, the target might become reachable later
+		if(m_polys[count - 1] == end)
+			m_cache.insert(start, end, m_polys.data(), count);
+
+		return true;
+	}
+
+	bool Pathfinder::find_distant_path(dtPolyRef start, dtPolyRef end, const vec3& start_pos, const vec3& end_pos, int& count)
+	{
+		if(!m_graph->find_path(start, start_pos, end, end_pos, m_goals))
+			return false;
+
+		// each leg between two portals is a short detour search, the corridor is filled until it is full
+		// the rest of the path is refined later, when the agent has walked the first part of it
+		count = 0;
+		dtPolyRef from = start;
+		vec3 from_pos = start_pos;
+		for(const PathGraph::Goal& goal : m_goals)
+		{
+			int segment = 0;
+			dtStatus status = m_query->findPath(from, goal.m_poly, value_ptr(from_pos), value_ptr(goal.m_position), m_filter.get(), m_segment.data(), &segment, int(m_segment.size()));
+			if(dtStatusFailed(status) || segment == 0 || m_segment[segment - 1] != goal.m_poly)
+				break;
+
+			const int skip = count > 0 ? 1 : 0;
+			if(count + segment - skip > int(m_polys.size()))
+				break;
+
+			memcpy(&m_polys[count], &m_segment[skip], (segment - skip) * sizeof(dtPolyRef));
+			count += segment - skip;
+
+			from = goal.m_poly;
+			from_pos = goal.m_position;
+		}
+
+		return count > 0;
+	}
 }
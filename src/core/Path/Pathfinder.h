@@ -8,6 +8,7 @@
 #include <stl/vector.h>
 #include <core/Forward.h>
 #include <core/Path/DetourPath.h>
+#include <core/Path/PathGraph.h>
 
 class dtNavMesh;
 class dtNavMeshQuery;
@@ -15,6 +16,33 @@ class dtQueryFilter;
 
 namespace toy
 {
+	// small LRU of recently found polygon corridors, keyed by start/end polygon
+	// entries are preallocated so that lookups and insertions never allocate
+	class TOY_CORE_EXPORT PathCache
+	{
+	public:
+		PathCache(size_t capacity, size_t max_polys);
+
+		struct Entry
+		{
+			dtPolyRef m_start = 0;
+			dtPolyRef m_end = 0;
+			uint32_t m_used = 0;
+			int m_count = 0;
+			vector<dtPolyRef> m_polys;
+		};
+
+		vector<Entry> m_entries;
+		uint32_t m_clock = 0;
+
+		size_t m_hits = 0;
+		size_t m_misses = 0;
+
+		Entry* find(dtPolyRef start, dtPolyRef end);
+		void insert(dtPolyRef start, dtPolyRef end, const dtPolyRef* polys, int count);
+		void clear();
+	};
+
 	class refl_ TOY_CORE_EXPORT Pathfinder
     {
 	public:
@@ -26,10 +54,28 @@ namespace toy
 		unique<dtNavMeshQuery> m_query;
 		unique<dtQueryFilter> m_filter;
 
-		size_t m_max_polys = 20;
-		size_t m_max_waypoints = 50;
+		size_t m_max_polys = 256;
+		size_t m_max_waypoints = 64;
+
+		// scratch buffers shared by all paths computed with this pathfinder
+		vector<dtPolyRef> m_polys;
+		vector<vec3> m_points;
+		vector<dtPolyRef> m_point_refs;
+		vector<unsigned char> m_point_flags;
+
+		PathCache m_cache;
+
+		// shared by all the pathfinders of a navmesh, owned by the navmesh
+		PathGraph* m_graph = nullptr;
+		vector<PathGraph::Goal> m_goals;
+		vector<dtPolyRef> m_segment;
 
 		bool validity(const vec3& pos);
 		void nearestValid(vec3& destination, float margin);
+
+		bool find_poly(const vec3& position, dtPolyRef& poly, vec3& nearest);
+		bool find_path(dtPolyRef start, dtPolyRef end, const vec3& start_pos, const vec3& end_pos, int& count);
+		bool find_distant_path(dtPolyRef start, dtPolyRef end, const vec3& start_pos, const vec3& end_pos, int& count);
+		bool valid_path(const dtPolyRef* polys, int count);
     };
 }
@@ -4,6 +4,7 @@
 //  This notice and the license may not be removed or altered from any source distribution.
 
 
+#include <core/Types.h>
 #include <core/Physic/CollisionShape.h>
 
 #include <geom/Shape.h>
@@ -26,6 +27,7 @@ namespace toy
 		: m_shape(other.m_shape ? other.m_shape->clone() : nullptr)
 		, m_center(other.m_center)
 		, m_margin(other.m_margin)
+		, m_cooked(other.m_cooked)
 	{}
 
 	CollisionShape& CollisionShape::operator=(const CollisionShape& other)
@@ -34,6 +36,19 @@ namespace toy
 			m_shape = other.m_shape->clone();
 		m_center = other.m_center;
 		m_margin = other.m_margin;
+		m_cooked = other.m_cooked;
 		return *this;
 	}
+
+	CompoundShape::CompoundShape()
+		: Shape(type<CompoundShape>())
+	{}
+
+	object<Shape> CompoundShape::clone() const
+	{
+		object<CompoundShape> shape = oconstruct<CompoundShape>();
+		shape->m_shapes = m_shapes;
+		shape->m_children = m_children;
+		return shape;
+	}
 }
@@ -5,13 +5,23 @@
 
 #pragma once
 
+#include <stl/vector.h>
 #include <type/Unique.h>
 #include <math/Vec.h>
 #include <geom/Shape.h>
 #include <core/Forward.h>
 
+#include <memory>
+
 namespace toy
 {
+	// a shape built ahead by the physics backend, see PhysicWorld::cook()
+	class TOY_CORE_EXPORT CookedShape
+	{
+	public:
+		virtual ~CookedShape() {}
+	};
+
 	class refl_ TOY_CORE_EXPORT CollisionShape
 	{
 	public:
@@ -29,6 +39,34 @@ namespace toy
 		vec3 m_center = vec3(0.f);
 		float m_margin = 0.f;
 
+		// consumed by the first collider created from the shape, which then skips building it
+		std::shared_ptr<CookedShape> m_cooked;
+
 		bool checkInside(const vec3& position) { UNUSED(position); return true; }
 	};
+
+	/* Many placements of a few shapes in a single collision object :
+		- each shape is created once by the physics backend and shared by all its placements
+		- memory scales with the number of distinct shapes, not with the number of placements
+	*/
+
+	class refl_ TOY_CORE_EXPORT CompoundShape : public Shape
+	{
+	public:
+		constr_ CompoundShape();
+
+		struct Child
+		{
+			uint32_t m_shape;
+			vec3 m_position;
+			quat m_rotation;
+		};
+
+		vector<CollisionShape> m_shapes;
+		vector<Child> m_children;
+
+		void add(uint32_t shape, const vec3& position, const quat& rotation = ZeroQuat) { m_children.push_back({ shape, position, rotation }); }
+
+		virtual object<Shape> clone() const;
+	};
 }
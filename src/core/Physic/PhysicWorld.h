@@ -57,6 +57,13 @@ namespace toy
 		meth_ virtual vec3 ground_point(const Ray& ray) = 0;
 		meth_ virtual Collision raycast(const Ray& ray, short int mask) = 0;
 
+		// builds the backend shape of a collision shape ahead of its collider, from any thread : it replaces the source shape
+		virtual void cook(CollisionShape& shape) { UNUSED(shape); }
+		// serialized form of a cooked shape, so that it can be cached : false when the backend has nothing worth caching for it
+		virtual bool save_cooked(const CollisionShape& shape, vector<uint8_t>& data) { UNUSED(shape); UNUSED(data); return false; }
+		// cooks a shape from its serialized form, without the costly part of cook() : false when the data doesn't fit the shape
+		virtual bool load_cooked(CollisionShape& shape, const uint8_t* data, size_t size) { UNUSED(shape); UNUSED(data); UNUSED(size); return false; }
+
 	protected:
 		map<Medium*, object<PhysicMedium>> m_subworlds;
     };
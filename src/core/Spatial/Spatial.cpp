@@ -164,4 +164,17 @@ namespace toy
 	{
 		detach_to(self, target);
 	}
+
+	void destroy_spatial(HSpatial spatial)
+	{
+		vector<HSpatial> contents = spatial->m_contents;
+		for(HSpatial child : contents)
+			destroy_spatial(child);
+
+		if(HSpatial parent = spatial->m_parent)
+			remove(parent->m_contents, spatial);
+
+		EntityHandle<Spatial> owned = spatial;
+		UNUSED(owned);
+	}
 }
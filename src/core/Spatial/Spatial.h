@@ -86,4 +86,6 @@ namespace toy
 
 	void detach_to(HSpatial spatial, HSpatial target);
 	void set_parent(HSpatial spatial, HSpatial target);
+	// destroys the contents first, then the spatial itself
+	void destroy_spatial(HSpatial spatial);
 }
@@ -42,12 +42,14 @@ namespace two
     export_ template <> TOY_CORE_EXPORT Type& type<two::ComponentHandle<toy::Navblock>>();
     export_ template <> TOY_CORE_EXPORT Type& type<two::ComponentHandle<toy::Origin>>();
     export_ template <> TOY_CORE_EXPORT Type& type<two::ComponentHandle<toy::Waypoint>>();
+    export_ template <> TOY_CORE_EXPORT Type& type<two::ComponentHandle<toy::CrowdAgent>>();
     export_ template <> TOY_CORE_EXPORT Type& type<toy::Spatial>();
     export_ template <> TOY_CORE_EXPORT Type& type<toy::Origin>();
     export_ template <> TOY_CORE_EXPORT Type& type<toy::WorldClock>();
     export_ template <> TOY_CORE_EXPORT Type& type<toy::World>();
     export_ template <> TOY_CORE_EXPORT Type& type<toy::Medium>();
     export_ template <> TOY_CORE_EXPORT Type& type<toy::CollisionShape>();
+    export_ template <> TOY_CORE_EXPORT Type& type<toy::CompoundShape>();
     export_ template <> TOY_CORE_EXPORT Type& type<toy::Movable>();
     export_ template <> TOY_CORE_EXPORT Type& type<toy::Collision>();
     export_ template <> TOY_CORE_EXPORT Type& type<toy::ColliderImpl>();
@@ -80,6 +82,7 @@ namespace two
     export_ template <> TOY_CORE_EXPORT Type& type<toy::Waypoint>();
     export_ template <> TOY_CORE_EXPORT Type& type<toy::DetourPath>();
     export_ template <> TOY_CORE_EXPORT Type& type<toy::Pathfinder>();
+    export_ template <> TOY_CORE_EXPORT Type& type<toy::CrowdAgent>();
     export_ template <> TOY_CORE_EXPORT Type& type<toy::Obstacle>();
     export_ template <> TOY_CORE_EXPORT Type& type<toy::SolidMedium>();
     export_ template <> TOY_CORE_EXPORT Type& type<toy::ComponentPool>();
@@ -0,0 +1,102 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#include <stl/algorithm.h>
+#include <jobs/JobSystem.h>
+#include <core/Types.h>
+#include <core/World/Autosave.h>
+#include <core/World/World.h>
+
+#include <stdio.h>
+#include <atomic>
+#include <algorithm>
+
+namespace toy
+{
+	struct AutosaveTask : public JobTask
+	{
+		WorldSnapshot::Image m_image;
+		string m_path;
+		size_t m_rotation = 0;
+
+		size_t m_size = 0;
+		bool m_success = false;
+	};
+
+	static string rotation_path(const string& path, size_t index)
+	{
+		return path + "." + to_string(index);
+	}
+
+	static void write_autosave(AutosaveTask& task)
+	{
+		vector<uint8_t> data;
+		WorldSnapshot::write(task.m_image, data);
+		task.m_size = data.size();
+
+		// the oldest autosave is dropped, and the others shifted down, before the new one takes the first place
+		remove(rotation_path(task.m_path, task.m_rotation).c_str());
+		for(size_t i = task.m_rotation - 1; i > 0; --i)
+			rename(rotation_path(task.m_path, i).c_str(), rotation_path(task.m_path, i + 1).c_str());
+
+		task.m_success = WorldSnapshot::write_file(rotation_path(task.m_path, 1), data);
+	}
+
+	WorldAutosave::WorldAutosave(WorldSnapshot& snapshot)
+		: m_snapshot(snapshot)
+	{}
+
+	WorldAutosave::~WorldAutosave()
+	{}
+
+	void WorldAutosave::update(World& world)
+	{
+		if(m_task && m_task->m_done)
+			this->finish();
+
+		if(!m_enabled || m_task || m_clock.read() < m_interval)
+			return;
+
+		this->save(world);
+	}
+
+	void WorldAutosave::save(World& world)
+	{
+		if(m_task)
+			return;
+
+		m_clock.update();
+
+		const double start = m_clock.read();
+		m_snapshot.capture(world, m_image);
+		m_capture_time = float(m_clock.read() - start);
+		m_reused = m_image.m_reused;
+
+		if(m_capture_time > m_capture_budget)
+			printf("[warning] Autosave capture took %.2f ms, over its budget of %.2f ms\n", m_capture_time * 1000.f, m_capture_budget * 1000.f);
+
+		// the task gets its own image : the sections are shared, and replaced rather than modified by the next capture
+		m_task = std::make_shared<AutosaveTask>();
+		m_task->m_image = m_image;
+		m_task->m_path = m_path.empty() ? world.m_name + ".autosave" : m_path;
+		m_task->m_rotation = max(m_rotation, size_t(1U));
+
+		// the world owns the job in flight : the autosave can be destroyed while a save is still being written
+		AutosaveTask* task = m_task.get();
+		world.m_tasks.run(&world.m_job_system, m_task, [task]() { write_autosave(*task); });
+	}
+
+	void WorldAutosave::finish()
+	{
+		if(m_task->m_success)
+		{
+			m_saves++;
+			m_size = m_task->m_size;
+			printf("[info] Autosaved %s : %zu bytes, %zu of %zu sections unchanged, captured in %.2f ms\n", rotation_path(m_task->m_path, 1).c_str(),
+				   m_size, m_reused, m_image.m_sections.size(), m_capture_time * 1000.f);
+		}
+		m_task = nullptr;
+	}
+}
@@ -0,0 +1,59 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#pragma once
+
+#include <stl/string.h>
+#include <math/Timer.h>
+#include <core/Forward.h>
+#include <core/World/Snapshot.h>
+
+#include <memory>
+
+namespace toy
+{
+	/* Saves a world in the background, at a fixed interval :
+		- the world is captured on the main thread at a frame boundary, only the components that changed are copied again
+		- the capture is written to bytes and to disk on a job, into a temporary file renamed once complete
+		- the last autosaves are kept in rotation : <path>.1 is the most recent one, <path>.<rotation> the oldest
+		- a new autosave only starts once the previous one is written
+	*/
+
+	class TOY_CORE_EXPORT WorldAutosave
+	{
+	public:
+		WorldAutosave(WorldSnapshot& snapshot);
+		~WorldAutosave();
+
+		WorldSnapshot& m_snapshot;
+
+		// <world name>.autosave when empty
+		string m_path;
+		bool m_enabled = false;
+		double m_interval = 60.0;
+		size_t m_rotation = 3;
+
+		// cost of the last capture on the main thread in seconds, a capture above the budget is reported
+		float m_capture_time = 0.f;
+		float m_capture_budget = 0.002f;
+
+		size_t m_saves = 0;
+		size_t m_size = 0;
+		size_t m_reused = 0;
+
+		// called once per frame, after the world is updated
+		void update(World& world);
+		void save(World& world);
+
+		bool saving() const { return m_task != nullptr; }
+
+	private:
+		Clock m_clock;
+		WorldSnapshot::Image m_image;
+		std::shared_ptr<AutosaveTask> m_task;
+
+		void finish();
+	};
+}
@@ -0,0 +1,770 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#include <stl/map.h>
+#include <stl/algorithm.h>
+#include <refl/Api.h>
+#include <util/Hash.h>
+#include <core/Types.h>
+#include <core/World/Delta.h>
+#include <core/World/World.h>
+#include <core/WorldPage/PageCache.h>
+#include <core/Spatial/Spatial.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+namespace toy
+{
+	static const uint32_t DELTA_MAGIC = 'D'<<24 | 'L'<<16 | 'T'<<8 | 'A'; //'DLTA';
+
+	// quantized positions are clamped so that the difference of two of them fits in 32 bits
+	static const int32_t QUANTIZE_MAX = 1 << 29;
+
+	using Encoding = WorldDelta::Encoding;
+	using Row = WorldDelta::Row;
+
+	void BitWriter::write(uint32_t value, uint32_t bits)
+	{
+		for(uint32_t i = 0; i < bits; ++i)
+		{
+			if((m_bits & 7) == 0)
+				m_data.push_back(0);
+			if((value >> i) & 1)
+				m_data.back() |= uint8_t(1 << (m_bits & 7));
+			m_bits++;
+		}
+	}
+
+	void BitWriter::varint(uint32_t value)
+	{
+		uint32_t bits = 0;
+		while(bits < 32 && (value >> bits) != 0)
+			bits++;
+		this->write(bits, 6);
+		this->write(value, bits);
+	}
+
+	void BitWriter::bytes(const void* data, size_t size)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for(size_t i = 0; i < size; ++i)
+			this->write(bytes[i], 8);
+	}
+
+	uint32_t BitReader::read(uint32_t bits)
+	{
+		uint32_t value = 0;
+		for(uint32_t i = 0; i < bits; ++i)
+		{
+			const size_t byte = m_bit >> 3;
+			if(byte >= m_size)
+			{
+				m_overflow = true;
+				return 0;
+			}
+			if((m_data[byte] >> (m_bit & 7)) & 1)
+				value |= 1U << i;
+			m_bit++;
+		}
+		return value;
+	}
+
+	uint32_t BitReader::varint()
+	{
+		const uint32_t bits = this->read(6);
+		if(bits > 32)
+		{
+			m_overflow = true;
+			return 0;
+		}
+		return this->read(bits);
+	}
+
+	bool BitReader::bytes(void* data, size_t size)
+	{
+		uint8_t* bytes = static_cast<uint8_t*>(data);
+		for(size_t i = 0; i < size; ++i)
+			bytes[i] = uint8_t(this->read(8));
+		return !m_overflow;
+	}
+
+	static uint64_t entity_key(Entity entity)
+	{
+		return (uint64_t(entity.m_stream) << 32) | uint64_t(entity.m_handle);
+	}
+
+	static uint32_t zigzag(int32_t value) { return (uint32_t(value) << 1) ^ uint32_t(value >> 31); }
+	static int32_t unzigzag(uint32_t value) { return int32_t(value >> 1) ^ -int32_t(value & 1); }
+
+	static void append(vector<uint8_t>& data, const void* bytes, size_t size)
+	{
+		const uint8_t* begin = static_cast<const uint8_t*>(bytes);
+		data.insert(data.end(), begin, begin + size);
+	}
+
+	// smallest three : the index of the largest component, then the three others, which are all within +-1/sqrt(2)
+	static uint32_t pack_rotation(const float* rotation, uint32_t bits)
+	{
+		float q[4] = { rotation[0], rotation[1], rotation[2], rotation[3] };
+		const float length = sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+		if(length == 0.f)
+			q[0] = q[1] = q[2] = 0.f, q[3] = 1.f;
+
+		uint32_t largest = 0;
+		for(uint32_t i = 1; i < 4; ++i)
+			if(fabsf(q[i]) > fabsf(q[largest]))
+				largest = i;
+
+		// q and -q are the same rotation : the largest component is always made positive, and is not stored
+		const float scale = (q[largest] < 0.f ? -1.f : 1.f) / (length == 0.f ? 1.f : length);
+		const float range = 0.70710678f;
+		const float steps = float((1U << bits) - 1);
+
+		uint32_t packed = largest;
+		uint32_t shift = 2;
+		for(uint32_t i = 0; i < 4; ++i)
+			if(i != largest)
+			{
+				const float normalized = (q[i] * scale / range) * 0.5f + 0.5f;
+				const float quantized = floorf(std::min(std::max(normalized, 0.f), 1.f) * steps + 0.5f);
+				packed |= uint32_t(quantized) << shift;
+				shift += bits;
+			}
+		return packed;
+	}
+
+	static void unpack_rotation(uint32_t packed, uint32_t bits, float* rotation)
+	{
+		const uint32_t largest = packed & 3;
+		const float range = 0.70710678f;
+		const float steps = float((1U << bits) - 1);
+
+		float sum = 0.f;
+		uint32_t shift = 2;
+		for(uint32_t i = 0; i < 4; ++i)
+			if(i != largest)
+			{
+				const uint32_t quantized = (packed >> shift) & ((1U << bits) - 1);
+				rotation[i] = (float(quantized) / steps - 0.5f) * 2.f * range;
+				sum += rotation[i] * rotation[i];
+				shift += bits;
+			}
+		rotation[largest] = sqrtf(std::max(0.f, 1.f - sum));
+	}
+
+	static void gather_entities(HSpatial spatial, vector<Entity>& entities)
+	{
+		for(HSpatial child : spatial->m_contents)
+		{
+			entities.push_back(child);
+			gather_entities(child, entities);
+		}
+	}
+
+	static vector<Entity> world_entities(World& world)
+	{
+		vector<Entity> entities = { world.origin(), world.unworld() };
+		gather_entities(world.origin(), entities);
+		gather_entities(world.unworld(), entities);
+		return entities;
+	}
+
+	WorldDelta::WorldDelta(WorldSnapshot& snapshot)
+		: m_snapshot(snapshot)
+	{}
+
+	void WorldDelta::reset()
+	{
+		m_baseline.clear();
+	}
+
+	// the layout is taken again each time : modules register their components after the delta is created
+	void WorldDelta::layout()
+	{
+		m_rotation_bits = std::min(std::max(m_rotation_bits, 2U), 10U);
+
+		uint64_t hash = hash_bytes(&m_precision, sizeof(float));
+		hash = hash_bytes(&m_rotation_bits, sizeof(uint32_t), hash);
+
+		m_layout.resize(m_snapshot.m_components.size());
+
+		vector<WorldSnapshot::Field> fields;
+		for(size_t c = 0; c < m_snapshot.m_components.size(); ++c)
+		{
+			const string& name = meta(*m_snapshot.m_components[c].m_type).m_name;
+			hash = hash_bytes(name.data(), name.size(), hash);
+
+			fields.clear();
+			m_snapshot.fields(*m_snapshot.m_components[c].m_type, fields);
+
+			m_layout[c].clear();
+			for(const WorldSnapshot::Field& field : fields)
+			{
+				Encoding encoding = Encoding::Raw;
+				if(field.m_kind == WorldSnapshot::FieldKind::Handle)
+					encoding = Encoding::Handle;
+				else if(field.m_kind == WorldSnapshot::FieldKind::String)
+					encoding = Encoding::String;
+				else if(field.m_type->is<vec3>() && field.m_size == 3 * sizeof(float))
+					encoding = Encoding::Vec3;
+				else if(field.m_type->is<quat>() && field.m_size == 4 * sizeof(float))
+					encoding = Encoding::Quat;
+
+				m_layout[c].push_back({ field, encoding });
+				hash = hash_bytes(field.m_name.data(), field.m_name.size(), hash);
+				hash = hash_bytes(&encoding, sizeof(Encoding), hash);
+			}
+		}
+
+		m_layout_hash = uint32_t(hash ^ (hash >> 32));
+	}
+
+	uint64_t WorldDelta::slots(Entity entity) const
+	{
+		uint64_t mask = 0;
+		for(size_t c = 0; c < m_snapshot.m_components.size() && c < 64; ++c)
+			if(m_snapshot.m_components[c].m_get(entity))
+				mask |= uint64_t(1) << c;
+		return mask;
+	}
+
+	uint32_t WorldDelta::id(Entity entity) const
+	{
+		auto it = entity ? m_ids.find(entity_key(entity)) : m_ids.end();
+		return it != m_ids.end() ? it->second : UINT32_MAX;
+	}
+
+	void WorldDelta::row(Entity entity, uint64_t mask, Row& row) const
+	{
+		row.m_mask = mask;
+		row.m_data.clear();
+		row.m_offsets.clear();
+
+		for(size_t c = 0; c < m_layout.size(); ++c)
+		{
+			if(!(mask & (uint64_t(1) << c)))
+				continue;
+
+			const uint8_t* object = static_cast<const uint8_t*>(m_snapshot.m_components[c].m_get(entity));
+			for(const Field& field : m_layout[c])
+			{
+				row.m_offsets.push_back(uint32_t(row.m_data.size()));
+				const uint8_t* value = object + field.m_field.m_offset;
+
+				if(field.m_encoding == Encoding::Raw)
+					append(row.m_data, value, field.m_field.m_size);
+				else if(field.m_encoding == Encoding::Vec3)
+				{
+					int32_t quantized[3];
+					const float* v = reinterpret_cast<const float*>(value);
+					for(size_t i = 0; i < 3; ++i)
+					{
+						const float steps = floorf(v[i] / m_precision + 0.5f);
+						quantized[i] = int32_t(std::min(std::max(steps, -float(QUANTIZE_MAX)), float(QUANTIZE_MAX)));
+					}
+					append(row.m_data, quantized, sizeof(quantized));
+				}
+				else if(field.m_encoding == Encoding::Quat)
+				{
+					const uint32_t packed = pack_rotation(reinterpret_cast<const float*>(value), m_rotation_bits);
+					append(row.m_data, &packed, sizeof(uint32_t));
+				}
+				else if(field.m_encoding == Encoding::String)
+				{
+					const string& text = *reinterpret_cast<const string*>(value);
+					append(row.m_data, text.data(), text.size());
+				}
+				else if(field.m_encoding == Encoding::Handle)
+				{
+					const uint32_t target = this->id(field.m_field.m_handle->m_get(value));
+					append(row.m_data, &target, sizeof(uint32_t));
+				}
+			}
+		}
+
+		row.m_offsets.push_back(uint32_t(row.m_data.size()));
+	}
+
+	uint64_t WorldDelta::hash(World& world)
+	{
+		this->layout();
+
+		// in the order of the ids, which is the same on both sides
+		map<uint32_t, Entity> entities;
+		for(Entity entity : world_entities(world))
+		{
+			const uint32_t id = this->id(entity);
+			if(id != UINT32_MAX)
+				entities[id] = entity;
+		}
+
+		uint64_t hash = hash_bytes(&m_layout_hash, sizeof(uint32_t));
+		Row row;
+		for(auto& id_entity : entities)
+		{
+			this->row(id_entity.second, this->slots(id_entity.second), row);
+			hash = hash_bytes(&id_entity.first, sizeof(uint32_t), hash);
+			hash = hash_bytes(&row.m_mask, sizeof(uint64_t), hash);
+			hash = hash_bytes(row.m_data.data(), row.m_data.size(), hash);
+		}
+		return hash;
+	}
+
+	void WorldDelta::write_field(BitWriter& writer, const Field& field, const uint8_t* value, uint32_t size, const uint8_t* base, uint32_t base_size) const
+	{
+		if(field.m_encoding == Encoding::Raw)
+			writer.bytes(value, size);
+		else if(field.m_encoding == Encoding::Vec3)
+		{
+			// the difference to the baseline : small moves take a few bits
+			int32_t current[3], previous[3] = { 0, 0, 0 };
+			memcpy(current, value, sizeof(current));
+			if(base_size == sizeof(previous))
+				memcpy(previous, base, sizeof(previous));
+			for(size_t i = 0; i < 3; ++i)
+				writer.varint(zigzag(current[i] - previous[i]));
+		}
+		else if(field.m_encoding == Encoding::Quat)
+		{
+			uint32_t packed;
+			memcpy(&packed, value, sizeof(uint32_t));
+			writer.write(packed, 2 + 3 * m_rotation_bits);
+		}
+		else if(field.m_encoding == Encoding::String)
+		{
+			writer.varint(size);
+			writer.bytes(value, size);
+		}
+		else if(field.m_encoding == Encoding::Handle)
+		{
+			uint32_t target;
+			memcpy(&target, value, sizeof(uint32_t));
+			writer.varint(target + 1);
+		}
+	}
+
+	bool WorldDelta::read_field(BitReader& reader, const Field& field, vector<uint8_t>& value, const uint8_t* base, uint32_t base_size) const
+	{
+		if(field.m_encoding == Encoding::Raw)
+		{
+			const size_t at = value.size();
+			value.resize(at + field.m_field.m_size);
+			reader.bytes(value.data() + at, field.m_field.m_size);
+		}
+		else if(field.m_encoding == Encoding::Vec3)
+		{
+			int32_t current[3], previous[3] = { 0, 0, 0 };
+			if(base_size == sizeof(previous))
+				memcpy(previous, base, sizeof(previous));
+			for(size_t i = 0; i < 3; ++i)
+				current[i] = previous[i] + unzigzag(reader.varint());
+			append(value, current, sizeof(current));
+		}
+		else if(field.m_encoding == Encoding::Quat)
+		{
+			const uint32_t packed = reader.read(2 + 3 * m_rotation_bits);
+			append(value, &packed, sizeof(uint32_t));
+		}
+		else if(field.m_encoding == Encoding::String)
+		{
+			const uint32_t size = reader.varint();
+			if(reader.m_overflow || size > reader.m_size)
+				return false;
+			const size_t at = value.size();
+			value.resize(at + size);
+			reader.bytes(value.data() + at, size);
+		}
+		else if(field.m_encoding == Encoding::Handle)
+		{
+			const uint32_t target = reader.varint() - 1;
+			append(value, &target, sizeof(uint32_t));
+		}
+		return !reader.m_overflow;
+	}
+
+	DeltaEncoder::DeltaEncoder(WorldSnapshot& snapshot)
+		: WorldDelta(snapshot)
+	{}
+
+	void DeltaEncoder::encode(World& world, vector<uint8_t>& data)
+	{
+		const uint32_t layout_hash = m_layout_hash;
+		this->layout();
+		if(layout_hash != m_layout_hash)
+			m_baseline.clear();
+
+		vector<Entity> entities = world_entities(world);
+
+		// ids of the entities that are gone are forgotten, the new ones get the next ids
+		map<uint64_t, uint32_t> ids;
+		ids[entity_key(entities[0])] = 0;
+		ids[entity_key(entities[1])] = 1;
+		for(size_t i = 2; i < entities.size(); ++i)
+		{
+			auto it = m_ids.find(entity_key(entities[i]));
+			ids[entity_key(entities[i])] = it != m_ids.end() ? it->second : m_next_id++;
+		}
+		m_ids = move(ids);
+
+		map<uint32_t, Row> current;
+		for(Entity entity : entities)
+		{
+			Row& row = current[this->id(entity)];
+			this->row(entity, this->slots(entity), row);
+		}
+
+		data.clear();
+		PageWriter header = { data };
+		header.value(DELTA_MAGIC);
+		header.value(m_layout_hash);
+
+		BitWriter writer = { data };
+
+		// ids are written in order, as the difference to the previous one
+		auto write_ids = [&](const vector<uint32_t>& list)
+		{
+			writer.varint(uint32_t(list.size()));
+			uint32_t previous = 0;
+			for(uint32_t id : list)
+			{
+				writer.varint(id - previous);
+				previous = id;
+			}
+		};
+
+		vector<uint32_t> destroyed;
+		for(auto& id_row : m_baseline)
+			if(current.find(id_row.first) == current.end())
+				destroyed.push_back(id_row.first);
+		write_ids(destroyed);
+
+		// the components of the created entities come first : the fields written after can refer to any of them
+		vector<uint32_t> created;
+		for(auto& id_row : current)
+		{
+			auto base = m_baseline.find(id_row.first);
+			if(base == m_baseline.end() || base->second.m_mask != id_row.second.m_mask)
+				created.push_back(id_row.first);
+		}
+		write_ids(created);
+		for(uint32_t id : created)
+			for(size_t c = 0; c < m_layout.size(); ++c)
+				writer.write(uint32_t((current[id].m_mask >> c) & 1), 1);
+
+		vector<uint32_t> updated;
+		for(auto& id_row : current)
+		{
+			auto base = m_baseline.find(id_row.first);
+			if(base == m_baseline.end() || base->second.m_data != id_row.second.m_data || base->second.m_offsets != id_row.second.m_offsets)
+				updated.push_back(id_row.first);
+		}
+		write_ids(updated);
+
+		for(uint32_t id : updated)
+		{
+			const Row& row = current[id];
+			auto found = m_baseline.find(id);
+			const Row& base = found != m_baseline.end() && found->second.m_mask == row.m_mask ? found->second : m_empty;
+
+			size_t index = 0;
+			for(size_t c = 0; c < m_layout.size(); ++c)
+			{
+				if(!(row.m_mask & (uint64_t(1) << c)))
+					continue;
+
+				auto field_changed = [&](size_t f) -> bool
+				{
+					const uint32_t size = row.m_offsets[f + 1] - row.m_offsets[f];
+					if(base.m_offsets.empty())
+						return true;
+					const uint32_t base_size = base.m_offsets[f + 1] - base.m_offsets[f];
+					return size != base_size || memcmp(row.m_data.data() + row.m_offsets[f], base.m_data.data() + base.m_offsets[f], size) != 0;
+				};
+
+				bool changed = false;
+				for(size_t f = index; f < index + m_layout[c].size(); ++f)
+					changed |= field_changed(f);
+
+				writer.write(changed ? 1 : 0, 1);
+				if(changed)
+					for(size_t f = index; f < index + m_layout[c].size(); ++f)
+					{
+						const bool field = field_changed(f);
+						writer.write(field ? 1 : 0, 1);
+						if(!field)
+							continue;
+
+						const uint8_t* base_value = base.m_offsets.empty() ? nullptr : base.m_data.data() + base.m_offsets[f];
+						const uint32_t base_size = base.m_offsets.empty() ? 0 : base.m_offsets[f + 1] - base.m_offsets[f];
+						this->write_field(writer, m_layout[c][f - index], row.m_data.data() + row.m_offsets[f], row.m_offsets[f + 1] - row.m_offsets[f], base_value, base_size);
+					}
+
+				index += m_layout[c].size();
+			}
+		}
+
+		m_baseline = move(current);
+
+		m_entities = entities.size();
+		m_bytes = data.size();
+		m_total_entities += m_entities;
+		m_total_bytes += m_bytes;
+	}
+
+	DeltaDecoder::DeltaDecoder(WorldSnapshot& snapshot)
+		: WorldDelta(snapshot)
+	{}
+
+	void DeltaDecoder::apply(Entity entity, const Row& row, const Row& previous)
+	{
+		const bool same = previous.m_mask == row.m_mask && !previous.m_offsets.empty();
+
+		size_t index = 0;
+		for(size_t c = 0; c < m_layout.size(); ++c)
+		{
+			if(!(row.m_mask & (uint64_t(1) << c)))
+				continue;
+
+			uint8_t* object = static_cast<uint8_t*>(m_snapshot.m_components[c].m_get(entity));
+			bool changed = false;
+
+			for(const Field& field : m_layout[c])
+			{
+				const size_t f = index++;
+				const uint8_t* source = row.m_data.data() + row.m_offsets[f];
+				const uint32_t size = row.m_offsets[f + 1] - row.m_offsets[f];
+				if(!object)
+					continue;
+
+				if(same && size == previous.m_offsets[f + 1] - previous.m_offsets[f] && memcmp(source, previous.m_data.data() + previous.m_offsets[f], size) == 0)
+					continue;
+
+				changed = true;
+				uint8_t* value = object + field.m_field.m_offset;
+
+				if(field.m_encoding == Encoding::Raw && size == field.m_field.m_size)
+					memcpy(value, source, size);
+				else if(field.m_encoding == Encoding::Vec3 && size == 3 * sizeof(int32_t))
+				{
+					int32_t quantized[3];
+					memcpy(quantized, source, sizeof(quantized));
+					float v[3] = { float(quantized[0]) * m_precision, float(quantized[1]) * m_precision, float(quantized[2]) * m_precision };
+					memcpy(value, v, sizeof(v));
+				}
+				else if(field.m_encoding == Encoding::Quat && size == sizeof(uint32_t))
+				{
+					uint32_t packed;
+					memcpy(&packed, source, sizeof(uint32_t));
+					float q[4];
+					unpack_rotation(packed, m_rotation_bits, q);
+					memcpy(value, q, sizeof(q));
+				}
+				else if(field.m_encoding == Encoding::String)
+					*reinterpret_cast<string*>(value) = string((const char*)source, size);
+				else if(field.m_encoding == Encoding::Handle && size == sizeof(uint32_t))
+				{
+					uint32_t target;
+					memcpy(&target, source, sizeof(uint32_t));
+					auto it = m_entities.find(target);
+					field.m_field.m_handle->m_set(value, it != m_entities.end() ? it->second : Entity());
+				}
+			}
+
+			// decoded spatials are marked updated like the ones synced from physics
+			if(changed && m_snapshot.m_components[c].m_type == &type<Spatial>())
+				reinterpret_cast<Spatial*>(object)->set_sync_dirty(true);
+		}
+	}
+
+	bool DeltaDecoder::decode(World& world, const vector<uint8_t>& data)
+	{
+		this->layout();
+
+		PageReader header = { data.data(), data.size() };
+		uint32_t magic = 0, layout_hash = 0;
+		if(!header.value(magic) || !header.value(layout_hash) || magic != DELTA_MAGIC)
+		{
+			printf("[warning] World delta is invalid\n");
+			return false;
+		}
+
+		if(layout_hash != m_layout_hash)
+		{
+			printf("[warning] World delta components or quantization don't match the ones registered\n");
+			return false;
+		}
+
+		m_entities[0] = world.origin();
+		m_entities[1] = world.unworld();
+		m_ids[entity_key(world.origin())] = 0;
+		m_ids[entity_key(world.unworld())] = 1;
+
+		BitReader reader = { data.data() + header.m_offset, data.size() - header.m_offset };
+
+		auto read_ids = [&](vector<uint32_t>& list)
+		{
+			const uint32_t count = reader.varint();
+			uint32_t previous = 0;
+			for(uint32_t i = 0; i < count && !reader.m_overflow; ++i)
+				list.push_back(previous += reader.varint());
+		};
+
+		vector<uint32_t> destroyed;
+		read_ids(destroyed);
+
+		// the contents of a destroyed spatial are destroyed with it : only the ones whose parent stays are destroyed here
+		// the roots are all found before any id is forgotten, the parent of a destroyed spatial is looked up by its id
+		vector<HSpatial> roots;
+		for(uint32_t id : destroyed)
+		{
+			auto it = m_entities.find(id);
+			if(it == m_entities.end() || id < 2 || !it->second)
+				continue;
+
+			Spatial* spatial = try_asa<Spatial>(it->second);
+			const uint32_t parent = spatial ? this->id(spatial->m_parent) : UINT32_MAX;
+			if(spatial && !std::binary_search(destroyed.begin(), destroyed.end(), parent))
+				roots.push_back(HSpatial(it->second));
+		}
+
+		for(uint32_t id : destroyed)
+		{
+			auto it = m_entities.find(id);
+			if(it == m_entities.end() || id < 2)
+				continue;
+
+			if(it->second)
+				m_ids.erase(entity_key(it->second));
+			m_entities.erase(it);
+			m_baseline.erase(id);
+		}
+
+		for(HSpatial root : roots)
+			destroy_spatial(root);
+
+		vector<uint32_t> created;
+		read_ids(created);
+
+		map<uint32_t, uint64_t> masks;
+		size_t missing = 0;
+		// created ids are read in order : the ones attached stay sorted
+		vector<uint32_t> attached;
+		for(uint32_t id : created)
+		{
+			uint64_t mask = 0;
+			for(size_t c = 0; c < m_layout.size(); ++c)
+				mask |= uint64_t(reader.read(1)) << c;
+			masks[id] = mask;
+
+			auto it = m_entities.find(id);
+			if(it != m_entities.end())
+			{
+				if(it->second && this->slots(it->second) != mask)
+					printf("[warning] World delta entity %u changed components, only the ones it has are decoded\n", id);
+				continue;
+			}
+
+			uint64_t buffers = 0;
+			for(size_t c = 0; c < m_layout.size(); ++c)
+				if(mask & (uint64_t(1) << c))
+					buffers |= uint64_t(1) << m_snapshot.m_components[c].m_buffer;
+
+			Entity entity = m_snapshot.create(world, buffers);
+			m_entities[id] = entity;
+			if(entity)
+			{
+				m_ids[entity_key(entity)] = id;
+				attached.push_back(id);
+			}
+			else
+				++missing;
+		}
+
+		if(missing > 0)
+			printf("[warning] World delta has %zu entities of no registered archetype, they are not created\n", missing);
+
+		vector<uint32_t> updated;
+		read_ids(updated);
+
+		for(uint32_t id : updated)
+		{
+			Row& base = m_baseline[id];
+			auto created_mask = masks.find(id);
+			const uint64_t mask = created_mask != masks.end() ? created_mask->second : base.m_mask;
+			const bool same = base.m_mask == mask && !base.m_offsets.empty();
+
+			Row row;
+			row.m_mask = mask;
+
+			size_t index = 0;
+			for(size_t c = 0; c < m_layout.size(); ++c)
+			{
+				if(!(mask & (uint64_t(1) << c)))
+					continue;
+
+				const bool changed = reader.read(1) != 0;
+				for(size_t f = index; f < index + m_layout[c].size(); ++f)
+				{
+					row.m_offsets.push_back(uint32_t(row.m_data.size()));
+					const uint8_t* base_value = same ? base.m_data.data() + base.m_offsets[f] : nullptr;
+					const uint32_t base_size = same ? base.m_offsets[f + 1] - base.m_offsets[f] : 0;
+
+					if(changed && reader.read(1) != 0)
+					{
+						if(!this->read_field(reader, m_layout[c][f - index], row.m_data, base_value, base_size))
+						{
+							printf("[warning] World delta is truncated\n");
+							return false;
+						}
+					}
+					else if(base_value)
+						append(row.m_data, base_value, base_size);
+				}
+				index += m_layout[c].size();
+			}
+			row.m_offsets.push_back(uint32_t(row.m_data.size()));
+
+			if(reader.m_overflow)
+			{
+				printf("[warning] World delta is truncated\n");
+				return false;
+			}
+
+			auto it = m_entities.find(id);
+			Entity entity = it != m_entities.end() ? it->second : Entity();
+			Spatial* spatial = entity ? try_asa<Spatial>(entity) : nullptr;
+			HSpatial parent = spatial ? spatial->m_parent : HSpatial();
+
+			if(entity)
+				this->apply(entity, row, base);
+
+			// an existing spatial moved to another parent is moved to its contents, the created ones are attached below
+			const bool existing = !std::binary_search(attached.begin(), attached.end(), id);
+			if(spatial && existing && entity_key(spatial->m_parent) != entity_key(parent))
+			{
+				if(parent)
+					remove(parent->m_contents, HSpatial(entity));
+				if(spatial->m_parent)
+					spatial->m_parent->m_contents.push_back(HSpatial(entity));
+			}
+
+			base = move(row);
+		}
+
+		// the created spatials are added to the contents of their parent, in the order of their ids
+		for(uint32_t id : attached)
+			if(Spatial* spatial = try_asa<Spatial>(m_entities[id]))
+			{
+				spatial->m_world = &world;
+				if(spatial->m_parent)
+					spatial->m_parent->m_contents.push_back(HSpatial(m_entities[id]));
+			}
+
+		return true;
+	}
+}
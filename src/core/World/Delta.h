@@ -0,0 +1,141 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#pragma once
+
+#include <stl/vector.h>
+#include <stl/map.h>
+#include <ecs/ECS.h>
+#include <core/Forward.h>
+#include <core/World/Snapshot.h>
+
+#include <stdint.h>
+
+namespace toy
+{
+	struct TOY_CORE_EXPORT BitWriter
+	{
+		vector<uint8_t>& m_data;
+		size_t m_bits = 0;
+
+		void write(uint32_t value, uint32_t bits);
+		// values of a few bits take a few bits : the number of bits, then the bits
+		void varint(uint32_t value);
+		void bytes(const void* data, size_t size);
+	};
+
+	struct TOY_CORE_EXPORT BitReader
+	{
+		const uint8_t* m_data;
+		size_t m_size;
+		size_t m_bit = 0;
+		bool m_overflow = false;
+
+		uint32_t read(uint32_t bits);
+		uint32_t varint();
+		bool bytes(void* data, size_t size);
+	};
+
+	/* Quantized state of the entities of a world, and the delta between two of its versions :
+		- entities are numbered with ids that stay the same across deltas, the two roots being 0 and 1
+		- fields are the stored fields of the snapshot components, vec3 quantized to a fixed precision, quat to its smallest three components
+		- each side keeps the last state sent or received as its baseline : a field is only written when its quantized value differs
+		- positions are written as the difference to their baseline, and take a few bits when they move a little
+		- a delta from an empty baseline holds the whole world, and is a snapshot
+	*/
+
+	class TOY_CORE_EXPORT WorldDelta
+	{
+	public:
+		WorldDelta(WorldSnapshot& snapshot);
+
+		WorldSnapshot& m_snapshot;
+
+		// both sides must use the same quantization
+		float m_precision = 1.f / 512.f;
+		uint32_t m_rotation_bits = 10;
+
+		enum class Encoding : uint8_t
+		{
+			Raw,
+			Vec3,
+			Quat,
+			String,
+			Handle
+		};
+
+		struct Field
+		{
+			WorldSnapshot::Field m_field;
+			Encoding m_encoding;
+		};
+
+		// fields of each snapshot component, in the order they're registered
+		vector<vector<Field>> m_layout;
+		uint32_t m_layout_hash = 0;
+
+		// quantized fields of the components of an entity, one after the other, and where each of them starts
+		struct Row
+		{
+			uint64_t m_mask = 0;
+			vector<uint8_t> m_data;
+			vector<uint32_t> m_offsets;
+		};
+
+		map<uint32_t, Row> m_baseline;
+		map<uint64_t, uint32_t> m_ids;
+
+		// forgets the baseline : the next delta holds the whole world
+		void reset();
+
+		// hash of the quantized state of the world : the encoded and the decoded world are in sync when their hashes are equal
+		uint64_t hash(World& world);
+
+	protected:
+		void layout();
+		void row(Entity entity, uint64_t mask, Row& row) const;
+		uint64_t slots(Entity entity) const;
+		uint32_t id(Entity entity) const;
+
+		void write_field(BitWriter& writer, const Field& field, const uint8_t* value, uint32_t size, const uint8_t* base, uint32_t base_size) const;
+		bool read_field(BitReader& reader, const Field& field, vector<uint8_t>& value, const uint8_t* base, uint32_t base_size) const;
+
+		Row m_empty;
+	};
+
+	class TOY_CORE_EXPORT DeltaEncoder : public WorldDelta
+	{
+	public:
+		DeltaEncoder(WorldSnapshot& snapshot);
+
+		// encodes the changes of the world since the last delta, and makes its state the new baseline : deltas must be decoded in order
+		void encode(World& world, vector<uint8_t>& data);
+
+		size_t m_entities = 0;
+		size_t m_bytes = 0;
+		size_t m_total_entities = 0;
+		size_t m_total_bytes = 0;
+
+		// average size of the deltas, per entity of the world
+		float bytes_per_entity() const { return m_total_entities ? float(m_total_bytes) / float(m_total_entities) : 0.f; }
+
+	private:
+		uint32_t m_next_id = 2;
+	};
+
+	class TOY_CORE_EXPORT DeltaDecoder : public WorldDelta
+	{
+	public:
+		DeltaDecoder(WorldSnapshot& snapshot);
+
+		map<uint32_t, Entity> m_entities;
+
+		// applies a delta to the world : entities are created and destroyed, and the changed fields are set
+		bool decode(World& world, const vector<uint8_t>& data);
+
+	private:
+		void apply(Entity entity, const Row& row, const Row& previous);
+	};
+}
@@ -0,0 +1,59 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#include <jobs/JobSystem.h>
+#include <core/Types.h>
+#include <core/World/JobTasks.h>
+
+#include <algorithm>
+
+namespace toy
+{
+	JobTasks::JobTasks()
+	{}
+
+	JobTasks::~JobTasks()
+	{
+		this->join();
+	}
+
+	void JobTasks::run(JobSystem* job_system, std::shared_ptr<JobTask> task, function<void()> work)
+	{
+		task->m_work = work;
+		task->m_job_system = job_system;
+
+		if(!job_system)
+		{
+			task->m_work();
+			task->m_done = true;
+			return;
+		}
+
+		this->sweep();
+		m_tasks.push_back(task);
+
+		JobTask* data = task.get();
+		task->m_job = job_system->job(nullptr, [data](JobSystem& js, Job* job)
+		{
+			UNUSED(js); UNUSED(job);
+			data->m_work();
+			data->m_done = true;
+		});
+		job_system->run(task->m_job);
+	}
+
+	void JobTasks::sweep()
+	{
+		m_tasks.erase(std::remove_if(m_tasks.begin(), m_tasks.end(), [](const std::shared_ptr<JobTask>& task) { return bool(task->m_done); }), m_tasks.end());
+	}
+
+	void JobTasks::join()
+	{
+		for(std::shared_ptr<JobTask>& task : m_tasks)
+			if(!task->m_done)
+				task->m_job_system->complete(task->m_job);
+		m_tasks.clear();
+	}
+}
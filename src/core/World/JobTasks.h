@@ -0,0 +1,53 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#pragma once
+
+#include <stl/vector.h>
+#include <stl/function.h>
+#include <core/Forward.h>
+
+#include <atomic>
+#include <memory>
+
+namespace toy
+{
+	// work run on a job : the object that started it can drop it at any time, the job writes into the task it owns
+	struct TOY_CORE_EXPORT JobTask
+	{
+		virtual ~JobTask() {}
+
+		function<void()> m_work;
+		JobSystem* m_job_system = nullptr;
+		Job* m_job = nullptr;
+		std::atomic<bool> m_done = { false };
+	};
+
+	/* Tasks in flight on the jobs of a world :
+		- the list shares each task with the object that started it, until the job is done
+		- the done tasks are swept whenever a new one is run
+		- join() completes the jobs still running, the world joins before it's torn down
+	*/
+
+	class TOY_CORE_EXPORT JobTasks
+	{
+	public:
+		JobTasks();
+		~JobTasks();
+
+		JobTasks(const JobTasks& other) = delete;
+		JobTasks& operator=(const JobTasks& other) = delete;
+
+		// runs the work on a job, or right away without a job system
+		void run(JobSystem* job_system, std::shared_ptr<JobTask> task, function<void()> work);
+		void sweep();
+		void join();
+
+		size_t pending() const { return m_tasks.size(); }
+
+	private:
+		vector<std::shared_ptr<JobTask>> m_tasks;
+	};
+}
@@ -0,0 +1,529 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#include <refl/Api.h>
+#include <refl/System.h>
+#include <util/Procedure.h>
+#include <util/Hash.h>
+#include <core/Types.h>
+#include <core/World/Replay.h>
+#include <core/World/Replay.hpp>
+#include <core/World/World.h>
+#include <core/WorldPage/PageCache.h>
+#include <core/Spatial/Spatial.h>
+
+#include <stdio.h>
+#include <string.h>
+
+namespace toy
+{
+	static const uint32_t REPLAY_MAGIC = 'R'<<24 | 'P'<<16 | 'L'<<8 | 'Y'; //'RPLY';
+	static const uint32_t REPLAY_FORMAT = 1;
+
+	enum class RefKind : uint8_t
+	{
+		Null,
+		Raw,
+		String,
+		Handle
+	};
+
+	static void write_string(PageWriter& writer, const string& value)
+	{
+		writer.value(uint32_t(value.size()));
+		writer.bytes(value.data(), value.size());
+	}
+
+	static bool read_string(PageReader& reader, string& value)
+	{
+		uint32_t size = 0;
+		if(!reader.value(size))
+			return false;
+		const uint8_t* data = reader.skip(size);
+		if(!data)
+			return false;
+		value.assign(reinterpret_cast<const char*>(data), size);
+		return true;
+	}
+
+	// entities are numbered walking the spatial tree, as in the snapshot : a replay that didn't diverge numbers them the same
+	static void gather_entities(HSpatial spatial, vector<Entity>& entities)
+	{
+		for(HSpatial child : spatial->m_contents)
+		{
+			entities.push_back(child);
+			gather_entities(child, entities);
+		}
+	}
+
+	static vector<Entity> world_entities(World& world)
+	{
+		vector<Entity> entities = { world.origin(), world.unworld() };
+		gather_entities(world.origin(), entities);
+		gather_entities(world.unworld(), entities);
+		return entities;
+	}
+
+	static bool same_entity(Entity a, Entity b)
+	{
+		return a.m_stream == b.m_stream && a.m_handle == b.m_handle;
+	}
+
+	void WorldRecording::write(vector<uint8_t>& data) const
+	{
+		data.clear();
+		PageWriter writer = { data };
+		writer.value(REPLAY_MAGIC);
+		writer.value(REPLAY_FORMAT);
+		writer.value(m_seed);
+		writer.value(uint64_t(m_hash_interval));
+		writer.value(uint64_t(m_snapshot.size()));
+		writer.bytes(m_snapshot.data(), m_snapshot.size());
+
+		writer.value(uint32_t(m_channels.size()));
+		for(const string& channel : m_channels)
+			write_string(writer, channel);
+
+		writer.value(uint64_t(m_frames.size()));
+		for(const ReplayFrame& frame : m_frames)
+		{
+			writer.value(uint64_t(frame.m_tick));
+			writer.value(uint64_t(frame.m_delta));
+			writer.value(frame.m_hash);
+			writer.value(uint32_t(frame.m_events.size()));
+			for(const ReplayEvent& event : frame.m_events)
+			{
+				writer.value(event.m_channel);
+				writer.value(uint32_t(event.m_data.size()));
+				writer.bytes(event.m_data.data(), event.m_data.size());
+			}
+		}
+	}
+
+	bool WorldRecording::read(const vector<uint8_t>& data)
+	{
+		PageReader reader = { data.data(), data.size() };
+
+		uint32_t magic = 0, format = 0;
+		if(!reader.value(magic) || !reader.value(format) || magic != REPLAY_MAGIC || format != REPLAY_FORMAT)
+		{
+			printf("[warning] World recording is invalid or of an unknown format\n");
+			return false;
+		}
+
+		uint64_t interval = 0, snapshot = 0;
+		if(!reader.value(m_seed) || !reader.value(interval) || !reader.value(snapshot))
+			return false;
+		m_hash_interval = size_t(interval);
+
+		const uint8_t* bytes = reader.skip(size_t(snapshot));
+		if(!bytes)
+			return false;
+		m_snapshot.assign(bytes, bytes + snapshot);
+
+		uint32_t channels = 0;
+		if(!reader.value(channels))
+			return false;
+		m_channels.resize(channels);
+		for(string& channel : m_channels)
+			if(!read_string(reader, channel))
+				return false;
+
+		uint64_t frames = 0;
+		if(!reader.value(frames))
+			return false;
+		m_frames.clear();
+		m_frames.resize(size_t(frames));
+
+		for(ReplayFrame& frame : m_frames)
+		{
+			uint64_t tick = 0, delta = 0;
+			uint32_t events = 0;
+			if(!reader.value(tick) || !reader.value(delta) || !reader.value(frame.m_hash) || !reader.value(events))
+			{
+				printf("[warning] World recording is truncated\n");
+				return false;
+			}
+
+			frame.m_tick = size_t(tick);
+			frame.m_delta = size_t(delta);
+			frame.m_events.resize(events);
+			for(ReplayEvent& event : frame.m_events)
+			{
+				uint32_t size = 0;
+				if(!reader.value(event.m_channel) || !reader.value(size) || event.m_channel >= channels)
+					return false;
+				const uint8_t* payload = reader.skip(size);
+				if(!payload)
+					return false;
+				event.m_data.assign(payload, payload + size);
+			}
+		}
+		return true;
+	}
+
+	WorldRecorder::WorldRecorder(WorldSnapshot& snapshot)
+		: m_snapshot(snapshot)
+	{
+		auto apply = [this](World& world, const uint8_t* data, size_t size) { this->apply_procedure(world, data, size); };
+		m_channels.push_back({ "procedure", apply });
+	}
+
+	WorldRecorder::~WorldRecorder()
+	{}
+
+	uint32_t WorldRecorder::channel_index(const string& name)
+	{
+		for(size_t i = 0; i < m_recording.m_channels.size(); ++i)
+			if(m_recording.m_channels[i] == name)
+				return uint32_t(i);
+		m_recording.m_channels.push_back(name);
+		return uint32_t(m_recording.m_channels.size() - 1);
+	}
+
+	void WorldRecorder::input(World& world, const string& name, const vector<uint8_t>& data)
+	{
+		// while replaying, the world is only driven by the recorded inputs
+		if(m_mode == Mode::Replay)
+			return;
+
+		Channel* channel = nullptr;
+		for(Channel& c : m_channels)
+			if(c.m_name == name)
+				channel = &c;
+
+		if(!channel)
+		{
+			printf("[warning] World recorder channel %s is not registered\n", name.c_str());
+			return;
+		}
+
+		if(m_mode == Mode::Record)
+			m_events.push_back({ this->channel_index(name), data });
+
+		channel->m_apply(world, data.data(), data.size());
+	}
+
+	void WorldRecorder::apply(World& world, const ReplayEvent& event)
+	{
+		const string& name = m_recording.m_channels[event.m_channel];
+		for(Channel& channel : m_channels)
+			if(channel.m_name == name)
+			{
+				channel.m_apply(world, event.m_data.data(), event.m_data.size());
+				return;
+			}
+
+		printf("[warning] World replay channel %s is not registered, its input is skipped\n", name.c_str());
+	}
+
+	void WorldRecorder::procedure_type(ProcedureType& type)
+	{
+		m_procedures.push_back(&type);
+	}
+
+	void WorldRecorder::procedure(World& world, Procedure& procedure)
+	{
+		if(m_mode == Mode::Replay)
+			return;
+
+		if(m_mode == Mode::Record)
+		{
+			vector<Entity> entities;
+			vector<uint8_t> data;
+			PageWriter writer = { data };
+
+			// the values referenced by the procedure are copied, the entities are stored by their number in the tree
+			auto write_ref = [&](Ref ref)
+			{
+				if(!ref.m_value || !ref.m_type)
+				{
+					writer.value(RefKind::Null);
+					return;
+				}
+
+				Type& type = *ref.m_type;
+				if(const WorldSnapshot::Handle* handle = m_snapshot.find_handle(type))
+				{
+					if(entities.empty())
+						entities = world_entities(world);
+
+					Entity entity = handle->m_get(ref.m_value);
+					uint32_t number = UINT32_MAX;
+					for(size_t i = 0; i < entities.size(); ++i)
+						if(same_entity(entities[i], entity))
+							number = uint32_t(i);
+
+					writer.value(RefKind::Handle);
+					write_string(writer, meta(type).m_name);
+					writer.value(number);
+				}
+				else if(type.is<string>())
+				{
+					writer.value(RefKind::String);
+					write_string(writer, meta(type).m_name);
+					write_string(writer, *static_cast<const string*>(ref.m_value));
+				}
+				else if(is_base_type(type) || is_enum(type))
+				{
+					writer.value(RefKind::Raw);
+					write_string(writer, meta(type).m_name);
+					writer.value(uint32_t(meta(type).m_size));
+					writer.bytes(ref.m_value, meta(type).m_size);
+				}
+				else
+				{
+					printf("[warning] World recorder can't record a procedure argument of type %s, it is replayed null\n", meta(type).m_name);
+					writer.value(RefKind::Null);
+				}
+			};
+
+			write_string(writer, procedure.m_def.m_name);
+			write_ref(procedure.m_object);
+			writer.value(uint32_t(procedure.m_args.size()));
+			for(Ref arg : procedure.m_args)
+				write_ref(arg);
+
+			m_events.push_back({ this->channel_index("procedure"), data });
+		}
+
+		procedure.execute();
+	}
+
+	void WorldRecorder::apply_procedure(World& world, const uint8_t* data, size_t size)
+	{
+		PageReader reader = { data, size };
+
+		string name;
+		if(!read_string(reader, name))
+			return;
+
+		ProcedureType* type = nullptr;
+		for(ProcedureType* procedure : m_procedures)
+			if(procedure->m_name == name)
+				type = procedure;
+
+		if(!type)
+		{
+			printf("[warning] World replay procedure %s is not registered, it is skipped\n", name.c_str());
+			return;
+		}
+
+		vector<Entity> entities;
+
+		// the values live until the procedure is executed : the strings are reserved so that they never move
+		vector<vector<uint8_t>> buffers;
+		vector<string> strings;
+		buffers.reserve(32);
+		strings.reserve(32);
+
+		auto read_ref = [&]() -> Ref
+		{
+			RefKind kind = RefKind::Null;
+			string type_name;
+			if(!reader.value(kind) || kind == RefKind::Null || !read_string(reader, type_name))
+				return Ref();
+
+			Type* value_type = System::instance().find_type(type_name.c_str());
+			if(!value_type || buffers.size() == buffers.capacity() || strings.size() == strings.capacity())
+				return Ref();
+
+			if(kind == RefKind::Handle)
+			{
+				uint32_t number = UINT32_MAX;
+				const WorldSnapshot::Handle* handle = m_snapshot.find_handle(*value_type);
+				if(!reader.value(number) || !handle)
+					return Ref();
+
+				if(entities.empty())
+					entities = world_entities(world);
+
+				buffers.emplace_back(meta(*value_type).m_size, uint8_t(0));
+				handle->m_set(buffers.back().data(), number < entities.size() ? entities[number] : Entity());
+				return Ref(buffers.back().data(), *value_type);
+			}
+			else if(kind == RefKind::String)
+			{
+				strings.emplace_back();
+				if(!read_string(reader, strings.back()))
+					return Ref();
+				return Ref(&strings.back(), *value_type);
+			}
+			else
+			{
+				uint32_t value_size = 0;
+				const uint8_t* value = reader.value(value_size) ? reader.skip(value_size) : nullptr;
+				if(!value || value_size != meta(*value_type).m_size)
+					return Ref();
+				buffers.emplace_back(value, value + value_size);
+				return Ref(buffers.back().data(), *value_type);
+			}
+		};
+
+		Ref target = read_ref();
+		uint32_t count = 0;
+		reader.value(count);
+
+		vector<Ref> args;
+		for(uint32_t i = 0; i < count; ++i)
+			args.push_back(read_ref());
+
+		object<Procedure> procedure = type->instance(m_user, target, args);
+		if(procedure)
+			procedure->execute();
+	}
+
+	void WorldRecorder::record(World& world, uint32_t seed, bool snapshot)
+	{
+		m_recording = {};
+		m_recording.m_seed = seed;
+		m_recording.m_hash_interval = m_hash_interval;
+		if(snapshot)
+			m_snapshot.save(world, m_recording.m_snapshot);
+
+		m_events.clear();
+		m_frame = 0;
+		m_tick = world.m_pump.m_clock.readTick();
+		m_mode = Mode::Record;
+	}
+
+	bool WorldRecorder::stop(const string& path)
+	{
+		if(m_mode != Mode::Record)
+			return false;
+
+		m_mode = Mode::None;
+
+		vector<uint8_t> data;
+		m_recording.write(data);
+		if(!WorldSnapshot::write_file(path, data))
+			return false;
+
+		printf("[info] Recorded %s : %zu frames, %zu bytes\n", path.c_str(), m_recording.m_frames.size(), data.size());
+		return true;
+	}
+
+	bool WorldRecorder::replay(World& world, const string& path)
+	{
+		vector<uint8_t> data;
+		if(!WorldSnapshot::read_file(path, data) || !m_recording.read(data))
+			return false;
+
+		if(!m_recording.m_snapshot.empty() && !m_snapshot.load(world, m_recording.m_snapshot))
+			return false;
+
+		m_frame = 0;
+		m_divergence = SIZE_MAX;
+		m_mode = Mode::Replay;
+		return true;
+	}
+
+	uint64_t WorldRecorder::hash(World& world)
+	{
+		// the snapshot stores handles as entity numbers : two worlds in the same state hash the same, whatever their entity handles
+		m_snapshot.capture(world, m_image);
+
+		uint64_t hash = hash_bytes(m_image.m_masks.data(), m_image.m_masks.size() * sizeof(uint64_t));
+		for(const WorldSnapshot::Section& section : m_image.m_sections)
+			if(section.m_data)
+				hash = hash_bytes(section.m_data->data(), section.m_data->size(), hash);
+		return hash;
+	}
+
+	void WorldRecorder::next_frame(World& world)
+	{
+		if(m_mode == Mode::Replay && m_frame >= m_recording.m_frames.size())
+			this->finish();
+
+		if(m_mode == Mode::None)
+		{
+			world.next_frame();
+			return;
+		}
+
+		if(m_mode == Mode::Record)
+		{
+			ReplayFrame frame;
+			frame.m_events = move(m_events);
+			m_events.clear();
+
+			// the clock is stepped even with a fixed delta, so that the first frame after the recording doesn't catch up
+			frame.m_tick = world.m_pump.m_clock.readTick();
+			frame.m_delta = world.m_pump.m_clock.stepTick();
+			if(m_fixed_delta > 0)
+			{
+				frame.m_tick = m_tick;
+				frame.m_delta = m_fixed_delta;
+				m_tick += m_fixed_delta;
+			}
+
+			m_clock.update();
+			world.next_frame(frame.m_tick, frame.m_delta);
+			m_frame_time = m_clock.read();
+
+			if(m_hash_interval > 0 && m_frame % m_hash_interval == 0)
+				frame.m_hash = this->hash(world);
+
+			m_recording.m_frames.push_back(move(frame));
+			++m_frame;
+			return;
+		}
+
+		const ReplayFrame& frame = m_recording.m_frames[m_frame];
+		for(const ReplayEvent& event : frame.m_events)
+			this->apply(world, event);
+
+		world.m_pump.m_clock.stepTick();
+
+		m_clock.update();
+		world.next_frame(frame.m_tick, frame.m_delta);
+		m_frame_time = m_clock.read();
+
+		if(frame.m_hash != 0 && m_divergence == SIZE_MAX && this->hash(world) != frame.m_hash)
+		{
+			m_divergence = m_frame;
+			printf("[warning] Replay diverged from the recording at frame %zu, tick %zu\n", m_frame, frame.m_tick);
+		}
+
+		++m_frame;
+	}
+
+	void WorldRecorder::finish()
+	{
+		if(m_divergence == SIZE_MAX)
+			printf("[info] Replayed %zu frames, identical to the recording\n", m_frame);
+		m_mode = Mode::None;
+	}
+
+	bool WorldRecorder::run(World& world, const string& path)
+	{
+		if(!this->replay(world, path))
+			return false;
+
+		double total = 0.0;
+		double slowest = 0.0;
+		size_t slowest_frame = 0;
+
+		const size_t count = m_recording.m_frames.size();
+		while(m_mode == Mode::Replay && m_frame < count)
+		{
+			const size_t frame = m_frame;
+			this->next_frame(world);
+
+			total += m_frame_time;
+			if(m_frame_time > slowest)
+			{
+				slowest = m_frame_time;
+				slowest_frame = frame;
+			}
+		}
+
+		this->finish();
+
+		printf("[info] Replay %s : %zu frames in %.2f ms, %.3f ms per frame, slowest frame %zu in %.3f ms\n", path.c_str(), count,
+			   total * 1000.0, count > 0 ? total * 1000.0 / double(count) : 0.0, slowest_frame, slowest * 1000.0);
+		return m_divergence == SIZE_MAX;
+	}
+}
@@ -0,0 +1,135 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#pragma once
+
+#include <stl/vector.h>
+#include <stl/string.h>
+#include <stl/function.h>
+#include <math/Timer.h>
+#include <util/Forward.h>
+#include <core/Forward.h>
+#include <core/World/Snapshot.h>
+
+#include <stdint.h>
+
+namespace toy
+{
+	// an input or a procedure, applied to the world before the frame it's recorded in
+	struct ReplayEvent
+	{
+		uint32_t m_channel = 0;
+		vector<uint8_t> m_data;
+	};
+
+	struct ReplayFrame
+	{
+		size_t m_tick = 0;
+		size_t m_delta = 0;
+		// hash of the world after the frame, zero when the frame is not hashed
+		uint64_t m_hash = 0;
+		vector<ReplayEvent> m_events;
+	};
+
+	// a recorded session : the world it starts from, and each frame with the ticks it advanced by and the events applied before it
+	struct TOY_CORE_EXPORT WorldRecording
+	{
+		// the seed the game generates the world from, when there is no snapshot
+		uint32_t m_seed = 0;
+		vector<uint8_t> m_snapshot;
+		size_t m_hash_interval = 1;
+		// events refer to their channel by index in this list
+		vector<string> m_channels;
+		vector<ReplayFrame> m_frames;
+
+		void write(vector<uint8_t>& data) const;
+		bool read(const vector<uint8_t>& data);
+	};
+
+	/* Records the frames of a world and replays them deterministically :
+		- the world only changes through its own frames, and through the inputs and procedures passed to the recorder
+		- an input goes through a named channel : it's applied as soon as it's recorded, and before the next frame when replayed
+		- each frame is recorded with the ticks it advanced by : a replay doesn't depend on the time it takes, and runs without a window
+		- a fixed delta makes the recorded frames all advance by the same ticks, regardless of the time elapsed
+		- the world is hashed every few frames, from its snapshot : a replay reports the first frame where it diverges
+		- procedures are recorded by name, their object and arguments being values of base types, strings, or handles to entities
+	*/
+
+	class TOY_CORE_EXPORT WorldRecorder
+	{
+	public:
+		WorldRecorder(WorldSnapshot& snapshot);
+		~WorldRecorder();
+
+		enum class Mode : unsigned int { None, Record, Replay };
+
+		WorldSnapshot& m_snapshot;
+		// the user the replayed procedures are executed as
+		User* m_user = nullptr;
+
+		Mode m_mode = Mode::None;
+		// ticks every recorded frame advances by, zero to follow the clock of the world
+		size_t m_fixed_delta = 0;
+		// the world is hashed every that many frames, zero to never hash it
+		size_t m_hash_interval = 1;
+
+		WorldRecording m_recording;
+		size_t m_frame = 0;
+		// first replayed frame where the world differs from the recording
+		size_t m_divergence = SIZE_MAX;
+		// time the world took to advance on the last frame, in seconds
+		double m_frame_time = 0.0;
+
+		struct Channel
+		{
+			string m_name;
+			function<void(World&, const uint8_t*, size_t)> m_apply;
+		};
+
+		vector<Channel> m_channels;
+		vector<ProcedureType*> m_procedures;
+
+		// inputs of a channel are values copied as is
+		template <class T>
+		void channel(const string& name, function<void(World&, const T&)> apply);
+		template <class T>
+		void input(World& world, const string& name, const T& value);
+
+		void input(World& world, const string& name, const vector<uint8_t>& data);
+
+		// procedures are replayed by the name of their type, which must be registered
+		void procedure_type(ProcedureType& type);
+		void procedure(World& world, Procedure& procedure);
+
+		// starts recording, from a snapshot of the world, or from the seed the game generated it from
+		void record(World& world, uint32_t seed, bool snapshot = true);
+		bool stop(const string& path);
+
+		// starts replaying a recording : the world is loaded from its snapshot, or must already be generated from its seed
+		bool replay(World& world, const string& path);
+
+		// advances the world by one frame : recorded, replayed, or as usual
+		void next_frame(World& world);
+
+		// replays a whole recording at once, and reports the time each frame took : returns false when the replay diverged
+		bool run(World& world, const string& path);
+
+		bool recording() const { return m_mode == Mode::Record; }
+		bool replaying() const { return m_mode == Mode::Replay; }
+
+		uint64_t hash(World& world);
+
+	private:
+		uint32_t channel_index(const string& name);
+		void apply(World& world, const ReplayEvent& event);
+		void apply_procedure(World& world, const uint8_t* data, size_t size);
+		void finish();
+
+		Clock m_clock;
+		size_t m_tick = 0;
+		vector<ReplayEvent> m_events;
+		WorldSnapshot::Image m_image;
+	};
+}
@@ -0,0 +1,35 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#pragma once
+
+#include <core/Forward.h>
+#include <core/World/Replay.h>
+
+#include <string.h>
+
+namespace toy
+{
+	template <class T>
+	void WorldRecorder::channel(const string& name, function<void(World&, const T&)> apply)
+	{
+		auto decode = [apply](World& world, const uint8_t* data, size_t size)
+		{
+			if(size != sizeof(T))
+				return;
+			T value;
+			memcpy(&value, data, sizeof(T));
+			apply(world, value);
+		};
+		m_channels.push_back({ name, decode });
+	}
+
+	template <class T>
+	void WorldRecorder::input(World& world, const string& name, const T& value)
+	{
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+		this->input(world, name, vector<uint8_t>(bytes, bytes + sizeof(T)));
+	}
+}
@@ -18,14 +18,31 @@ namespace toy
 	{
 		size_t tick = m_clock.readTick();
 		size_t delta = m_clock.stepTick();
+		this->pump(tick, delta);
+	}
 
+	void JobPump::pump(size_t tick, size_t delta)
+	{
 		for(auto& step : m_steps)
 			step.m_handler(tick, delta);
 	}
 
 	void JobPump::add_step(Entry entry)
 	{
+		entry.m_module = m_scope;
+		if(!entry.m_owner)
+			entry.m_owner = m_owner;
 		m_steps.push_back(entry);
 		std::sort(m_steps.begin(), m_steps.end(), [&](const Entry& a, const Entry& b) { return a.m_task < b.m_task; });
 	}
+
+	void JobPump::remove_steps(Module& module)
+	{
+		m_steps.erase(std::remove_if(m_steps.begin(), m_steps.end(), [&](const Entry& entry) { return entry.m_module == &module; }), m_steps.end());
+	}
+
+	void JobPump::remove_steps(void* owner)
+	{
+		m_steps.erase(std::remove_if(m_steps.begin(), m_steps.end(), [&](const Entry& entry) { return entry.m_owner == owner; }), m_steps.end());
+	}
 }
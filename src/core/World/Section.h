@@ -7,6 +7,7 @@
 
 #include <stl/vector.h>
 #include <stl/function.h>
+#include <refl/Forward.h>
 #include <core/Forward.h>
 #include <math/Timer.h>
 
@@ -35,14 +36,27 @@ namespace toy
 		JobPump();
 
 		void pump();
-		
+		// runs the steps for a given tick and delta, without reading the clock : a replayed frame advances by the recorded ticks
+		void pump(size_t tick, size_t delta);
+
 		struct Entry
 		{
 			Task m_task;
 			function<void(size_t tick, size_t delta)> m_handler;
+			Module* m_module = nullptr;
+			void* m_owner = nullptr;
 		};
 
 		void add_step(Entry entry);
+		// removes the steps added while a module was in scope, before it is reloaded
+		void remove_steps(Module& module);
+		// removes the steps of an object, before it is destroyed
+		void remove_steps(void* owner);
+
+		// steps added while a module is in scope belong to it
+		Module* m_scope = nullptr;
+		// steps added while an owner is set belong to it
+		void* m_owner = nullptr;
 
 		vector<Entry> m_steps;
 		Clock m_clock;
@@ -0,0 +1,626 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#include <stl/map.h>
+#include <stl/algorithm.h>
+#include <refl/Api.h>
+#include <refl/Module.h>
+#include <core/Types.h>
+#include <core/World/Snapshot.h>
+#include <core/World/Snapshot.hpp>
+#include <core/World/World.h>
+#include <core/WorldPage/PageCache.h>
+#include <core/Spatial/Spatial.h>
+#include <core/Movable/Movable.h>
+#include <core/Camera/Camera.h>
+#include <core/Physic/Scope.h>
+#include <core/Script/Script.h>
+#include <core/WorldPage/WorldPage.h>
+#include <core/Navmesh/Navmesh.h>
+#include <core/Path/DetourPath.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+namespace toy
+{
+	static const uint32_t SNAPSHOT_MAGIC = 'S'<<24 | 'N'<<16 | 'A'<<8 | 'P'; //'SNAP';
+	static const uint32_t SNAPSHOT_FORMAT = 1;
+
+	using FieldKind = WorldSnapshot::FieldKind;
+	using SnapshotField = WorldSnapshot::Field;
+
+	static uint64_t entity_key(Entity entity)
+	{
+		return (uint64_t(entity.m_stream) << 32) | uint64_t(entity.m_handle);
+	}
+
+	// base types, enums, and structs made only of those, can be copied as is
+	static bool plain(Type& type)
+	{
+		if(type.is<string>())
+			return false;
+		if(is_base_type(type) || is_enum(type))
+			return true;
+		if(!is_struct(type) || cls(type).m_members.empty())
+			return false;
+
+		for(Member& member : cls(type).m_members)
+			if(member.m_offset == SIZE_MAX || member.is_pointer() || !plain(*member.m_type))
+				return false;
+		return true;
+	}
+
+	const WorldSnapshot::Handle* WorldSnapshot::find_handle(Type& type) const
+	{
+		for(const Handle& handle : m_handles)
+			if(handle.m_type == &type)
+				return &handle;
+		return nullptr;
+	}
+
+	static SnapshotField* find_field(vector<SnapshotField>& fields, const string& name)
+	{
+		for(SnapshotField& field : fields)
+			if(field.m_name == name)
+				return &field;
+		return nullptr;
+	}
+
+	static void gather_fields(const WorldSnapshot& snapshot, Type& type, size_t offset, vector<SnapshotField>& fields)
+	{
+		Class& c = cls(type);
+		for(size_t i = 0; i < c.m_bases.size(); ++i)
+			gather_fields(snapshot, *c.m_bases[i], offset + c.m_bases_offsets[i], fields);
+
+		for(Member& member : c.m_members)
+		{
+			if(member.m_offset == SIZE_MAX || member.is_pointer() || find_field(fields, member.m_name))
+				continue;
+
+			const size_t at = offset + member.m_offset;
+			if(const WorldSnapshot::Handle* handle = snapshot.find_handle(*member.m_type))
+				fields.push_back({ member.m_name, at, FieldKind::Handle, uint32_t(sizeof(uint32_t)), member.m_type, handle });
+			else if(member.m_type->is<string>())
+				fields.push_back({ member.m_name, at, FieldKind::String, 0U, member.m_type, nullptr });
+			else if(plain(*member.m_type))
+				fields.push_back({ member.m_name, at, FieldKind::Raw, uint32_t(meta(*member.m_type).m_size), member.m_type, nullptr });
+		}
+	}
+
+	void WorldSnapshot::fields(Type& type, vector<Field>& fields) const
+	{
+		gather_fields(*this, type, 0, fields);
+	}
+
+	static void write_string(PageWriter& writer, const string& value)
+	{
+		writer.value(uint32_t(value.size()));
+		writer.bytes(value.data(), value.size());
+	}
+
+	static bool read_string(PageReader& reader, string& value)
+	{
+		uint32_t size = 0;
+		if(!reader.value(size))
+			return false;
+		const uint8_t* data = reader.skip(size);
+		if(!data)
+			return false;
+		value = string((const char*)data, size);
+		return true;
+	}
+
+	WorldSnapshot::WorldSnapshot()
+	{
+		core_snapshot(*this);
+	}
+
+	uint64_t WorldSnapshot::mask(Entity entity) const
+	{
+		uint64_t mask = 0;
+		for(const Component& component : m_components)
+			if(component.m_get(entity))
+				mask |= uint64_t(1) << component.m_buffer;
+		return mask;
+	}
+
+	static void gather_entities(HSpatial spatial, vector<Entity>& entities)
+	{
+		for(HSpatial child : spatial->m_contents)
+		{
+			entities.push_back(child);
+			gather_entities(child, entities);
+		}
+	}
+
+	void WorldSnapshot::clear(World& world)
+	{
+		for(HSpatial root : { world.origin(), world.unworld() })
+		{
+			vector<HSpatial> contents = root->m_contents;
+			for(HSpatial child : contents)
+				destroy_spatial(child);
+		}
+	}
+
+	void WorldSnapshot::capture(World& world, Image& image)
+	{
+		// the roots are numbered first, they are never created on load
+		vector<Entity> entities = { world.origin(), world.unworld() };
+		gather_entities(world.origin(), entities);
+		gather_entities(world.unworld(), entities);
+
+		vector<uint64_t> keys(entities.size());
+		map<uint64_t, uint32_t> numbers;
+		for(size_t i = 0; i < entities.size(); ++i)
+		{
+			keys[i] = entity_key(entities[i]);
+			numbers[keys[i]] = uint32_t(i);
+		}
+
+		// sections store entity numbers : they can only be kept when the entities are numbered the same
+		const bool same_entities = keys == image.m_keys && image.m_sections.size() == m_components.size();
+		image.m_keys = move(keys);
+		image.m_entities = entities;
+		image.m_masks.resize(entities.size());
+		for(size_t i = 0; i < entities.size(); ++i)
+			image.m_masks[i] = this->mask(entities[i]);
+
+		image.m_sections.resize(m_components.size());
+		image.m_reused = 0;
+
+		vector<uint32_t> rows;
+		vector<void*> objects;
+		vector<SnapshotField> fields;
+
+		for(size_t c = 0; c < m_components.size(); ++c)
+		{
+			const Component& component = m_components[c];
+			Section& section = image.m_sections[c];
+
+			rows.clear();
+			objects.clear();
+			uint64_t version = 0;
+			for(size_t i = 2; i < entities.size(); ++i)
+				if(void* object = component.m_get(entities[i]))
+				{
+					rows.push_back(uint32_t(i));
+					objects.push_back(object);
+					if(component.m_version)
+						version += component.m_version(object);
+				}
+
+			// versions only grow : while their sum is the same, none of the rows changed
+			if(same_entities && component.m_version && section.m_data && section.m_version == version)
+			{
+				image.m_reused++;
+				continue;
+			}
+
+			fields.clear();
+			this->fields(*component.m_type, fields);
+
+			// a section still referenced by a previous image is never modified, it is replaced
+			section.m_buffer = component.m_buffer;
+			section.m_name = meta(*component.m_type).m_name;
+			section.m_version = version;
+			section.m_data = std::make_shared<vector<uint8_t>>();
+
+			PageWriter columns = { *section.m_data };
+			columns.value(uint32_t(rows.size()));
+			columns.bytes(rows.data(), rows.size() * sizeof(uint32_t));
+			columns.value(uint32_t(fields.size()));
+
+			for(const SnapshotField& field : fields)
+			{
+				write_string(columns, field.m_name);
+				columns.value(field.m_kind);
+				columns.value(field.m_size);
+
+				for(void* object : objects)
+				{
+					const uint8_t* value = static_cast<const uint8_t*>(object) + field.m_offset;
+					if(field.m_kind == FieldKind::Raw)
+						columns.bytes(value, field.m_size);
+					else if(field.m_kind == FieldKind::String)
+						write_string(columns, *reinterpret_cast<const string*>(value));
+					else if(field.m_kind == FieldKind::Handle)
+					{
+						// handles to entities outside of the world, or already destroyed, are stored null
+						Entity target = field.m_handle->m_get(value);
+						auto it = target ? numbers.find(entity_key(target)) : numbers.end();
+						columns.value(uint32_t(it != numbers.end() ? it->second : UINT32_MAX));
+					}
+				}
+			}
+		}
+	}
+
+	void WorldSnapshot::write(const Image& image, vector<uint8_t>& data)
+	{
+		data.clear();
+		PageWriter writer = { data };
+		writer.value(SNAPSHOT_MAGIC);
+		writer.value(SNAPSHOT_FORMAT);
+		writer.value(uint32_t(image.m_masks.size()));
+		writer.value(uint32_t(image.m_sections.size()));
+		writer.bytes(image.m_masks.data(), image.m_masks.size() * sizeof(uint64_t));
+
+		for(const Section& section : image.m_sections)
+		{
+			writer.value(section.m_buffer);
+			write_string(writer, section.m_name);
+			writer.value(uint64_t(section.m_data->size()));
+			writer.bytes(section.m_data->data(), section.m_data->size());
+		}
+	}
+
+	bool WorldSnapshot::save(World& world, vector<uint8_t>& data)
+	{
+		Image image;
+		this->capture(world, image);
+		WorldSnapshot::write(image, data);
+
+		m_entities = image.m_masks.size();
+		m_size = data.size();
+		return true;
+	}
+
+	Entity WorldSnapshot::create(World& world, uint64_t mask) const
+	{
+		uint64_t registered = 0;
+		for(const Component& component : m_components)
+			registered |= uint64_t(1) << component.m_buffer;
+
+		for(const Archetype& archetype : m_archetypes)
+			if((archetype.m_mask & registered) == mask)
+				return archetype.m_create(world.m_ecs);
+		return Entity();
+	}
+
+	// fields are matched by name with the ones of the registered component, only the rows of the restored entities are written
+	void WorldSnapshot::read_section(uint32_t buffer, const string& name, const uint8_t* payload, size_t size, const vector<Entity>& entities, const vector<bool>& restored)
+	{
+		const Component* component = nullptr;
+		for(const Component& c : m_components)
+			if(c.m_buffer == buffer && name == meta(*c.m_type).m_name)
+				component = &c;
+
+		if(!component)
+		{
+			printf("[warning] World snapshot component %s is not registered, skipped\n", name.c_str());
+			return;
+		}
+
+		vector<SnapshotField> fields;
+		this->fields(*component->m_type, fields);
+
+		const size_t count = entities.size();
+
+		PageReader columns = { payload, size };
+		uint32_t num_rows = 0, num_fields = 0;
+		if(!columns.value(num_rows) || num_rows > columns.remaining() / sizeof(uint32_t))
+		{
+			printf("[warning] World snapshot component %s is truncated\n", name.c_str());
+			return;
+		}
+
+		vector<uint32_t> rows(num_rows);
+		columns.bytes(rows.data(), rows.size() * sizeof(uint32_t));
+		columns.value(num_fields);
+
+		for(uint32_t f = 0; f < num_fields; ++f)
+		{
+			string field_name;
+			FieldKind kind = FieldKind::Raw;
+			uint32_t field_size = 0;
+			if(!read_string(columns, field_name) || !columns.value(kind) || !columns.value(field_size))
+				break;
+
+			SnapshotField* field = find_field(fields, field_name);
+			if(field && (field->m_kind != kind || field->m_size != field_size))
+			{
+				printf("[warning] World snapshot field %s::%s changed type, skipped\n", name.c_str(), field_name.c_str());
+				field = nullptr;
+			}
+
+			for(uint32_t row : rows)
+			{
+				Entity entity = row < count && restored[row] ? entities[row] : Entity();
+				uint8_t* object = field && entity ? static_cast<uint8_t*>(component->m_get(entity)) : nullptr;
+				uint8_t* value = object ? object + field->m_offset : nullptr;
+
+				if(kind == FieldKind::Raw)
+				{
+					const uint8_t* source = columns.skip(field_size);
+					if(value && source)
+						memcpy(value, source, field_size);
+				}
+				else if(kind == FieldKind::String)
+				{
+					string text;
+					if(read_string(columns, text) && value)
+						*reinterpret_cast<string*>(value) = text;
+				}
+				else if(kind == FieldKind::Handle)
+				{
+					uint32_t number = UINT32_MAX;
+					if(columns.value(number) && value)
+						field->m_handle->m_set(value, number < count ? entities[number] : Entity());
+				}
+			}
+		}
+
+		if(columns.m_offset == SIZE_MAX)
+			printf("[warning] World snapshot component %s is truncated\n", name.c_str());
+	}
+
+	// pointers are not stored, and the contents of each spatial are rebuilt in the order they were saved
+	void WorldSnapshot::attach(World& world, const vector<Entity>& entities, const vector<bool>& restored)
+	{
+		for(size_t i = 2; i < entities.size(); ++i)
+			if(Spatial* spatial = restored[i] && entities[i] ? try_asa<Spatial>(entities[i]) : nullptr)
+			{
+				spatial->m_world = &world;
+				if(spatial->m_parent)
+					spatial->m_parent->m_contents.push_back(HSpatial(entities[i]));
+			}
+	}
+
+	Entity WorldSnapshot::Remap::operator()(Entity entity) const
+	{
+		auto it = m_entities.find(entity_key(entity));
+		if(it != m_entities.end())
+			return it->second;
+		return m_all ? Entity() : entity;
+	}
+
+	void WorldSnapshot::remap(function<void(World&, const Remap&)> remap)
+	{
+		m_remappers.push_back({ m_scope, remap });
+	}
+
+	void WorldSnapshot::rebind(World& world, const vector<Entity>& entities, const vector<bool>& restored, const Remap& remap)
+	{
+		for(const Component& component : m_components)
+			for(size_t i = 2; i < entities.size() && component.m_rebuild; ++i)
+				if(void* object = restored[i] && entities[i] ? component.m_get(entities[i]) : nullptr)
+					component.m_rebuild(object);
+
+		for(const Remapper& remapper : m_remappers)
+			remapper.m_remap(world, remap);
+	}
+
+	bool WorldSnapshot::load(World& world, const vector<uint8_t>& data)
+	{
+		PageReader reader = { data.data(), data.size() };
+
+		uint32_t magic = 0, format = 0, count = 0, sections = 0;
+		if(!reader.value(magic) || !reader.value(format) || !reader.value(count) || !reader.value(sections)
+		|| magic != SNAPSHOT_MAGIC || format != SNAPSHOT_FORMAT || count < 2)
+		{
+			printf("[warning] World snapshot is invalid or of an unknown format\n");
+			return false;
+		}
+
+		if(count > reader.remaining() / sizeof(uint64_t))
+		{
+			printf("[warning] World snapshot is truncated\n");
+			return false;
+		}
+
+		vector<uint64_t> masks(count);
+		reader.bytes(masks.data(), masks.size() * sizeof(uint64_t));
+
+		struct SectionHeader { uint32_t m_buffer = 0; string m_name; uint64_t m_size = 0; const uint8_t* m_payload = nullptr; };
+
+		// every section is checked before the world is cleared : an invalid snapshot leaves the world as it was
+		vector<SectionHeader> headers;
+		for(uint32_t s = 0; s < sections; ++s)
+		{
+			SectionHeader header;
+			if(!reader.value(header.m_buffer) || !read_string(reader, header.m_name) || !reader.value(header.m_size)
+			|| !(header.m_payload = reader.skip(size_t(header.m_size))))
+			{
+				printf("[warning] World snapshot is truncated\n");
+				return false;
+			}
+			headers.push_back(header);
+		}
+
+		WorldSnapshot::clear(world);
+
+		vector<Entity> entities(count);
+		entities[0] = world.origin();
+		entities[1] = world.unworld();
+
+		size_t missing = 0;
+		for(size_t i = 2; i < count; ++i)
+			if(!(entities[i] = this->create(world, masks[i])))
+				++missing;
+
+		if(missing > 0)
+			printf("[warning] World snapshot has %zu entities of no registered archetype, they are not loaded\n", missing);
+
+		vector<bool> restored(count, true);
+
+		for(const SectionHeader& header : headers)
+			this->read_section(header.m_buffer, header.m_name, header.m_payload, size_t(header.m_size), entities, restored);
+
+		WorldSnapshot::attach(world, entities, restored);
+
+		// the entities before the load are all gone
+		Remap remap;
+		remap.m_all = true;
+		this->rebind(world, entities, restored, remap);
+
+		m_entities = count;
+		m_size = data.size();
+		return true;
+	}
+
+	bool WorldSnapshot::save(World& world, const string& path)
+	{
+		vector<uint8_t> data;
+		this->save(world, data);
+		return WorldSnapshot::write_file(path, data);
+	}
+
+	bool WorldSnapshot::write_file(const string& path, const vector<uint8_t>& data)
+	{
+		// written aside then swapped : a failed or interrupted write never leaves a partial file at path
+		string temp = path + ".tmp";
+		FILE* fp = fopen(temp.c_str(), "wb");
+		if(!fp)
+		{
+			printf("[warning] World snapshot could not write %s\n", path.c_str());
+			return false;
+		}
+
+		fwrite(data.data(), data.size(), 1, fp);
+		bool success = ferror(fp) == 0;
+		fclose(fp);
+
+#ifdef _WIN32
+		success = success && MoveFileExA(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		success = success && rename(temp.c_str(), path.c_str()) == 0;
+#endif
+		if(!success)
+		{
+			printf("[warning] World snapshot could not write %s\n", path.c_str());
+			remove(temp.c_str());
+		}
+		return success;
+	}
+
+	bool WorldSnapshot::read_file(const string& path, vector<uint8_t>& data)
+	{
+		FILE* fp = fopen(path.c_str(), "rb");
+		if(!fp)
+		{
+			printf("[warning] World snapshot %s not found\n", path.c_str());
+			return false;
+		}
+
+		fseek(fp, 0, SEEK_END);
+		data.resize(size_t(ftell(fp)));
+		fseek(fp, 0, SEEK_SET);
+		bool success = data.empty() || fread(data.data(), data.size(), 1, fp) == 1;
+		fclose(fp);
+		return success;
+	}
+
+	bool WorldSnapshot::load(World& world, const string& path)
+	{
+		vector<uint8_t> data;
+		return WorldSnapshot::read_file(path, data) && this->load(world, data);
+	}
+
+	void WorldSnapshot::unbind(Module& module)
+	{
+		auto owned = [&](auto& entry) { return entry.m_module == &module; };
+		m_components.erase(std::remove_if(m_components.begin(), m_components.end(), owned), m_components.end());
+		m_handles.erase(std::remove_if(m_handles.begin(), m_handles.end(), owned), m_handles.end());
+		m_archetypes.erase(std::remove_if(m_archetypes.begin(), m_archetypes.end(), owned), m_archetypes.end());
+		m_remappers.erase(std::remove_if(m_remappers.begin(), m_remappers.end(), owned), m_remappers.end());
+	}
+
+	uint64_t WorldSnapshot::module_mask(Module& module) const
+	{
+		uint64_t mask = 0;
+		for(const Component& component : m_components)
+			for(Type* type : module.m_types)
+				if(component.m_type == type)
+					mask |= uint64_t(1) << component.m_buffer;
+		return mask;
+	}
+
+	vector<bool> WorldSnapshot::unload(Module& module, const Image& image)
+	{
+		const uint64_t buffers = this->module_mask(module);
+		const vector<Entity>& entities = image.m_entities;
+
+		map<uint64_t, uint32_t> numbers;
+		for(size_t i = 0; i < entities.size(); ++i)
+			numbers[image.m_keys[i]] = uint32_t(i);
+
+		// parents are numbered before their contents : an entity is unloaded along with its parent
+		vector<bool> unloaded(entities.size(), false);
+		vector<HSpatial> roots;
+		for(size_t i = 2; i < entities.size(); ++i)
+		{
+			HSpatial parent = HSpatial(entities[i])->m_parent;
+			auto it = parent ? numbers.find(entity_key(parent)) : numbers.end();
+			const bool with_parent = it != numbers.end() && unloaded[it->second];
+			unloaded[i] = with_parent || (image.m_masks[i] & buffers) != 0;
+			if(unloaded[i] && !with_parent)
+				roots.push_back(HSpatial(entities[i]));
+		}
+
+		for(HSpatial root : roots)
+			destroy_spatial(root);
+		return unloaded;
+	}
+
+	void WorldSnapshot::restore(World& world, const Image& image, const vector<bool>& unloaded)
+	{
+		vector<Entity> entities = image.m_entities;
+
+		size_t missing = 0;
+		for(size_t i = 2; i < entities.size(); ++i)
+			if(unloaded[i] && !(entities[i] = this->create(world, image.m_masks[i])))
+				++missing;
+
+		if(missing > 0)
+			printf("[warning] World snapshot has %zu entities of no registered archetype, they are not restored\n", missing);
+
+		for(const Section& section : image.m_sections)
+			if(section.m_data)
+				this->read_section(section.m_buffer, section.m_name, section.m_data->data(), section.m_data->size(), entities, unloaded);
+
+		WorldSnapshot::attach(world, entities, unloaded);
+
+		Remap remap;
+		for(size_t i = 2; i < entities.size(); ++i)
+			if(unloaded[i])
+				remap.m_entities[image.m_keys[i]] = entities[i];
+		this->rebind(world, entities, unloaded, remap);
+	}
+
+	void core_snapshot(WorldSnapshot& snapshot)
+	{
+		// spatials moved by the game or synced from physics are both marked updated
+		snapshot.component<Spatial>([](const Spatial& spatial) -> uint64_t { return spatial.m_last_updated; });
+		snapshot.component<Movable>();
+		snapshot.component<Camera>();
+		snapshot.component<Emitter>();
+		snapshot.component<Receptor>();
+		snapshot.component<EntityScript>();
+		snapshot.component<WorldPage>();
+		snapshot.component<Navblock>();
+		snapshot.component<Waypoint>();
+
+		snapshot.handle<HSpatial>();
+		snapshot.handle<HMovable>();
+		snapshot.handle<HCamera>();
+		snapshot.handle<HEmitter>();
+		snapshot.handle<HReceptor>();
+		snapshot.handle<HEntityScript>();
+		snapshot.handle<HWorldPage>();
+		snapshot.handle<HNavblock>();
+		snapshot.handle<HWaypoint>();
+
+		snapshot.archetype<Spatial, Movable, Camera>();
+		snapshot.archetype<Spatial, Waypoint>();
+	}
+}
@@ -0,0 +1,185 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#pragma once
+
+#include <stl/vector.h>
+#include <stl/string.h>
+#include <stl/map.h>
+#include <stl/function.h>
+#include <refl/Forward.h>
+#include <ecs/ECS.h>
+#include <core/Forward.h>
+
+#include <memory>
+#include <stdint.h>
+
+namespace toy
+{
+	/* Binary snapshot of the entities of a world, laid out from the reflection of their components :
+		- entities are numbered walking the spatial tree of the world, parents first, the two roots being 0 and 1
+		- one section per component, tagged with its ecs buffer index : the column of entity numbers, then one column per field
+		- values of base types, enums and plain structs of those are stored as is, strings with their size
+		- handles to entities are stored as entity numbers, and remapped to the entities created on load
+		- fields are matched by name on load : a field added since the snapshot keeps its default, a removed one is skipped
+		- entities are recreated from the archetype registered for their set of components
+		- runtime objects owned by a component are not stored : they are rebuilt once their entity is loaded or restored
+	*/
+
+	class TOY_CORE_EXPORT WorldSnapshot
+	{
+	public:
+		WorldSnapshot();
+
+		// entries registered while a module is in scope belong to it, they are removed when the module is reloaded
+		Module* m_scope = nullptr;
+
+		struct Component
+		{
+			Module* m_module;
+			Type* m_type;
+			uint32_t m_buffer;
+			function<void*(Entity)> m_get;
+			// version of a component, which grows each time it changes
+			function<uint64_t(const void*)> m_version;
+			// rebuilds the runtime objects the component owns, once its entity is loaded or restored
+			function<void(void*)> m_rebuild;
+		};
+
+		struct Handle
+		{
+			Module* m_module;
+			Type* m_type;
+			function<Entity(const void*)> m_get;
+			function<void(void*, Entity)> m_set;
+		};
+
+		struct Archetype
+		{
+			Module* m_module;
+			uint64_t m_mask;
+			function<Entity(ECS&)> m_create;
+		};
+
+		// entities replaced by a load or a restore : a load replaces all of them, a restore only the unloaded ones
+		struct Remap
+		{
+			map<uint64_t, Entity> m_entities;
+			bool m_all = false;
+
+			// the entity replacing an entity, the entity itself when it was kept, or a null entity when it is gone
+			Entity operator()(Entity entity) const;
+		};
+
+		// games remap the handles they hold outside of the world, which the snapshot doesn't see
+		struct Remapper
+		{
+			Module* m_module;
+			function<void(World&, const Remap&)> m_remap;
+		};
+
+		vector<Component> m_components;
+		vector<Handle> m_handles;
+		vector<Archetype> m_archetypes;
+		vector<Remapper> m_remappers;
+
+		// components with a version are only captured again once one of them changed
+		template <class T>
+		void component(uint64_t(*version)(const T&) = nullptr);
+
+		// the component must be registered first
+		template <class T>
+		void rebuild(function<void(T&)> rebuild);
+
+		void remap(function<void(World&, const Remap&)> remap);
+
+		template <class T>
+		void handle();
+
+		template <class... Types>
+		void archetype();
+
+		enum class FieldKind : uint8_t
+		{
+			Raw,
+			String,
+			Handle
+		};
+
+		// a stored member of a component, at its offset in the component
+		struct Field
+		{
+			string m_name;
+			size_t m_offset;
+			FieldKind m_kind;
+			uint32_t m_size;
+			Type* m_type;
+			const Handle* m_handle;
+		};
+
+		// stored fields of a type : members of the bases first, members computed by a getter and pointers are not stored
+		void fields(Type& type, vector<Field>& fields) const;
+		const Handle* find_handle(Type& type) const;
+
+		// components of an entity, as a mask of their ecs buffers
+		uint64_t mask(Entity entity) const;
+		// creates an entity of the archetype matching a mask, a null entity when none is registered
+		Entity create(World& world, uint64_t mask) const;
+		// sets the world of the restored spatials, and adds them to the contents of their parent, in order
+		static void attach(World& world, const vector<Entity>& entities, const vector<bool>& restored);
+		// rebuilds the runtime objects of the restored entities once they are attached, then lets the games remap their handles
+		void rebind(World& world, const vector<Entity>& entities, const vector<bool>& restored, const Remap& remap);
+
+		// a section is shared by the images that captured it, and never modified once captured
+		struct Section
+		{
+			uint32_t m_buffer = 0;
+			string m_name;
+			uint64_t m_version = 0;
+			std::shared_ptr<vector<uint8_t>> m_data;
+		};
+
+		// components of a world captured at a frame boundary, to be written on any thread
+		struct Image
+		{
+			vector<Entity> m_entities;
+			vector<uint64_t> m_keys;
+			vector<uint64_t> m_masks;
+			vector<Section> m_sections;
+			size_t m_reused = 0;
+		};
+
+		// captures the world into an image, keeping the sections of the previous capture whose components didn't change
+		void capture(World& world, Image& image);
+		static void write(const Image& image, vector<uint8_t>& data);
+		static bool write_file(const string& path, const vector<uint8_t>& data);
+		static bool read_file(const string& path, vector<uint8_t>& data);
+
+		bool save(World& world, vector<uint8_t>& data);
+		bool load(World& world, const vector<uint8_t>& data);
+
+		bool save(World& world, const string& path);
+		bool load(World& world, const string& path);
+
+		// removes every entity of the world, except for the two roots
+		static void clear(World& world);
+
+		// reloading a module in place : the world is captured, the entities holding a component of the module are unloaded,
+		// the entries of the module are unbound, and once the module is reloaded and has registered them again, the unloaded entities are restored
+		void unbind(Module& module);
+		uint64_t module_mask(Module& module) const;
+		vector<bool> unload(Module& module, const Image& image);
+		void restore(World& world, const Image& image, const vector<bool>& unloaded);
+
+		size_t m_entities = 0;
+		size_t m_size = 0;
+
+	private:
+		void read_section(uint32_t buffer, const string& name, const uint8_t* payload, size_t size, const vector<Entity>& entities, const vector<bool>& restored);
+	};
+
+	// components, handles and archetypes of the core module
+	TOY_CORE_EXPORT void core_snapshot(WorldSnapshot& snapshot);
+}
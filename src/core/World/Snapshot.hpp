@@ -0,0 +1,51 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#pragma once
+
+#include <ecs/ECS.hpp>
+#include <core/Forward.h>
+#include <core/World/Snapshot.h>
+
+namespace toy
+{
+	template <class T>
+	void WorldSnapshot::component(uint64_t(*version)(const T&))
+	{
+		auto get = [](Entity entity) -> void* { return try_asa<T>(entity); };
+		function<uint64_t(const void*)> versioned;
+		if(version)
+			versioned = [version](const void* object) { return version(*static_cast<const T*>(object)); };
+		m_components.push_back({ m_scope, &type<T>(), TypedBuffer<T>::index(), get, versioned });
+	}
+
+	template <class T>
+	void WorldSnapshot::rebuild(function<void(T&)> rebuild)
+	{
+		for(Component& component : m_components)
+			if(component.m_type == &type<T>())
+				component.m_rebuild = [rebuild](void* object) { rebuild(*static_cast<T*>(object)); };
+	}
+
+	template <class T>
+	void WorldSnapshot::handle()
+	{
+		auto get = [](const void* value) -> Entity { return *static_cast<const T*>(value); };
+		auto set = [](void* value, Entity entity) { *static_cast<T*>(value) = T(entity); };
+		m_handles.push_back({ m_scope, &type<T>(), get, set });
+	}
+
+	template <class... Types>
+	void WorldSnapshot::archetype()
+	{
+		uint64_t mask = 0;
+		uint32_t indices[] = { TypedBuffer<Types>::index()... };
+		for(uint32_t index : indices)
+			mask |= uint64_t(1) << index;
+
+		auto create = [](ECS& ecs) -> Entity { return ecs.create<Types...>(); };
+		m_archetypes.push_back({ m_scope, mask, create });
+	}
+}
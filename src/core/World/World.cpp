@@ -42,6 +42,18 @@ namespace toy
 
 		m_pump.add_step({ Task::Physics, update_colliders });
 
+		// the solids cooked by the pages enter the physics world between frames, outside of the parallel loops
+		auto update_solids = [&](size_t tick, size_t delta)
+		{
+			UNUSED(delta);
+			m_ecs.loop<WorldPage>([tick](WorldPage& page)
+			{
+				page.update_solids(tick);
+			});
+		};
+
+		m_pump.add_step({ Task::Physics, update_solids });
+
 		add_parallel_loop<Spatial>(Task::Spatial);
 		add_parallel_loop<Movable, Spatial>(Task::Spatial);
 		add_parallel_loop<Camera, Spatial>(Task::Spatial);
@@ -53,10 +65,17 @@ namespace toy
 	}
 
     World::~World()
-    {}
+    {
+		m_tasks.join();
+	}
 
     void World::next_frame()
     {
 		m_pump.pump();
     }
+
+	void World::next_frame(size_t tick, size_t delta)
+	{
+		m_pump.pump(tick, delta);
+	}
 }
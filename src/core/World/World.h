@@ -9,6 +9,7 @@
 #include <stl/string.h>
 #include <ecs/ECS.h>
 #include <core/Forward.h>
+#include <core/World/JobTasks.h>
 #include <core/World/Origin.h>
 #include <core/World/Section.h>
 #include <core/World/WorldClock.h>
@@ -29,11 +30,14 @@ namespace toy
 		JobSystem& m_job_system;
 		JobPump m_pump;
 		WorldClock m_clock;
+		// jobs started by the world components, joined before the world is torn down
+		JobTasks m_tasks;
 
 		attr_ graph_ HSpatial origin() { return m_origin; }
 		attr_ graph_ HSpatial unworld() { return m_unworld; }
 
 		void next_frame();
+		void next_frame(size_t tick, size_t delta);
 
 		template <class T_Component, class... Args>
 		void add_loop(Task task);
@@ -0,0 +1,228 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#include <util/Hash.h>
+#include <core/Types.h>
+#include <core/WorldPage/PageCache.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+namespace toy
+{
+	void PageWriter::bytes(const void* data, size_t size)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		m_data.insert(m_data.end(), bytes, bytes + size);
+	}
+
+	const uint8_t* PageReader::skip(size_t size)
+	{
+		if(m_offset > m_size || size > m_size - m_offset)
+		{
+			m_offset = SIZE_MAX;
+			return nullptr;
+		}
+		const uint8_t* data = m_data + m_offset;
+		m_offset += size;
+		return data;
+	}
+
+	bool PageReader::bytes(void* data, size_t size)
+	{
+		const uint8_t* source = this->skip(size);
+		if(source && size)
+			memcpy(data, source, size);
+		return source != nullptr;
+	}
+
+	static const uint32_t PAGECACHE_MAGIC = 'P'<<24 | 'A'<<16 | 'G'<<8 | 'E'; //'PAGE';
+	static const uint32_t PAGECACHE_FORMAT = 1;
+
+	struct PageCacheHeader
+	{
+		uint32_t magic;
+		uint32_t format;
+		uint32_t version;
+		uint32_t seed;
+		int32_t x;
+		int32_t z;
+		uint64_t size;
+		uint64_t hash;
+	};
+
+	PageCache::PageCache(const string& path, uint32_t version)
+		: m_path(path)
+		, m_version(version)
+	{}
+
+	string PageCache::page_path(const PageKey& key, const char* section) const
+	{
+		char name[128];
+		snprintf(name, sizeof(name), ".%i.%i.%08x.v%u.%s", key.m_coord.x, key.m_coord.y, key.m_seed, m_version, section);
+		return m_path + name;
+	}
+
+	bool PageCache::read(const PageKey& key, const char* section, vector<uint8_t>& data)
+	{
+		string path = this->page_path(key, section);
+		FILE* fp = fopen(path.c_str(), "rb");
+		if(!fp)
+		{
+			m_misses++;
+			return false;
+		}
+
+		PageCacheHeader header = {};
+		bool valid = fread(&header, sizeof(PageCacheHeader), 1, fp) == 1;
+		valid &= header.magic == PAGECACHE_MAGIC && header.format == PAGECACHE_FORMAT && header.version == m_version;
+		valid &= header.seed == key.m_seed && header.x == key.m_coord.x && header.z == key.m_coord.y;
+
+		// the size is checked against the rest of the file before anything is allocated for it
+		if(valid)
+		{
+			const long start = ftell(fp);
+			fseek(fp, 0, SEEK_END);
+			const long end = ftell(fp);
+			fseek(fp, start, SEEK_SET);
+			valid = start >= 0 && end >= start && header.size == uint64_t(end - start);
+		}
+
+		if(valid)
+		{
+			data.resize(size_t(header.size));
+			valid = data.empty() || fread(data.data(), data.size(), 1, fp) == 1;
+			valid &= hash_bytes(data.data(), data.size()) == header.hash;
+		}
+
+		fclose(fp);
+
+		if(!valid)
+		{
+			printf("[warning] Page cache %s is invalid or outdated\n", path.c_str());
+			data.clear();
+			m_misses++;
+			return false;
+		}
+
+		m_hits++;
+		return true;
+	}
+
+	bool PageCache::store(const PageKey& key, const char* section, const vector<uint8_t>& data)
+	{
+		if(m_verify)
+		{
+			vector<uint8_t> cached;
+			if(this->read(key, section, cached))
+			{
+				if(cached == data)
+					return true;
+
+				size_t first = 0;
+				while(first < cached.size() && first < data.size() && cached[first] == data[first])
+					++first;
+
+				printf("[warning] Page cache %s differs from the generated content at byte %zu (%zu cached bytes, %zu generated)\n",
+					   this->page_path(key, section).c_str(), first, cached.size(), data.size());
+				m_mismatches++;
+			}
+		}
+
+		return this->write(key, section, data);
+	}
+
+	bool PageCache::write(const PageKey& key, const char* section, const vector<uint8_t>& data)
+	{
+		PageCacheHeader header = {};
+		header.magic = PAGECACHE_MAGIC;
+		header.format = PAGECACHE_FORMAT;
+		header.version = m_version;
+		header.seed = key.m_seed;
+		header.x = key.m_coord.x;
+		header.z = key.m_coord.y;
+		header.size = data.size();
+		header.hash = hash_bytes(data.data(), data.size());
+
+		// written aside then swapped, each write with its own temporary : pages are stored from the cooking jobs
+		string path = this->page_path(key, section);
+		string temp = path + "." + to_string(m_writes++) + ".tmp";
+		FILE* fp = fopen(temp.c_str(), "wb");
+		if(!fp)
+		{
+			printf("[warning] Page cache could not write %s\n", path.c_str());
+			return false;
+		}
+
+		fwrite(&header, sizeof(PageCacheHeader), 1, fp);
+		if(!data.empty())
+			fwrite(data.data(), data.size(), 1, fp);
+
+		bool success = ferror(fp) == 0;
+		fclose(fp);
+
+#ifdef _WIN32
+		success = success && MoveFileExA(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		success = success && rename(temp.c_str(), path.c_str()) == 0;
+#endif
+		if(!success)
+			remove(temp.c_str());
+		return success;
+	}
+
+	uint64_t geometry_hash(const Geometry& geometry)
+	{
+		uint64_t hash = hash_bytes(geometry.m_vertices.data(), geometry.m_vertices.size() * sizeof(Vertex));
+		return hash_bytes(geometry.m_triangles.data(), geometry.m_triangles.size() * sizeof(Tri), hash);
+	}
+
+	// each chunk : hash, vertex count, triangle count, cooked size, then the vertices, triangles and cooked data
+	void write_chunks(PageWriter& writer, span<PageChunk> chunks)
+	{
+		writer.value(uint32_t(sizeof(Vertex)));
+		writer.value(uint32_t(chunks.size()));
+		for(const PageChunk& chunk : chunks)
+		{
+			writer.value(chunk.m_hash);
+			writer.value(uint32_t(chunk.m_geometry.m_vertices.size()));
+			writer.value(uint32_t(chunk.m_geometry.m_triangles.size()));
+			writer.value(uint32_t(chunk.m_cooked.size()));
+			writer.bytes(chunk.m_geometry.m_vertices.data(), chunk.m_geometry.m_vertices.size() * sizeof(Vertex));
+			writer.bytes(chunk.m_geometry.m_triangles.data(), chunk.m_geometry.m_triangles.size() * sizeof(Tri));
+			writer.bytes(chunk.m_cooked.data(), chunk.m_cooked.size());
+		}
+	}
+
+	bool read_chunks(PageReader& reader, vector<PageChunk>& chunks)
+	{
+		uint32_t vertex_size = 0;
+		uint32_t count = 0;
+		if(!reader.value(vertex_size) || vertex_size != sizeof(Vertex) || !reader.value(count))
+			return false;
+
+		chunks.resize(count);
+		for(PageChunk& chunk : chunks)
+		{
+			uint32_t vertices = 0, triangles = 0, cooked = 0;
+			if(!reader.value(chunk.m_hash) || !reader.value(vertices) || !reader.value(triangles) || !reader.value(cooked))
+				return false;
+
+			chunk.m_geometry.m_vertices.resize(vertices);
+			chunk.m_geometry.m_triangles.resize(triangles);
+			chunk.m_cooked.resize(cooked);
+			if(!reader.bytes(chunk.m_geometry.m_vertices.data(), vertices * sizeof(Vertex))
+			|| !reader.bytes(chunk.m_geometry.m_triangles.data(), triangles * sizeof(Tri))
+			|| !reader.bytes(chunk.m_cooked.data(), cooked))
+				return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,98 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#pragma once
+
+#include <stl/vector.h>
+#include <stl/string.h>
+#include <stl/span.h>
+#include <math/Vec.h>
+#include <geom/Geometry.h>
+#include <core/Forward.h>
+
+#include <atomic>
+#include <stdint.h>
+
+namespace toy
+{
+	struct PageKey
+	{
+		ivec2 m_coord = ivec2(0);
+		uint32_t m_seed = 0;
+	};
+
+	struct TOY_CORE_EXPORT PageWriter
+	{
+		vector<uint8_t>& m_data;
+
+		void bytes(const void* data, size_t size);
+		template <class T>
+		void value(const T& value) { this->bytes(&value, sizeof(T)); }
+	};
+
+	struct TOY_CORE_EXPORT PageReader
+	{
+		const uint8_t* m_data;
+		size_t m_size;
+		size_t m_offset = 0;
+
+		// false once a read went past the end, every read after that fails too
+		bool bytes(void* data, size_t size);
+		const uint8_t* skip(size_t size);
+		template <class T>
+		bool value(T& value) { return this->bytes(&value, sizeof(T)); }
+		// bytes left to read, to check a count before allocating for it
+		size_t remaining() const { return m_offset < m_size ? m_size - m_offset : 0; }
+	};
+
+	/* Binary cache of the content generated for the pages of a world, one file per page and section :
+		- a file is named after the page coordinate, the generator seed, the content version and the section
+		- header : magic, format version, content version, key, size and hash of the data, all checked on read
+		- bumping the content version invalidates every page, a different seed never reads the pages of another one
+		- in verify mode, the content is still generated, and compared with the cached one when it is stored
+	*/
+
+	class TOY_CORE_EXPORT PageCache
+	{
+	public:
+		PageCache(const string& path, uint32_t version = 1);
+
+		PageCache(const PageCache& other) = delete;
+		PageCache& operator=(const PageCache& other) = delete;
+
+		// files are named <path>.<x>.<z>.<seed>.v<version>.<section>
+		string m_path;
+		uint32_t m_version;
+		bool m_verify = false;
+
+		std::atomic<size_t> m_hits = { 0 };
+		std::atomic<size_t> m_misses = { 0 };
+		std::atomic<size_t> m_mismatches = { 0 };
+
+		string page_path(const PageKey& key, const char* section) const;
+
+		// false when the section is not cached, or is invalid or outdated
+		bool read(const PageKey& key, const char* section, vector<uint8_t>& data);
+		// writes the section, in verify mode a section already cached is compared first and only rewritten when it differs
+		bool store(const PageKey& key, const char* section, const vector<uint8_t>& data);
+		bool write(const PageKey& key, const char* section, const vector<uint8_t>& data);
+
+	private:
+		std::atomic<uint32_t> m_writes = { 0 };
+	};
+
+	// a geometry chunk of a page along with its collision shape, as serialized by the physics backend
+	struct PageChunk
+	{
+		uint64_t m_hash = 0;
+		Geometry m_geometry;
+		vector<uint8_t> m_cooked;
+	};
+
+	TOY_CORE_EXPORT uint64_t geometry_hash(const Geometry& geometry);
+
+	TOY_CORE_EXPORT void write_chunks(PageWriter& writer, span<PageChunk> chunks);
+	TOY_CORE_EXPORT bool read_chunks(PageReader& reader, vector<PageChunk>& chunks);
+}
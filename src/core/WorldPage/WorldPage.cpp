@@ -18,11 +18,15 @@
 #include <core/World/World.h>
 #include <core/World/Section.h>
 #include <core/Physic/PhysicWorld.h>
+#include <core/Navmesh/Navmesh.h>
 
 #include <core/Physic/Collider.h>
 #include <core/Physic/Solid.h>
 
+#include <jobs/JobSystem.h>
+
 #include <cstdio>
+#include <algorithm>
 
 namespace toy
 {
@@ -52,20 +56,200 @@ namespace toy
 		UNUSED(spatial); UNUSED(tick); UNUSED(delta);
 	}
 
+	// the chunks are matched with the cached ones by the hash of their geometry : a cached chunk skips building its bvh
+	static void cook_shapes(WorldPageCook& cook, PhysicWorld& physics)
+	{
+		if(!cook.m_cache)
+		{
+			for(CollisionShape& shape : cook.m_shapes)
+				physics.cook(shape);
+			return;
+		}
+
+		PageCache& cache = *cook.m_cache;
+
+		vector<PageChunk> cached;
+		vector<uint8_t> data;
+		if(cache.read(cook.m_key, "geometry", data))
+		{
+			PageReader reader = { data.data(), data.size() };
+			if(!read_chunks(reader, cached))
+				cached.clear();
+		}
+
+		auto find_cached = [&](uint64_t hash) -> PageChunk*
+		{
+			for(PageChunk& chunk : cached)
+				if(chunk.m_hash == hash)
+					return &chunk;
+			return nullptr;
+		};
+
+		vector<PageChunk> chunks(cook.m_chunks);
+		bool changed = cached.size() != cook.m_chunks;
+
+		for(size_t i = 0; i < cook.m_shapes.size(); ++i)
+		{
+			CollisionShape& shape = cook.m_shapes[i];
+			if(i >= cook.m_chunks)
+			{
+				physics.cook(shape);
+				continue;
+			}
+
+			PageChunk& chunk = chunks[i];
+			chunk.m_geometry = static_cast<Geometry&>(*shape.m_shape);
+			chunk.m_hash = geometry_hash(chunk.m_geometry);
+
+			PageChunk* match = find_cached(chunk.m_hash);
+			if(match && !cache.m_verify && physics.load_cooked(shape, match->m_cooked.data(), match->m_cooked.size()))
+			{
+				chunk.m_cooked = move(match->m_cooked);
+				continue;
+			}
+
+			physics.cook(shape);
+			physics.save_cooked(shape, chunk.m_cooked);
+			changed |= !match || match->m_cooked != chunk.m_cooked;
+		}
+
+		if(changed || cache.m_verify)
+		{
+			data.clear();
+			PageWriter writer = { data };
+			write_chunks(writer, chunks);
+			cache.store(cook.m_key, "geometry", data);
+		}
+	}
+
+	void cook_page_shapes(World& world, std::shared_ptr<WorldPageCook> cook, bool background)
+	{
+		// the world owns the job in flight : the page can be destroyed, or rebuilt again, at any time
+		WorldPageCook* data = cook.get();
+		PhysicWorld* physics = &as<PhysicWorld>(world.m_complex);
+		world.m_tasks.run(background ? &world.m_job_system : nullptr, cook, [data, physics]() { cook_shapes(*data, *physics); });
+	}
+
 	void WorldPage::update_geometry(size_t tick)
 	{
-		printf("[info] Updating WorldPage world geometry\n");
-		m_solids.clear();
+		// a cook still in flight is superseded : it completes, but its shapes are dropped
+		m_cook = std::make_shared<WorldPageCook>();
+
 		for(Geometry& geom : m_chunks)
 		{
 			if(geom.m_vertices.empty() || geom.m_triangles.empty())
 				continue;
-			printf("[info] WorldPage geometry chunk, %zu vertices\n", geom.m_vertices.size());
-			m_solids.push_back(Solid::create(m_spatial, HMovable(), geom, SolidMedium::me, CM_GROUND, true));
+			CollisionShape shape;
+			shape.m_shape = oconstruct<Geometry>(move(geom));
+			m_cook->m_shapes.push_back(move(shape));
+		}
+
+		m_cook->m_chunks = m_cook->m_shapes.size();
+		m_cook->m_cache = m_cache;
+		m_cook->m_key = m_cache_key;
+
+		for(const CompoundShape& compound : m_instances)
+		{
+			if(compound.m_children.empty())
+				continue;
+			m_cook->m_shapes.push_back(CollisionShape(compound));
 		}
 
 		m_chunks.clear();
 		m_last_rebuilt = tick;
+
+		cook_page_shapes(*m_world, m_cook, m_background);
+		if(!m_background)
+			this->update_solids(tick);
+	}
+
+	void WorldPage::update_section(uint64_t key, HSpatial spatial, Geometry geometry)
+	{
+		if(geometry.m_vertices.empty() || geometry.m_triangles.empty())
+		{
+			if(m_sections.erase(key) == 0)
+				return;
+		}
+		else
+			m_sections[key] = { spatial, move(geometry) };
+
+		if(std::find(m_dirty_sections.begin(), m_dirty_sections.end(), key) == m_dirty_sections.end())
+			m_dirty_sections.push_back(key);
+	}
+
+	void WorldPage::update_solids(size_t tick)
+	{
+		if(m_cook && m_cook->m_done)
+		{
+			// inserting the cooked shapes only adds them to the broadphase
+			vector<OSolid> solids;
+			for(CollisionShape& shape : m_cook->m_shapes)
+				solids.push_back(Solid::create(m_spatial, HMovable(), shape, SolidMedium::me, CM_GROUND, true));
+
+			// the previous solids leave the physics world in the same step the new ones enter it
+			m_solids = move(solids);
+			m_cook = nullptr;
+			m_last_cooked = tick;
+		}
+
+		this->update_sections(tick);
+	}
+
+	void WorldPage::update_sections(size_t tick)
+	{
+		if(m_section_cook && m_section_cook->m_done)
+		{
+			// a section changed again while it was cooked keeps its previous solid until the next cook lands
+			for(size_t i = 0; i < m_section_cook->m_shapes.size(); ++i)
+			{
+				const uint64_t key = m_section_cook->m_sections[i];
+				auto section = m_sections.find(key);
+				if(section != m_sections.end())
+					m_section_solids[key] = Solid::create(section->second.m_spatial, HMovable(), m_section_cook->m_shapes[i], SolidMedium::me, CM_GROUND, true);
+			}
+
+			m_section_cook = nullptr;
+			m_last_cooked = tick;
+			// the navblocks take in the new sections
+			m_last_rebuilt = tick;
+		}
+
+		// one section cook at a time : the sections changed meanwhile wait for the next one
+		if(m_section_cook || m_dirty_sections.empty())
+			return;
+
+		m_section_cook = std::make_shared<WorldPageCook>();
+		for(uint64_t key : m_dirty_sections)
+		{
+			auto section = m_sections.find(key);
+			if(section == m_sections.end())
+			{
+				m_section_solids.erase(key);
+				continue;
+			}
+
+			CollisionShape shape;
+			shape.m_shape = oconstruct<Geometry>(section->second.m_geometry);
+			m_section_cook->m_shapes.push_back(move(shape));
+			m_section_cook->m_sections.push_back(key);
+		}
+		m_dirty_sections.clear();
+
+		cook_page_shapes(*m_world, m_section_cook, m_background);
+		if(!m_background)
+			this->update_sections(tick);
+	}
+
+	size_t WorldPage::memory() const
+	{
+		size_t size = sizeof(WorldPage) + m_solids.size() * sizeof(Solid);
+		for(const Geometry& geom : m_chunks)
+			size += geom.m_vertices.size() * sizeof(Vertex) + geom.m_triangles.size() * sizeof(Tri);
+		for(const CompoundShape& compound : m_instances)
+			size += compound.m_shapes.size() * sizeof(CollisionShape) + compound.m_children.size() * sizeof(CompoundShape::Child);
+		for(auto& key_section : m_sections)
+			size += key_section.second.m_geometry.m_vertices.size() * sizeof(Vertex) + key_section.second.m_geometry.m_triangles.size() * sizeof(Tri) + sizeof(Solid);
+		return size;
 	}
 
 	/*
@@ -97,8 +281,7 @@ namespace toy
 			end += spatial.m_position;
 		}
 
-		Ray ray = { start, end, normalize(end - start), normalize(start - end) };
-		ground_point = as<PhysicWorld>(m_world->m_complex).ground_point(ray) - spatial.m_position;
+		ground_point = this->ground_segment(start, end) - spatial.m_position;
 
 		if(any(isnan(ground_point)) || any(isinf(ground_point)))
 			printf("[ERROR] raycast ground point failed, position result invalid\n");
@@ -106,7 +289,16 @@ namespace toy
 
 	void WorldPage::raycast_ground(const vec3& start, const vec3& end, vec3& ground_point)
 	{
+		ground_point = this->ground_segment(start, end);
+	}
+
+	vec3 WorldPage::ground_segment(const vec3& start, const vec3& end)
+	{
+		// vertical queries are answered by the navmesh detail mesh, physics is only raycast off-mesh
+		if(Navmesh* navmesh = try_as<Navmesh>(m_world->m_complex))
+			return navmesh->ground_point(start, end);
+
 		Ray ray = { start, end, normalize(end - start), normalize(start - end) };
-		ground_point = as<PhysicWorld>(m_world->m_complex).ground_point(ray);
+		return as<PhysicWorld>(m_world->m_complex).ground_point(ray);
 	}
 }
@@ -6,10 +6,17 @@
 #pragma once
 
 #include <stl/memory.h>
+#include <stl/map.h>
 #include <math/Vec.h>
 #include <core/Forward.h>
 #include <core/Physic/Medium.h>
 #include <core/Physic/Collider.h>
+#include <core/Physic/CollisionShape.h>
+#include <core/WorldPage/PageCache.h>
+#include <core/World/JobTasks.h>
+
+#include <atomic>
+#include <memory>
 
 namespace toy
 {
@@ -20,6 +27,29 @@ namespace toy
 		attr_ static WorldMedium me;
 	};
 
+	// collision shapes of a page, cooked by a background job
+	struct WorldPageCook : public JobTask
+	{
+		vector<CollisionShape> m_shapes;
+		// the first shapes are the geometry chunks, the instance compounds follow
+		size_t m_chunks = 0;
+		PageCache* m_cache = nullptr;
+		PageKey m_key;
+		// keys of the sections the shapes were cooked from, for a section cook
+		vector<uint64_t> m_sections;
+	};
+
+	// static geometry a content of the page supplies piece by piece, like the sections of a voxel block
+	struct PageSection
+	{
+		// the geometry is relative to it, and its solid attached to it
+		HSpatial m_spatial;
+		Geometry m_geometry;
+	};
+
+	// cooks the shapes on a job of the world, or right away
+	TOY_CORE_EXPORT void cook_page_shapes(World& world, std::shared_ptr<WorldPageCook> cook, bool background);
+
 	/* A WorldPage has : 
 		- contents (entities)
 		- static geometry (static entities)
@@ -43,6 +73,9 @@ namespace toy
 		attr_ vec3 m_extents = vec3(0.f);
 		attr_ World* m_world = nullptr;
 		attr_ size_t m_last_rebuilt = 0;
+		attr_ size_t m_last_cooked = 0;
+		// cook the collision shapes on a job, otherwise the solids are created right away
+		attr_ bool m_background = true;
 
 		size_t m_updated = 0;
 		//std::atomic<size_t> m_updated = 0;
@@ -54,11 +87,39 @@ namespace toy
 		vector<Geometry> m_chunks;
 		vector<OSolid> m_solids;
 
+		// cooking in flight, its solids replace m_solids at the next frame boundary
+		std::shared_ptr<WorldPageCook> m_cook;
+
+		// the geometry chunks of the page are only cooked again when they differ from the cached ones
+		PageCache* m_cache = nullptr;
+		PageKey m_cache_key;
+
+		// instanced static geometry : kept after the solids are built, it is also the navmesh input of the page
+		vector<CompoundShape> m_instances;
+
+		// sections are kept too : each one has its own solid, and only the changed ones are cooked again
+		map<uint64_t, PageSection> m_sections;
+		map<uint64_t, OSolid> m_section_solids;
+		vector<uint64_t> m_dirty_sections;
+		std::shared_ptr<WorldPageCook> m_section_cook;
+
 		void next_frame(const Spatial& spatial, size_t tick, size_t delta);
 
 		meth_ void update_geometry(size_t tick);
+		// swaps in the solids of a finished cooking job, and starts cooking the changed sections : must be called between frames, on the main thread
+		void update_solids(size_t tick);
+		bool cooking() const { return m_cook != nullptr || m_section_cook != nullptr; }
+
+		// an empty geometry removes the section
+		void update_section(uint64_t key, HSpatial spatial, Geometry geometry);
+		void update_sections(size_t tick);
 
 		meth_ void ground_point(const vec3& position, bool relative, vec3& outputPoint);
 		meth_ void raycast_ground(const vec3& from, const vec3& to, vec3& ground_point);
+
+		vec3 ground_segment(const vec3& from, const vec3& to);
+
+		// approximate memory held by the page geometry and solids, in bytes
+		size_t memory() const;
     };
 }
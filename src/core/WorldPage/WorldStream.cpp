@@ -0,0 +1,190 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#include <stl/algorithm.h>
+#include <core/Types.h>
+#include <core/WorldPage/WorldStream.h>
+#include <core/WorldPage/WorldPage.h>
+#include <core/Spatial/Spatial.h>
+#include <core/Navmesh/Navmesh.h>
+
+#include <cstdio>
+#include <algorithm>
+
+namespace toy
+{
+	WorldStream::WorldStream(const vec3& page_size)
+		: m_page_size(page_size)
+	{}
+
+	WorldStream::~WorldStream()
+	{
+		this->clear();
+	}
+
+	WorldStream::Page* WorldStream::find(const ivec2& coord)
+	{
+		auto it = m_pages.find(key(coord));
+		return it != m_pages.end() ? &it->second : nullptr;
+	}
+
+	ivec2 WorldStream::page_coord(const vec3& position) const
+	{
+		return ivec2(int(floor(position.x / m_page_size.x)), int(floor(position.z / m_page_size.z)));
+	}
+
+	vec3 WorldStream::page_center(const ivec2& coord) const
+	{
+		return vec3((float(coord.x) + 0.5f) * m_page_size.x, 0.f, (float(coord.y) + 0.5f) * m_page_size.z);
+	}
+
+	float WorldStream::priority(const ivec2& coord, float margin) const
+	{
+		const vec3 center = this->page_center(coord);
+		const vec2 half = vec2(m_page_size.x, m_page_size.z) / 2.f;
+
+		float priority = -1.f;
+		for(const StreamAnchor& anchor : m_anchors)
+		{
+			// distance from the anchor to the page rectangle, on the ground plane
+			const vec2 offset = abs(vec2(anchor.m_position.x - center.x, anchor.m_position.z - center.z)) - half;
+			const float distance = length(max(offset, vec2(0.f)));
+			const float radius = anchor.m_radius * margin;
+			if(distance > radius)
+				continue;
+
+			const float falloff = radius > 0.f ? 1.f - distance / radius : 1.f;
+			priority = max(priority, anchor.m_priority * falloff);
+		}
+		return priority;
+	}
+
+	void WorldStream::update()
+	{
+		++m_update;
+
+		for(auto& key_page : m_pages)
+		{
+			Page& page = key_page.second;
+			page.m_priority = this->priority(page.m_coord, m_hysteresis);
+			page.m_wanted = page.m_priority >= 0.f;
+			if(page.m_wanted)
+				page.m_used = m_update;
+		}
+
+		// missing pages in range of an anchor, the nearest to the highest priority anchors first
+		m_wanted.clear();
+		for(const StreamAnchor& anchor : m_anchors)
+		{
+			const ivec2 lo = this->page_coord(anchor.m_position - vec3(anchor.m_radius));
+			const ivec2 hi = this->page_coord(anchor.m_position + vec3(anchor.m_radius));
+			for(int x = lo.x; x <= hi.x; ++x)
+				for(int y = lo.y; y <= hi.y; ++y)
+				{
+					const ivec2 coord = ivec2(x, y);
+					if(this->find(coord))
+						continue;
+					const float priority = this->priority(coord, 1.f);
+					if(priority >= 0.f)
+						m_wanted.push_back({ coord, priority });
+				}
+		}
+
+		auto by_key = [](const Wanted& a, const Wanted& b) { return key(a.m_coord) < key(b.m_coord); };
+		auto same_key = [](const Wanted& a, const Wanted& b) { return a.m_coord == b.m_coord; };
+		std::sort(m_wanted.begin(), m_wanted.end(), by_key);
+		m_wanted.erase(std::unique(m_wanted.begin(), m_wanted.end(), same_key), m_wanted.end());
+		std::stable_sort(m_wanted.begin(), m_wanted.end(), [](const Wanted& a, const Wanted& b) { return a.m_priority > b.m_priority; });
+
+		size_t loads = 0;
+		for(const Wanted& wanted : m_wanted)
+		{
+			if(loads >= m_max_loads)
+				break;
+			if(this->load(wanted.m_coord))
+				++loads;
+		}
+
+		m_memory = 0;
+		for(auto& key_page : m_pages)
+		{
+			Page& page = key_page.second;
+			page.m_memory = m_measure ? m_measure(page) : page.m_page->memory();
+			m_memory += page.m_memory;
+		}
+
+		// evict the least recently wanted pages until the budget is met, wanted and pinned pages are never evicted
+		while(m_memory > m_budget)
+		{
+			auto lru = m_pages.end();
+			for(auto it = m_pages.begin(); it != m_pages.end(); ++it)
+				if(!it->second.m_wanted && !it->second.m_pinned && (lru == m_pages.end() || it->second.m_used < lru->second.m_used))
+					lru = it;
+
+			if(lru == m_pages.end())
+				break;
+
+			m_memory -= lru->second.m_memory;
+			this->evict(lru);
+		}
+	}
+
+	bool WorldStream::load(const ivec2& coord)
+	{
+		if(this->find(coord))
+			return true;
+
+		for(PageSource& source : m_sources)
+		{
+			Entity entity = source.m_load(coord);
+			if(!entity)
+				continue;
+
+			Page& page = m_pages[key(coord)];
+			page.m_coord = coord;
+			page.m_page = HWorldPage(entity);
+			page.m_used = m_update;
+			page.m_wanted = true;
+
+			m_failed.erase(key(coord));
+			if(m_on_load)
+				m_on_load(page);
+			return true;
+		}
+
+		if(m_failed.insert(key(coord)).second)
+			printf("[warning] WorldStream no source could load page %i, %i\n", coord.x, coord.y);
+		return false;
+	}
+
+	void WorldStream::unload(const ivec2& coord)
+	{
+		auto it = m_pages.find(key(coord));
+		if(it != m_pages.end())
+			this->evict(it);
+	}
+
+	void WorldStream::clear()
+	{
+		while(!m_pages.empty())
+			this->evict(m_pages.begin());
+		m_memory = 0;
+	}
+
+	void WorldStream::evict(map<uint64_t, Page>::iterator it)
+	{
+		Page& page = it->second;
+		if(m_on_unload)
+			m_on_unload(page);
+
+		if(Navblock* navblock = try_asa<Navblock>(page.m_page))
+			if(navblock->m_navmesh)
+				navblock->m_navmesh->remove_block(*navblock);
+
+		// the entities attached to the page are destroyed with it, and its solids released from the physics world
+		destroy_spatial(page.m_page->m_spatial);
+		m_pages.erase(it);
+	}
+}
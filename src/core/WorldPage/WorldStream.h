@@ -0,0 +1,101 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#pragma once
+
+#include <stl/vector.h>
+#include <stl/map.h>
+#include <stl/string.h>
+#include <stl/function.h>
+#include <math/Vec.h>
+#include <ecs/ECS.h>
+#include <core/Forward.h>
+
+#include <set>
+
+namespace toy
+{
+	// a point around which pages are kept loaded : the player, a camera, a scripted event
+	struct StreamAnchor
+	{
+		vec3 m_position = vec3(0.f);
+		float m_radius = 100.f;
+		float m_priority = 1.f;
+	};
+
+	// creates the page entity at a coordinate : a loader reading pages back from storage returns no entity when it doesn't have the page, so that the next source is tried
+	struct PageSource
+	{
+		string m_name;
+		function<Entity(const ivec2& coord)> m_load;
+	};
+
+	/* Streams the pages of a world, on a grid of page coordinates along x and z, page (x, z) spanning [x, x + 1) * page size :
+		- each update computes the pages wanted by the anchors, and loads the missing ones by priority, a few per update
+		- pages no longer wanted stay resident while the memory budget allows, the least recently wanted are evicted first
+		- a page is created by the first source that returns an entity, evicting it removes its navmesh geometry and destroys the entity
+	*/
+
+	class TOY_CORE_EXPORT WorldStream
+	{
+	public:
+		WorldStream(const vec3& page_size);
+		~WorldStream();
+
+		struct Page
+		{
+			ivec2 m_coord;
+			HWorldPage m_page;
+			size_t m_used = 0;
+			size_t m_memory = 0;
+			float m_priority = 0.f;
+			bool m_wanted = false;
+			// never evicted, even when out of range
+			bool m_pinned = false;
+		};
+
+		vec3 m_page_size;
+		vector<StreamAnchor> m_anchors;
+		vector<PageSource> m_sources;
+
+		// called after a page is loaded, and before it is evicted
+		function<void(Page&)> m_on_load;
+		function<void(Page&)> m_on_unload;
+		// memory of a page, WorldPage::memory() when not set
+		function<size_t(Page&)> m_measure;
+
+		size_t m_budget = 256U << 20;
+		size_t m_max_loads = 2U;
+		// a page is only unwanted once it is that much further than the radius of every anchor
+		float m_hysteresis = 1.25f;
+
+		size_t m_memory = 0;
+		size_t m_update = 0;
+
+		void update();
+
+		Page* find(const ivec2& coord);
+		bool resident(const ivec2& coord) { return this->find(coord) != nullptr; }
+
+		ivec2 page_coord(const vec3& position) const;
+		vec3 page_center(const ivec2& coord) const;
+
+		bool load(const ivec2& coord);
+		void unload(const ivec2& coord);
+		void clear();
+
+	private:
+		static uint64_t key(const ivec2& coord) { return (uint64_t(uint32_t(coord.x)) << 32) | uint32_t(coord.y); }
+		float priority(const ivec2& coord, float margin) const;
+		void evict(map<uint64_t, Page>::iterator it);
+
+		map<uint64_t, Page> m_pages;
+		// pages no source could load : they are tried again on each update, but only reported once
+		std::set<uint64_t> m_failed;
+
+		struct Wanted { ivec2 m_coord; float m_priority; };
+		vector<Wanted> m_wanted;
+	};
+}
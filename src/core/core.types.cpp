@@ -29,12 +29,14 @@ namespace two
     template <> TOY_CORE_EXPORT Type& type<two::ComponentHandle<toy::Navblock>>() { static Type ty("ComponentHandle<toy::Navblock>", sizeof(two::ComponentHandle<toy::Navblock>)); return ty; }
     template <> TOY_CORE_EXPORT Type& type<two::ComponentHandle<toy::Origin>>() { static Type ty("ComponentHandle<toy::Origin>", sizeof(two::ComponentHandle<toy::Origin>)); return ty; }
     template <> TOY_CORE_EXPORT Type& type<two::ComponentHandle<toy::Waypoint>>() { static Type ty("ComponentHandle<toy::Waypoint>", sizeof(two::ComponentHandle<toy::Waypoint>)); return ty; }
+    template <> TOY_CORE_EXPORT Type& type<two::ComponentHandle<toy::CrowdAgent>>() { static Type ty("ComponentHandle<toy::CrowdAgent>", sizeof(two::ComponentHandle<toy::CrowdAgent>)); return ty; }
     template <> TOY_CORE_EXPORT Type& type<toy::Spatial>() { static Type ty("Spatial", type<two::Transform>(), sizeof(toy::Spatial)); return ty; }
     template <> TOY_CORE_EXPORT Type& type<toy::Origin>() { static Type ty("Origin", sizeof(toy::Origin)); return ty; }
     template <> TOY_CORE_EXPORT Type& type<toy::WorldClock>() { static Type ty("WorldClock", sizeof(toy::WorldClock)); return ty; }
     template <> TOY_CORE_EXPORT Type& type<toy::World>() { static Type ty("World", sizeof(toy::World)); return ty; }
     template <> TOY_CORE_EXPORT Type& type<toy::Medium>() { static Type ty("Medium", sizeof(toy::Medium)); return ty; }
     template <> TOY_CORE_EXPORT Type& type<toy::CollisionShape>() { static Type ty("CollisionShape", sizeof(toy::CollisionShape)); return ty; }
+    template <> TOY_CORE_EXPORT Type& type<toy::CompoundShape>() { static Type ty("CompoundShape", type<two::Shape>(), sizeof(toy::CompoundShape)); return ty; }
     template <> TOY_CORE_EXPORT Type& type<toy::Movable>() { static Type ty("Movable", sizeof(toy::Movable)); return ty; }
     template <> TOY_CORE_EXPORT Type& type<toy::Collision>() { static Type ty("Collision", sizeof(toy::Collision)); return ty; }
     template <> TOY_CORE_EXPORT Type& type<toy::ColliderImpl>() { static Type ty("ColliderImpl", sizeof(toy::ColliderImpl)); return ty; }
@@ -67,6 +69,7 @@ namespace two
     template <> TOY_CORE_EXPORT Type& type<toy::Waypoint>() { static Type ty("Waypoint", sizeof(toy::Waypoint)); return ty; }
     template <> TOY_CORE_EXPORT Type& type<toy::DetourPath>() { static Type ty("DetourPath", sizeof(toy::DetourPath)); return ty; }
     template <> TOY_CORE_EXPORT Type& type<toy::Pathfinder>() { static Type ty("Pathfinder", sizeof(toy::Pathfinder)); return ty; }
+    template <> TOY_CORE_EXPORT Type& type<toy::CrowdAgent>() { static Type ty("CrowdAgent", sizeof(toy::CrowdAgent)); return ty; }
     template <> TOY_CORE_EXPORT Type& type<toy::Obstacle>() { static Type ty("Obstacle", type<toy::Collider>(), sizeof(toy::Obstacle)); return ty; }
     template <> TOY_CORE_EXPORT Type& type<toy::SolidMedium>() { static Type ty("SolidMedium", type<toy::Medium>(), sizeof(toy::SolidMedium)); return ty; }
     template <> TOY_CORE_EXPORT Type& type<toy::ComponentPool>() { static Type ty("ComponentPool", sizeof(toy::ComponentPool)); return ty; }
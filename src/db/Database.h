@@ -1,10 +1,9 @@
 //  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
 //  This software is provided 'as-is' under the zlib License, see the LICENSE.txt file.
 //  This notice and the license may not be removed or altered from any source distribution.
-#ifndef MUD_DATABASE_H
-#define MUD_DATABASE_H
 
-#include <db/SqliteDatabase.h>
-#include <db/SqliteLoader.h>
+#pragma once
 
-#endif // MUD_DATABASE_H
+#include <db/Forward.h>
+#include <db/SqliteDatabase.h>
+#include <db/SqliteWorld.h>
@@ -0,0 +1,27 @@
+
+
+#pragma once
+
+#include <infra/Config.h>
+
+#include <type/Forward.h>
+#include <math/Forward.h>
+#include <jobs/Forward.h>
+#include <ecs/Forward.h>
+#include <core/Forward.h>
+
+#ifndef TOY_DB_EXPORT
+#define TOY_DB_EXPORT TWO_IMPORT
+#endif
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace toy
+{
+    class SqliteDatabase;
+    class SqliteWorld;
+    struct SqliteValue;
+    struct SqliteRoot;
+    struct SqliteWrite;
+}
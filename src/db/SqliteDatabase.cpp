@@ -2,145 +2,96 @@
 //  This software is provided 'as-is' under the zlib License, see the LICENSE.txt file.
 //  This notice and the license may not be removed or altered from any source distribution.
 
-#include <db/Generated/Types.h>
 #include <db/SqliteDatabase.h>
 
-#include <obj/Indexer.h>
-#include <db/SqliteLoader.h>
+#include <stdio.h>
 
-#include <refl/System.h>
+#include <sqlite3.h>
 
-#include <algorithm>
-
-/* sqlite */
-#include "sqlite3.h"
-
-using namespace two; namespace toy
+namespace toy
 {
-	SqliteDatabase::SqliteDatabase(cstring path)
+	SqliteDatabase::SqliteDatabase(const string& path)
 		: m_path(path)
-		, m_models(MUD_MAX_TYPES)
 	{}
 
 	SqliteDatabase::~SqliteDatabase()
 	{
-		close();
+		this->close();
 	}
 
-	unique_ptr<DataLoader> SqliteDatabase::makeLoader()
+	bool SqliteDatabase::open(bool wal)
 	{
-		return make_unique<SqliteLoader>(*this);
-	}
+		if(m_database)
+			return true;
 
-	bool SqliteDatabase::init()
-	{
-		bool result = !sqlite3_open(m_path.c_str(), &m_database);
-		sqlite3_exec(m_database, "PRAGMA recursive_triggers = true", 0, 0, 0);
-		this->syncTypes();
-		return result;
+		if(!this->check(sqlite3_open(m_path.c_str(), &m_database), "open"))
+		{
+			this->close();
+			return false;
+		}
+
+		// a reader waits for a writer finishing a checkpoint rather than failing
+		sqlite3_busy_timeout(m_database, 1000);
+
+		// synchronous NORMAL is safe in WAL mode : a commit can only be lost to a power failure, never corrupt the database
+		if(wal)
+			return this->exec("PRAGMA journal_mode = WAL") && this->exec("PRAGMA synchronous = NORMAL");
+		return true;
 	}
 
 	void SqliteDatabase::close()
 	{
-		sqlite3_close(m_database);
+		if(m_database)
+			sqlite3_close(m_database);
+		m_database = nullptr;
 	}
 
-	SqliteModel& SqliteDatabase::getModel(Type& type)
+	bool SqliteDatabase::exec(const string& statement)
 	{
-		if(m_models[type.m_id] == nullptr)
-			m_models[type.m_id] = make_unique<SqliteModel>(type, *this);
-
-		return *m_models[type.m_id];
+		char* error = nullptr;
+		const int result = sqlite3_exec(m_database, statement.c_str(), nullptr, nullptr, &error);
+		if(result != SQLITE_OK)
+			printf("[warning] SqliteDatabase %s : %s failed : %s\n", m_path.c_str(), statement.c_str(), error ? error : sqlite3_errstr(result));
+		sqlite3_free(error);
+		return result == SQLITE_OK;
 	}
 
-	void SqliteDatabase::syncTypes()
+	sqlite3_stmt* SqliteDatabase::prepare(const string& statement)
 	{
-		string statement = "SELECT 1 FROM sqlite_master WHERE type='table' AND name='M_Types'";
-
-		int result = 0;
-		sqlite3_exec(m_database, statement.c_str(), [](void* result, int cols, char**, char**) -> int { *(int*)result = cols; return 0; }, &result, 0);
-
-		if(result == 0)
-			this->saveTypes();
-
-		this->loadTypes();
+		sqlite3_stmt* prepared = nullptr;
+		if(!this->check(sqlite3_prepare_v2(m_database, statement.c_str(), -1, &prepared, nullptr), statement.c_str()))
+			return nullptr;
+		return prepared;
 	}
 
-	void SqliteDatabase::loadTypes()
+	bool SqliteDatabase::step(sqlite3_stmt* statement)
 	{
-		string statement = "SELECT id, name FROM M_Types";
-		sqlite3_stmt* load = nullptr;
-		sqlite3_prepare_v2(m_database, statement.c_str(), -1, &load, 0);
-
-		while(checkError(sqlite3_step(load)) == SQLITE_ROW)
-		{
-			size_t index = sqlite3_column_int(load, 0);
-			const char* name = reinterpret_cast<const char*>(sqlite3_column_text(load, 1));
-
-			Type* type = system().find_type(name);
-
-#if 0
-			printf("INFO: Loading type %s data from database\n", name);
-#endif
-
-			if(type == nullptr)
-			{
-				printf("WARNING: Type %s registered in database not found in runtime\n", name);
-				continue;
-			}
-
-			m_typeToIndex.resize(max(m_typeToIndex.size(), size_t(type->m_id + 1)));
-			m_indexToType.resize(max(m_indexToType.size(), index + 1));
-
-			m_typeToIndex[type->m_id] = index;
-			m_indexToType[index] = type;
-		}
+		const bool success = this->check(sqlite3_step(statement), sqlite3_sql(statement));
+		sqlite3_reset(statement);
+		sqlite3_clear_bindings(statement);
+		return success;
 	}
 
-	void SqliteDatabase::saveTypes()
+	bool SqliteDatabase::begin()
 	{
-		string statement = "CREATE TABLE M_Types (id INTEGER PRIMARY KEY AUTOINCREMENT, name TEXT)";
-		checkError(sqlite3_exec(m_database, statement.c_str(), 0, 0, 0));
-
-		statement = "INSERT INTO M_Types(id, name) VALUES ((?), (?))";
-		sqlite3_stmt* save = nullptr;
-		sqlite3_prepare_v2(m_database, statement.c_str(), -1, &save, 0);
-
-		sqlite3_exec(m_database, "BEGIN;", 0, 0, 0);
-
-		for(Type* type : System::instance().m_types)
-		{
-			sqlite3_bind_null(save, 1);
-			sqlite3_bind_text(save, 2, type->m_name, strlen(type->m_name), SQLITE_TRANSIENT);
-			checkError(sqlite3_step(save));
-			sqlite3_reset(save);
-		}
-
-		sqlite3_exec(m_database, "COMMIT;", 0, 0, 0);
+		return this->exec("BEGIN");
 	}
 
-	void SqliteDatabase::beginBatch(Loader& loader)
+	bool SqliteDatabase::commit()
 	{
-		if(m_batching)
-			return;
-
-		sqlite3_exec(m_database, "BEGIN;", 0, 0, 0);
-		m_batching = &loader;
+		return this->exec("COMMIT");
 	}
 
-	void SqliteDatabase::commitBatch(Loader& loader)
+	void SqliteDatabase::rollback()
 	{
-		if(m_batching != &loader)
-			return;
-
-		sqlite3_exec(m_database, "COMMIT;", 0, 0, 0);
-		m_batching = nullptr;
+		this->exec("ROLLBACK");
 	}
 
-	int SqliteDatabase::checkError(int result)
+	bool SqliteDatabase::check(int result, const char* context)
 	{
-		if(result != SQLITE_OK && result != SQLITE_DONE && result != SQLITE_ROW)
-			printf("ERROR: SqliteDatabase statement execution failed\n");
-		return result;
+		if(result == SQLITE_OK || result == SQLITE_DONE || result == SQLITE_ROW)
+			return true;
+		printf("[warning] SqliteDatabase %s : %s failed : %s\n", m_path.c_str(), context, m_database ? sqlite3_errmsg(m_database) : sqlite3_errstr(result));
+		return false;
 	}
 }
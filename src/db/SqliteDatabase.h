@@ -4,59 +4,45 @@
 
 #pragma once
 
-/* toy */
-#include <infra/NonCopy.h>
-#include <obj/Unique.h>
-#include <db/Generated/Forward.h>
-#include <util/Loader/DataLoader.h>
+#include <stl/string.h>
+#include <db/Forward.h>
 
-/* std */
-#include <stl/vector>
-#include <stl/string>
-
-struct sqlite3;
-
-using namespace two; namespace toy
+namespace toy
 {
-	using string = string;
-
-    class refl_ TOY_DB_EXPORT SqliteDatabase : public NonCopy, public DataSource
-    {
-    public:
-        SqliteDatabase(cstring path);
-        ~SqliteDatabase();
+	/* Connection to a sqlite database :
+		- a connection is used by one thread at a time, a database read while it's written needs a connection per thread
+		- the writing connection sets the database in WAL mode, so that the readers are never blocked by a write
+		- failed statements are reported with the message of sqlite, and return false
+	*/
 
-		virtual unique_ptr<DataLoader> makeLoader();
-
-		bool init();
-		void close();
+	class TOY_DB_EXPORT SqliteDatabase
+	{
+	public:
+		SqliteDatabase(const string& path);
+		~SqliteDatabase();
 
-		void syncTypes();
-		void loadTypes();
-		void saveTypes();
+		SqliteDatabase(const SqliteDatabase& other) = delete;
+		SqliteDatabase& operator=(const SqliteDatabase& other) = delete;
 
-		SqliteModel& getModel(Type& type);
+		string m_path;
 
-		virtual void beginBatch(Loader& loader);
-		virtual void commitBatch(Loader& loader);
+		bool open(bool wal);
+		void close();
 
-		virtual Type* indexToType(Id index) { return m_indexToType[index]; }
-		virtual Id typetoIndex(Type& type) { return m_typeToIndex[type.m_id]; }
+		bool exec(const string& statement);
+		sqlite3_stmt* prepare(const string& statement);
+		// steps a statement that returns no rows, and resets it for the next bindings
+		bool step(sqlite3_stmt* statement);
 
-		int checkError(int result);
+		bool begin();
+		bool commit();
+		void rollback();
 
-		//void synchronize();
+		bool check(int result, const char* context);
 
 		sqlite3* database() { return m_database; }
 
-    private:
-		string m_path;
-        sqlite3* m_database = nullptr;
-		Loader* m_batching = nullptr;
-
-		vector<unique_ptr<SqliteModel>> m_models;
-
-		vector<Type*> m_indexToType;
-		vector<Id> m_typeToIndex;
-    };
+	private:
+		sqlite3* m_database = nullptr;
+	};
 }
@@ -0,0 +1,611 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is provided 'as-is' under the zlib License, see the LICENSE.txt file.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#include <stl/algorithm.h>
+#include <refl/Api.h>
+#include <jobs/JobSystem.h>
+#include <core/Types.h>
+#include <core/World/World.h>
+#include <core/World/JobTasks.h>
+#include <core/Spatial/Spatial.h>
+#include <core/WorldPage/WorldPage.h>
+#include <db/SqliteWorld.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include <sqlite3.h>
+
+namespace toy
+{
+	using FieldKind = WorldSnapshot::FieldKind;
+
+	// id, root, seq, page_x, page_z
+	static const size_t ENTITY_COLUMNS = 5;
+
+	struct SqliteWrite : public JobTask
+	{
+		vector<SqliteRoot> m_roots;
+		size_t m_rows = 0;
+		bool m_success = false;
+	};
+
+	static uint64_t entity_key(Entity entity)
+	{
+		return (uint64_t(entity.m_stream) << 32) | uint64_t(entity.m_handle);
+	}
+
+	static void gather_entities(HSpatial spatial, vector<Entity>& entities)
+	{
+		for(HSpatial child : spatial->m_contents)
+		{
+			entities.push_back(child);
+			gather_entities(child, entities);
+		}
+	}
+
+	static string quoted(const string& name)
+	{
+		return "\"" + name + "\"";
+	}
+
+	// integers are stored with their bytes as is, so that any base type or enum up to 64 bits reads back the same
+	static const char* column_type(const WorldSnapshot::Field& field)
+	{
+		if(field.m_kind == FieldKind::Handle)
+			return "INTEGER";
+		if(field.m_kind == FieldKind::String)
+			return "TEXT";
+		if(field.m_type->is<float>() || field.m_type->is<double>())
+			return "REAL";
+		if((is_base_type(*field.m_type) || is_enum(*field.m_type)) && field.m_size <= sizeof(int64_t))
+			return "INTEGER";
+		return "BLOB";
+	}
+
+	static void bind(sqlite3_stmt* statement, int index, const SqliteValue& value)
+	{
+		if(value.m_kind == SqliteValue::Integer)
+			sqlite3_bind_int64(statement, index, value.m_integer);
+		else if(value.m_kind == SqliteValue::Real)
+			sqlite3_bind_double(statement, index, value.m_real);
+		else if(value.m_kind == SqliteValue::Text)
+			sqlite3_bind_text(statement, index, value.m_bytes.data(), int(value.m_bytes.size()), SQLITE_STATIC);
+		else if(value.m_kind == SqliteValue::Blob)
+			sqlite3_bind_blob(statement, index, value.m_bytes.data(), int(value.m_bytes.size()), SQLITE_STATIC);
+		else
+			sqlite3_bind_null(statement, index);
+	}
+
+	static SqliteValue column(sqlite3_stmt* statement, int index)
+	{
+		SqliteValue value;
+		const int type = sqlite3_column_type(statement, index);
+		if(type == SQLITE_INTEGER)
+		{
+			value.m_kind = SqliteValue::Integer;
+			value.m_integer = sqlite3_column_int64(statement, index);
+		}
+		else if(type == SQLITE_FLOAT)
+		{
+			value.m_kind = SqliteValue::Real;
+			value.m_real = sqlite3_column_double(statement, index);
+		}
+		else if(type == SQLITE_TEXT || type == SQLITE_BLOB)
+		{
+			value.m_kind = type == SQLITE_TEXT ? SqliteValue::Text : SqliteValue::Blob;
+			const char* bytes = static_cast<const char*>(sqlite3_column_blob(statement, index));
+			value.m_bytes.assign(bytes ? bytes : "", size_t(sqlite3_column_bytes(statement, index)));
+		}
+		return value;
+	}
+
+	static bool insert_rows(SqliteDatabase& database, sqlite3_stmt* statement, const vector<SqliteValue>& values, size_t columns)
+	{
+		for(size_t row = 0; row + columns <= values.size(); row += columns)
+		{
+			for(size_t c = 0; c < columns; ++c)
+				bind(statement, int(c + 1), values[row + c]);
+			if(!database.step(statement))
+				return false;
+		}
+		return true;
+	}
+
+	static bool pending(const vector<SqliteRoot>& roots, const ivec2& coord)
+	{
+		for(const SqliteRoot& root : roots)
+			if(root.m_page == coord)
+				return true;
+		return false;
+	}
+
+	SqliteWorld::SqliteWorld(WorldSnapshot& snapshot, const string& path, const vec3& page_size)
+		: m_snapshot(snapshot)
+		, m_page_size(page_size)
+		, m_writer(path)
+		, m_reader(path)
+	{}
+
+	SqliteWorld::~SqliteWorld()
+	{
+		this->close();
+	}
+
+	bool SqliteWorld::open(World& world)
+	{
+		m_world = &world;
+
+		if(!m_writer.open(true) || !m_reader.open(false))
+			return false;
+
+		bool success = m_writer.exec("CREATE TABLE IF NOT EXISTS entities (id INTEGER PRIMARY KEY, root INTEGER, seq INTEGER, page_x INTEGER, page_z INTEGER)")
+					&& m_writer.exec("CREATE INDEX IF NOT EXISTS entities_page ON entities (page_x, page_z)")
+					&& m_writer.exec("CREATE INDEX IF NOT EXISTS entities_root ON entities (root)");
+
+		m_tables.clear();
+		for(const WorldSnapshot::Component& component : m_snapshot.m_components)
+		{
+			Table table = { component, "C_" + string(meta(*component.m_type).m_name), {} };
+			m_snapshot.fields(*component.m_type, table.m_fields);
+			success &= this->create_table(table);
+			m_tables.push_back(table);
+		}
+
+		m_insert = m_writer.prepare("INSERT OR REPLACE INTO entities (id, root, seq, page_x, page_z) VALUES (?1, ?2, ?3, ?4, ?5)");
+		m_erase = m_writer.prepare("DELETE FROM entities WHERE root = ?1");
+
+		// new entities are numbered after the ones already stored
+		if(sqlite3_stmt* last = m_writer.prepare("SELECT MAX(id) FROM entities"))
+		{
+			if(sqlite3_step(last) == SQLITE_ROW)
+				m_next_id = max(m_next_id, int64_t(sqlite3_column_int64(last, 0)) + 1);
+			sqlite3_finalize(last);
+		}
+
+		return success && m_insert && m_erase;
+	}
+
+	bool SqliteWorld::create_table(Table& table)
+	{
+		const string name = quoted(table.m_name);
+		if(!m_writer.exec("CREATE TABLE IF NOT EXISTS " + name + " (entity INTEGER PRIMARY KEY)"))
+			return false;
+
+		vector<string> columns;
+		if(sqlite3_stmt* info = m_writer.prepare("PRAGMA table_info(" + name + ")"))
+		{
+			while(sqlite3_step(info) == SQLITE_ROW)
+				columns.push_back(reinterpret_cast<const char*>(sqlite3_column_text(info, 1)));
+			sqlite3_finalize(info);
+		}
+
+		// fields added to the component since the table was created get a column, null for the rows already stored
+		string fields = "entity";
+		string values = "?1";
+		for(size_t i = 0; i < table.m_fields.size(); ++i)
+		{
+			const WorldSnapshot::Field& field = table.m_fields[i];
+			if(std::find(columns.begin(), columns.end(), field.m_name) == columns.end())
+				if(!m_writer.exec("ALTER TABLE " + name + " ADD COLUMN " + quoted(field.m_name) + " " + column_type(field)))
+					return false;
+
+			fields += ", " + quoted(field.m_name);
+			values += ", ?" + to_string(i + 2);
+		}
+
+		table.m_insert = m_writer.prepare("INSERT OR REPLACE INTO " + name + " (" + fields + ") VALUES (" + values + ")");
+		table.m_erase = m_writer.prepare("DELETE FROM " + name + " WHERE entity IN (SELECT id FROM entities WHERE root = ?1)");
+		return table.m_insert && table.m_erase;
+	}
+
+	void SqliteWorld::close()
+	{
+		if(m_world)
+			this->flush();
+
+		for(Table& table : m_tables)
+		{
+			sqlite3_finalize(table.m_insert);
+			sqlite3_finalize(table.m_erase);
+		}
+		m_tables.clear();
+
+		sqlite3_finalize(m_insert);
+		sqlite3_finalize(m_erase);
+		m_insert = nullptr;
+		m_erase = nullptr;
+
+		m_writer.close();
+		m_reader.close();
+		m_world = nullptr;
+	}
+
+	ivec2 SqliteWorld::page_coord(const vec3& position) const
+	{
+		return ivec2(int(floor(position.x / m_page_size.x)), int(floor(position.z / m_page_size.z)));
+	}
+
+	int64_t SqliteWorld::id(World& world, Entity entity)
+	{
+		const uint64_t key = entity_key(entity);
+		if(key == entity_key(world.origin()))
+			return 0;
+		if(key == entity_key(world.unworld()))
+			return 1;
+
+		auto it = m_ids.find(key);
+		if(it != m_ids.end())
+			return it->second;
+
+		const int64_t id = m_next_id++;
+		m_ids[key] = id;
+		m_entities[id] = entity;
+		return id;
+	}
+
+	void SqliteWorld::value(World& world, const WorldSnapshot::Field& field, const uint8_t* value, SqliteValue& result)
+	{
+		if(field.m_kind == FieldKind::Handle)
+		{
+			// the entity a handle points to is numbered now, and stored when its root is saved
+			Entity target = field.m_handle->m_get(value);
+			if(target)
+			{
+				result.m_kind = SqliteValue::Integer;
+				result.m_integer = this->id(world, target);
+			}
+		}
+		else if(field.m_kind == FieldKind::String)
+		{
+			result.m_kind = SqliteValue::Text;
+			result.m_bytes = *reinterpret_cast<const string*>(value);
+		}
+		else if(strcmp(column_type(field), "REAL") == 0)
+		{
+			result.m_kind = SqliteValue::Real;
+			result.m_real = field.m_size == sizeof(float) ? double(*reinterpret_cast<const float*>(value)) : *reinterpret_cast<const double*>(value);
+		}
+		else if(strcmp(column_type(field), "INTEGER") == 0)
+		{
+			result.m_kind = SqliteValue::Integer;
+			memcpy(&result.m_integer, value, field.m_size);
+		}
+		else
+		{
+			result.m_kind = SqliteValue::Blob;
+			result.m_bytes.assign(reinterpret_cast<const char*>(value), field.m_size);
+		}
+	}
+
+	void SqliteWorld::apply(const WorldSnapshot::Field& field, const SqliteValue& value, uint8_t* result, const map<int64_t, Entity>& loaded)
+	{
+		// a null column is a field added after the row was stored : it keeps its default
+		if(value.m_kind == SqliteValue::Null)
+			return;
+
+		if(field.m_kind == FieldKind::Handle)
+		{
+			auto it = loaded.find(value.m_integer);
+			auto resident = m_entities.find(value.m_integer);
+			Entity target = it != loaded.end() ? it->second : resident != m_entities.end() ? resident->second : Entity();
+			field.m_handle->m_set(result, target);
+		}
+		else if(field.m_kind == FieldKind::String)
+			*reinterpret_cast<string*>(result) = value.m_bytes;
+		else if(value.m_kind == SqliteValue::Real && field.m_size == sizeof(float))
+			*reinterpret_cast<float*>(result) = float(value.m_real);
+		else if(value.m_kind == SqliteValue::Real && field.m_size == sizeof(double))
+			*reinterpret_cast<double*>(result) = value.m_real;
+		else if(value.m_kind == SqliteValue::Integer && field.m_size <= sizeof(int64_t))
+			memcpy(result, &value.m_integer, field.m_size);
+		else if(value.m_kind == SqliteValue::Blob && value.m_bytes.size() == field.m_size)
+			memcpy(result, value.m_bytes.data(), field.m_size);
+	}
+
+	void SqliteWorld::save(World& world)
+	{
+		for(HSpatial root : world.origin()->m_contents)
+			this->save(root);
+	}
+
+	void SqliteWorld::save_page(World& world, const ivec2& coord)
+	{
+		for(HSpatial root : world.origin()->m_contents)
+			if(this->page_coord(root->m_position) == coord)
+				this->save(root);
+	}
+
+	void SqliteWorld::save(HSpatial root)
+	{
+		if(!m_world)
+			return;
+
+		World& world = *root->m_world;
+
+		vector<Entity> entities = { root };
+		gather_entities(root, entities);
+
+		SqliteRoot write;
+		write.m_id = this->id(world, root);
+		write.m_page = this->page_coord(root->m_position);
+		write.m_rows.resize(m_tables.size());
+
+		for(size_t i = 0; i < entities.size(); ++i)
+		{
+			const int64_t id = this->id(world, entities[i]);
+			for(int64_t column : { id, write.m_id, int64_t(i), int64_t(write.m_page.x), int64_t(write.m_page.y) })
+			{
+				SqliteValue value;
+				value.m_kind = SqliteValue::Integer;
+				value.m_integer = column;
+				write.m_entities.push_back(value);
+			}
+
+			for(size_t t = 0; t < m_tables.size(); ++t)
+			{
+				const Table& table = m_tables[t];
+				const uint8_t* object = static_cast<const uint8_t*>(table.m_component.m_get(entities[i]));
+				if(!object)
+					continue;
+
+				vector<SqliteValue>& rows = write.m_rows[t];
+				rows.emplace_back();
+				rows.back().m_kind = SqliteValue::Integer;
+				rows.back().m_integer = id;
+				for(const WorldSnapshot::Field& field : table.m_fields)
+				{
+					rows.emplace_back();
+					this->value(world, field, object + field.m_offset, rows.back());
+				}
+			}
+		}
+
+		m_queued.push_back(move(write));
+	}
+
+	void SqliteWorld::erase(HSpatial root)
+	{
+		auto it = m_ids.find(entity_key(root));
+		if(!m_world || it == m_ids.end())
+			return;
+
+		SqliteRoot write;
+		write.m_id = it->second;
+		write.m_page = this->page_coord(root->m_position);
+		write.m_erase = true;
+		m_queued.push_back(move(write));
+		this->forget(root);
+	}
+
+	void SqliteWorld::forget(HSpatial root)
+	{
+		vector<Entity> entities = { root };
+		gather_entities(root, entities);
+
+		for(Entity entity : entities)
+		{
+			auto it = m_ids.find(entity_key(entity));
+			if(it == m_ids.end())
+				continue;
+			m_entities.erase(it->second);
+			m_ids.erase(it);
+		}
+	}
+
+	Entity SqliteWorld::load_page(World& world, const ivec2& coord)
+	{
+		if(!m_world)
+			return Entity();
+
+		// the page is read as committed : saves of the page still queued or being written must land first
+		if(pending(m_queued, coord) || (m_task && pending(m_task->m_roots, coord)))
+			this->flush();
+
+		sqlite3_stmt* select = m_reader.prepare("SELECT id FROM entities WHERE page_x = ?1 AND page_z = ?2 ORDER BY root, seq");
+		if(!select)
+			return Entity();
+
+		vector<int64_t> ids;
+		sqlite3_bind_int(select, 1, coord.x);
+		sqlite3_bind_int(select, 2, coord.y);
+		while(sqlite3_step(select) == SQLITE_ROW)
+			ids.push_back(sqlite3_column_int64(select, 0));
+		sqlite3_finalize(select);
+
+		if(ids.empty())
+			return Entity();
+
+		map<int64_t, size_t> index;
+		for(size_t i = 0; i < ids.size(); ++i)
+			index[ids[i]] = i;
+
+		// the rows are read first : the components an entity has in the tables decide its archetype
+		struct Row { size_t m_index; vector<SqliteValue> m_values; };
+		vector<vector<Row>> rows(m_tables.size());
+		vector<uint64_t> masks(ids.size(), 0);
+
+		for(size_t t = 0; t < m_tables.size(); ++t)
+		{
+			const Table& table = m_tables[t];
+			sqlite3_stmt* query = m_reader.prepare("SELECT C.* FROM " + quoted(table.m_name) + " AS C JOIN entities AS E ON E.id = C.entity WHERE E.page_x = ?1 AND E.page_z = ?2");
+			if(!query)
+				continue;
+
+			sqlite3_bind_int(query, 1, coord.x);
+			sqlite3_bind_int(query, 2, coord.y);
+
+			// columns are matched to the fields by name, the columns of removed fields are skipped
+			const int count = sqlite3_column_count(query);
+			vector<int> columns(count, -1);
+			int entity = 0;
+			for(int c = 0; c < count; ++c)
+			{
+				const string name = sqlite3_column_name(query, c);
+				if(name == "entity")
+					entity = c;
+				for(size_t f = 0; f < table.m_fields.size(); ++f)
+					if(table.m_fields[f].m_name == name)
+						columns[c] = int(f);
+			}
+
+			while(sqlite3_step(query) == SQLITE_ROW)
+			{
+				auto it = index.find(sqlite3_column_int64(query, entity));
+				if(it == index.end())
+					continue;
+
+				rows[t].push_back({ it->second, vector<SqliteValue>(table.m_fields.size()) });
+				for(int c = 0; c < count; ++c)
+					if(columns[c] >= 0)
+						rows[t].back().m_values[columns[c]] = column(query, c);
+				masks[it->second] |= uint64_t(1) << table.m_component.m_buffer;
+			}
+			sqlite3_finalize(query);
+		}
+
+		vector<Entity> entities = { world.origin(), world.unworld() };
+		map<int64_t, Entity> loaded = { { 0, world.origin() }, { 1, world.unworld() } };
+
+		size_t missing = 0;
+		for(size_t i = 0; i < ids.size(); ++i)
+		{
+			Entity entity = m_snapshot.create(world, masks[i]);
+			entities.push_back(entity);
+			if(!entity)
+			{
+				++missing;
+				continue;
+			}
+			loaded[ids[i]] = entity;
+			m_ids[entity_key(entity)] = ids[i];
+			m_entities[ids[i]] = entity;
+		}
+
+		if(missing > 0)
+			printf("[warning] SqliteWorld page %i, %i has %zu entities of no registered archetype, they are not loaded\n", coord.x, coord.y, missing);
+
+		for(size_t t = 0; t < m_tables.size(); ++t)
+			for(const Row& row : rows[t])
+			{
+				Entity entity = entities[row.m_index + 2];
+				uint8_t* object = entity ? static_cast<uint8_t*>(m_tables[t].m_component.m_get(entity)) : nullptr;
+				if(!object)
+					continue;
+				for(size_t f = 0; f < row.m_values.size(); ++f)
+					this->apply(m_tables[t].m_fields[f], row.m_values[f], object + m_tables[t].m_fields[f].m_offset, loaded);
+			}
+
+		// the entities of the page are added to the world, none is replaced
+		vector<bool> restored(entities.size(), true);
+		WorldSnapshot::attach(world, entities, restored);
+		m_snapshot.rebind(world, entities, restored, WorldSnapshot::Remap());
+
+		m_loaded += ids.size() - missing;
+
+		for(size_t i = 2; i < entities.size(); ++i)
+			if(entities[i] && try_asa<WorldPage>(entities[i]))
+				return entities[i];
+		return Entity();
+	}
+
+	PageSource SqliteWorld::page_source(World& world)
+	{
+		World* target = &world;
+		return { "database", [this, target](const ivec2& coord) { return this->load_page(*target, coord); } };
+	}
+
+	void SqliteWorld::stream(World& world, WorldStream& stream)
+	{
+		stream.m_sources.insert(stream.m_sources.begin(), this->page_source(world));
+
+		// an evicted page is saved as it is before being destroyed
+		function<void(WorldStream::Page&)> unload = stream.m_on_unload;
+		stream.m_on_unload = [this, unload](WorldStream::Page& page)
+		{
+			if(unload)
+				unload(page);
+			this->save(page.m_page->m_spatial);
+			this->forget(page.m_page->m_spatial);
+		};
+	}
+
+	void SqliteWorld::update()
+	{
+		if(m_task && m_task->m_done)
+			this->finish();
+
+		if(!m_task && !m_queued.empty())
+			this->start();
+	}
+
+	void SqliteWorld::flush()
+	{
+		while(this->writing())
+		{
+			if(!m_task)
+				this->start();
+			if(!m_task->m_done)
+				m_task->m_job_system->complete(m_task->m_job);
+			this->finish();
+		}
+	}
+
+	void SqliteWorld::start()
+	{
+		m_task = std::make_shared<SqliteWrite>();
+		m_task->m_roots = move(m_queued);
+		m_queued.clear();
+
+		// the batches are flushed when the database is closed, and joined with the other tasks of the world when it's torn down
+		SqliteWorld* self = this;
+		SqliteWrite* task = m_task.get();
+		m_world->m_tasks.run(&m_world->m_job_system, m_task, [self, task]() { task->m_success = self->write(*task); });
+	}
+
+	void SqliteWorld::finish()
+	{
+		if(m_task->m_success)
+			m_written += m_task->m_rows;
+		else
+			printf("[warning] SqliteWorld %s : %zu roots could not be written\n", m_writer.m_path.c_str(), m_task->m_roots.size());
+		m_task = nullptr;
+	}
+
+	bool SqliteWorld::write(SqliteWrite& task)
+	{
+		if(!m_writer.begin())
+			return false;
+
+		bool success = true;
+		for(const SqliteRoot& root : task.m_roots)
+		{
+			// the rows a root had are replaced : entities removed from it since are removed with them
+			for(const Table& table : m_tables)
+			{
+				sqlite3_bind_int64(table.m_erase, 1, root.m_id);
+				success &= m_writer.step(table.m_erase);
+			}
+			sqlite3_bind_int64(m_erase, 1, root.m_id);
+			success &= m_writer.step(m_erase);
+
+			if(root.m_erase)
+				continue;
+
+			success &= insert_rows(m_writer, m_insert, root.m_entities, ENTITY_COLUMNS);
+			task.m_rows += root.m_entities.size() / ENTITY_COLUMNS;
+
+			for(size_t t = 0; t < m_tables.size(); ++t)
+				success &= insert_rows(m_writer, m_tables[t].m_insert, root.m_rows[t], m_tables[t].m_fields.size() + 1);
+		}
+
+		if(!success)
+		{
+			m_writer.rollback();
+			return false;
+		}
+		return m_writer.commit();
+	}
+}
@@ -0,0 +1,129 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is provided 'as-is' under the zlib License, see the LICENSE.txt file.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#pragma once
+
+#include <stl/vector.h>
+#include <stl/string.h>
+#include <stl/map.h>
+#include <math/Vec.h>
+#include <ecs/ECS.h>
+#include <core/World/Snapshot.h>
+#include <core/WorldPage/WorldStream.h>
+#include <db/Forward.h>
+#include <db/SqliteDatabase.h>
+
+#include <memory>
+#include <stdint.h>
+
+namespace toy
+{
+	struct SqliteValue
+	{
+		enum Kind : uint8_t { Null, Integer, Real, Text, Blob };
+
+		Kind m_kind = Null;
+		int64_t m_integer = 0;
+		double m_real = 0.0;
+		string m_bytes;
+	};
+
+	// rows of a root and of the entities under it, written in place of the ones it had
+	struct SqliteRoot
+	{
+		int64_t m_id = 0;
+		ivec2 m_page = ivec2(0);
+		bool m_erase = false;
+		vector<SqliteValue> m_entities;
+		// one list per component table : the entity id, then one value per field
+		vector<vector<SqliteValue>> m_rows;
+	};
+
+	/* Stores the entities of a world in a sqlite database, and loads them back a page at a time :
+		- a root is a child of the origin of the world, it's saved and loaded with all the entities under it
+		- the entities table holds each entity with its root, its order under the root, and the page the root is in
+		- one table per component registered in the snapshot, keyed by entity id, with one column per field
+		- columns are matched by name : the fields added to a component are added to its table, the removed ones are ignored
+		- saves are batched on the main thread, and written in a transaction on a task of the world, one batch at a time and in order
+		- the database is in WAL mode, so that the pages are read on the main thread while a batch is being written
+		- handles are stored as entity ids, a handle to an entity that isn't loaded is loaded null
+	*/
+
+	class TOY_DB_EXPORT SqliteWorld
+	{
+	public:
+		SqliteWorld(WorldSnapshot& snapshot, const string& path, const vec3& page_size);
+		~SqliteWorld();
+
+		WorldSnapshot& m_snapshot;
+		vec3 m_page_size;
+
+		// creates or migrates the tables of the components registered in the snapshot, the batches are written on the jobs of the world
+		bool open(World& world);
+		void close();
+
+		// queues the roots of the world, the ones in a page, or a single root
+		void save(World& world);
+		void save_page(World& world, const ivec2& coord);
+		void save(HSpatial root);
+		// queues the removal of a root that was destroyed
+		void erase(HSpatial root);
+		// drops the ids of the entities under a root, which is about to be destroyed : its saved rows are kept
+		void forget(HSpatial root);
+
+		// creates the roots stored in a page, and returns the world page among them
+		Entity load_page(World& world, const ivec2& coord);
+
+		// the database as the first source of the pages of a stream, the pages being saved before they are evicted
+		PageSource page_source(World& world);
+		void stream(World& world, WorldStream& stream);
+
+		ivec2 page_coord(const vec3& position) const;
+
+		// called once per frame : starts writing the queued saves once the previous batch is committed
+		void update();
+		// waits until all the queued saves are written
+		void flush();
+
+		bool writing() const { return m_task != nullptr || !m_queued.empty(); }
+
+		size_t m_written = 0;
+		size_t m_loaded = 0;
+
+	private:
+		struct Table
+		{
+			WorldSnapshot::Component m_component;
+			string m_name;
+			vector<WorldSnapshot::Field> m_fields;
+			sqlite3_stmt* m_insert = nullptr;
+			sqlite3_stmt* m_erase = nullptr;
+		};
+
+		SqliteDatabase m_writer;
+		SqliteDatabase m_reader;
+		World* m_world = nullptr;
+
+		vector<Table> m_tables;
+		sqlite3_stmt* m_insert = nullptr;
+		sqlite3_stmt* m_erase = nullptr;
+
+		// ids of the entities loaded or saved, the two roots of the world being 0 and 1
+		map<uint64_t, int64_t> m_ids;
+		map<int64_t, Entity> m_entities;
+		int64_t m_next_id = 2;
+
+		vector<SqliteRoot> m_queued;
+		std::shared_ptr<SqliteWrite> m_task;
+
+		bool create_table(Table& table);
+		int64_t id(World& world, Entity entity);
+		void value(World& world, const WorldSnapshot::Field& field, const uint8_t* value, SqliteValue& result);
+		void apply(const WorldSnapshot::Field& field, const SqliteValue& value, uint8_t* result, const map<int64_t, Entity>& loaded);
+
+		void start();
+		void finish();
+		bool write(SqliteWrite& task);
+	};
+}
@@ -77,13 +77,20 @@ using namespace two; namespace toy
 		if(!m_pathfinder)
 			m_pathfinder = make_unique<Pathfinder>(navmesh);
 
-		m_path = make_object<DetourPath>(m_entity, *m_pathfinder, m_entity.absolute_position(), destination);
-		m_path->compute();
+		// the corridor of the current path follows the new destination, it is only searched again when it can't be repaired
+		if(m_path)
+			m_path->update(m_entity.absolute_position(), destination);
+		else
+		{
+			m_path = make_object<DetourPath>(m_entity, *m_pathfinder, m_entity.absolute_position(), destination);
+			m_path->compute();
+		}
 	}
 
 	void Agent::updatePath()
 	{
-		m_path->compute();
+		m_path->update(m_entity.absolute_position(), m_path->m_destination);
+		m_path->optimize();
 	}
 
 	bool Agent::popWaypoint()
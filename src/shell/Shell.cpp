@@ -14,6 +14,7 @@
 #include <Tracy.hpp>
 
 #include <numeric>
+#include <algorithm>
 #include <deque>
 
 class WrenVM;
@@ -159,8 +160,11 @@ namespace toy
 #ifdef TOY_SOUND
 		, m_sound_system(oconstruct<SoundManager>(resource_path))
 #endif
+		, m_assets(*m_job_system)
 		, m_editor(*m_gfx)
 		, m_game(m_user, *m_gfx)
+		, m_autosave(m_snapshot)
+		, m_recorder(m_snapshot)
 	{
 		System::instance().load_modules({ &two_infra::m(), &two_type::m(), &two_pool::m(), &two_refl::m(), &two_ecs::m(), &two_tree::m() });
 		System::instance().load_modules({ &two_srlz::m(), &two_math::m(), &two_geom::m(), &two_lang::m() });
@@ -190,12 +194,20 @@ namespace toy
 		m_job_system->emancipate();
 	}
 
+	// the asset created by the store is its own placeholder : the file is read and unpacked into a copy on a job, swapped in between frames
 	template <class T_Asset>
-	void add_asset_loader(AssetStore<T_Asset>& store, cstring format)
+	void add_asset_loader(AssetQueue& queue, AssetStore<T_Asset>& store, cstring format)
 	{
 		auto loader = [&](T_Asset& asset, const string& path, const NoConfig& config)
 		{
-			unpack_json_file(Ref(&asset), path + store.m_formats[0]);
+			UNUSED(config);
+			T_Asset* target = &asset;
+			std::shared_ptr<T_Asset> staged = std::make_shared<T_Asset>(asset);
+			const string file = path + store.m_formats[0];
+
+			auto load = [staged, file]() { unpack_json_file(Ref(staged.get()), file); return true; };
+			auto publish = [target, staged]() { *target = move(*staged); return true; };
+			queue.load(file, load, publish, true);
 		};
 
 		store.add_format(format, loader);
@@ -219,7 +231,7 @@ namespace toy
 
 		//declare_gfx_edit();
 
-		add_asset_loader(m_gfx->flows(), ".ptc");
+		add_asset_loader(m_assets, m_gfx->flows(), ".ptc");
 	}
 
 	GameWindow& GameShell::window(const string& name, const uvec2& size, bool fullscreen)
@@ -386,6 +398,7 @@ namespace toy
 			time = 0.f;
 		time(m_times, Step::GfxRender,	"gfx",			[&] { ZoneScopedNC("gfx",		tracy::Color::Green);	  pursue &= m_gfx->begin_frame(); });
 		time(m_times, Step::Core,		"core",			[&] { ZoneScopedNC("core",      tracy::Color::Red);       m_core->next_frame(); });
+		time(m_times, Step::Core,		"assets",		[&] { ZoneScopedNC("assets",    tracy::Color::Gray);      m_assets.update(); });
 		m_pump();
 		time(m_times, Step::GfxRender,	"gfx",			[&] { ZoneScopedNC("contexts",  tracy::Color::Pink);      m_gfx->render_contexts(); });
 		time(m_times, Step::GfxRender,	"gfx",			[&] { ZoneScopedNC("gfx",       tracy::Color::Green);     m_gfx->end_frame(); });
@@ -399,13 +412,44 @@ namespace toy
 	void GameShell::start_game()
 	{
 		m_game_module->start(*this, m_game);
+		this->bind_game();
 		//this->pump_game();
 	}
 
+	void GameShell::bind_game()
+	{
+		// a game started again registers its snapshot entries again
+		Module* module = m_game_module->m_module;
+		m_snapshot.unbind(*module);
+		m_snapshot.m_scope = module;
+		if(m_game.m_world)
+			m_game.m_world->m_pump.m_scope = module;
+
+		m_game_module->bind(*this, m_game);
+
+		m_snapshot.m_scope = nullptr;
+		if(m_game.m_world)
+			m_game.m_world->m_pump.m_scope = nullptr;
+	}
+
+	void GameShell::unbind_game()
+	{
+		Module& module = *m_game_module->m_module;
+		m_snapshot.unbind(module);
+		if(m_game.m_world)
+			m_game.m_world->m_pump.remove_steps(module);
+	}
+
 	void GameShell::frame_world()
 	{
 		if(m_game.m_world)
-			m_game.m_world->next_frame();
+			m_recorder.next_frame(*m_game.m_world);
+	}
+
+	void GameShell::frame_autosave()
+	{
+		if(m_game.m_world)
+			m_autosave.update(*m_game.m_world);
 	}
 
 	void GameShell::frame_game()
@@ -426,6 +470,7 @@ namespace toy
 	void GameShell::pump_game()
 	{
 		time(m_times, Step::World, "world",  [&] { ZoneScopedNC("world",  tracy::Color::AliceBlue); this->frame_world(); });
+		time(m_times, Step::Autosave, "autosave", [&] { ZoneScopedNC("autosave", tracy::Color::Gray); this->frame_autosave(); });
 		time(m_times, Step::Game,  "game",   [&] { ZoneScopedNC("game",   tracy::Color::Violet);    this->frame_game(); });
 		time(m_times, Step::Scene, "scenes", [&] { ZoneScopedNC("scenes", tracy::Color::Orange);    this->frame_scenes(); });
 	}
@@ -444,6 +489,8 @@ namespace toy
 
 		if(m_editor.m_run_game)
 			time(m_times, Step::World, "world", [&] { ZoneScopedNC("world", tracy::Color::AliceBlue); this->frame_world(); });
+		if(m_editor.m_run_game)
+			time(m_times, Step::Autosave, "autosave", [&] { ZoneScopedNC("autosave", tracy::Color::Gray); this->frame_autosave(); });
 		if(m_editor.m_run_game && m_editor.m_play_game)
 			time(m_times, Step::Game,  "game",  [&] { ZoneScopedNC("game", tracy::Color::Violet); this->frame_game(); });
 
@@ -476,16 +523,22 @@ namespace toy
 
 	void GameShell::save()
 	{
-		pack_json_file(Ref(m_game.m_world), "");
+		const string path = m_game.m_world->m_name + ".world";
+		if(m_snapshot.save(*m_game.m_world, path))
+			printf("[info] Saved world %s : %zu entities, %zu bytes\n", path.c_str(), m_snapshot.m_entities, m_snapshot.m_size);
 	}
 
 	World& GameShell::load_world(uint32_t id)
 	{
 		UNUSED(id);
-		Ref world;
-		unpack_json_file(world, "");
-		m_game.m_world = &val<World>(world);
-		return val<World>(world);
+		// the game module creates the world and its systems, its entities are then replaced with the saved ones
+		if(!m_game.m_world)
+			this->start_game();
+
+		const string path = m_game.m_world->m_name + ".world";
+		if(m_snapshot.load(*m_game.m_world, path))
+			printf("[info] Loaded world %s : %zu entities, %zu bytes\n", path.c_str(), m_snapshot.m_entities, m_snapshot.m_size);
+		return *m_game.m_world;
 	}
 
 	void GameShell::destroy_world()
@@ -497,13 +550,44 @@ namespace toy
 
 	void GameShell::reload()
 	{
-		uint32_t id = m_game.m_world->m_id;
-		this->save();
-		this->destroy_world();
+		TimerBx timer;
+		timer.begin();
+
+		// the world stays in memory : only the entities holding components of the module are unloaded, and restored once it is reloaded
+		World& world = *m_game.m_world;
+		WorldSnapshot::Image image;
+		m_snapshot.capture(world, image);
+		vector<bool> unloaded = m_snapshot.unload(*m_game_module->m_module, image);
+		this->unbind_game();
 
 		m_game_module->m_module = &System::instance().reload_module(*m_game_module->m_module);
 
-		m_game.m_world = &this->load_world(id);
+		this->bind_game();
+		m_snapshot.restore(world, image, unloaded);
+
+		const size_t count = std::count(unloaded.begin(), unloaded.end(), true);
+		printf("[info] Reloaded module, %zu of %zu entities migrated in %.2f ms\n", count, unloaded.size(), 1000.f * timer.end());
+	}
+
+	void GameShell::record(uint32_t seed)
+	{
+		m_recorder.m_user = &m_user;
+		m_recorder.record(*m_game.m_world, seed);
+	}
+
+	void GameShell::stop_recording()
+	{
+		m_recorder.stop(m_game.m_world->m_name + ".replay");
+	}
+
+	bool GameShell::replay(const string& path)
+	{
+		// the game module creates the world and its systems, the recording then drives it from its snapshot
+		if(!m_game.m_world)
+			this->start_game();
+
+		m_recorder.m_user = &m_user;
+		return m_recorder.run(*m_game.m_world, path);
 	}
 
 	void GameShell::cleanup()
@@ -522,6 +606,7 @@ namespace toy
 		entry(parent, "ui input",	int(1000.f * m_times[Step::Input]));
 		entry(parent, "core",		int(1000.f * m_times[Step::Core]));
 		entry(parent, "world",		int(1000.f * m_times[Step::World]));
+		entry(parent, "autosave",	int(1000.f * m_times[Step::Autosave]));
 		entry(parent, "game",		int(1000.f * m_times[Step::Game]));
 		entry(parent, "scenes",		int(1000.f * m_times[Step::Scene]));
 		entry(parent, "ui render",	int(1000.f * m_times[Step::UiRender]));
@@ -8,6 +8,10 @@
 #include <refl/VirtualMethod.h>
 #include <shell/Forward.h>
 #include <core/User.h>
+#include <core/World/Snapshot.h>
+#include <core/World/Autosave.h>
+#include <core/World/Replay.h>
+#include <core/Asset/AssetQueue.h>
 
 #include <edit/Editor/Editor.h>
 #include <lang/Lua.h>
@@ -81,6 +85,9 @@ namespace toy
 		meth_ virtual void pump(GameShell& shell, Game& game, Widget& ui) = 0;
 		meth_ virtual void scene(GameShell& shell, GameScene& scene) { UNUSED(shell); UNUSED(scene); }
 		meth_ virtual void paint(GameShell& shell, GameScene& scene, Gnode& graph) { UNUSED(shell); UNUSED(scene); UNUSED(graph); }
+
+		// binds the module code to the shell and the world : snapshot components and world loops, bound again when the module is reloaded
+		virtual void bind(GameShell& shell, Game& game) { UNUSED(shell); UNUSED(game); }
 	};
 
 	class refl_ TOY_SHELL_EXPORT GameModuleBind : public GameModule
@@ -144,6 +151,12 @@ namespace toy
 		meth_ void launch();
 		meth_ void save();
 		meth_ void reload();
+
+		// records the frames of the world and the inputs passed to the recorder, until stopped : saved as <world name>.replay
+		void record(uint32_t seed = 0);
+		void stop_recording();
+		// replays a recording at once, without presenting any frame, and returns false when it diverged
+		bool replay(const string& path);
 		meth_ bool pump();
 		meth_ void cleanup();
 
@@ -154,7 +167,10 @@ namespace toy
 		void reset_interpreters(bool reflect);
 
 		void start_game();
+		void bind_game();
+		void unbind_game();
 		void frame_world();
+		void frame_autosave();
 		void frame_game();
 		void frame_scenes();
 
@@ -196,6 +212,9 @@ namespace toy
 		object<SoundManager> m_sound_system;
 #endif
 
+		// assets loaded on jobs, and published between frames
+		AssetQueue m_assets;
+
 		vector<unique<GameWindow>> m_windows;
 
 		attr_ Editor m_editor;
@@ -206,9 +225,15 @@ namespace toy
 		GameModule* m_game_module = nullptr;
 		Game m_game;
 
+		// components and archetypes saved with the world, game modules register their own in init()
+		WorldSnapshot m_snapshot;
+		WorldAutosave m_autosave;
+		// inputs and procedures are passed through the recorder, so that a recorded session can be replayed
+		WorldRecorder m_recorder;
+
 		function<void()> m_pump;
 
-		enum class Step : unsigned int { Input = 0, Core, World, Game, Scene, UiRender, GfxRender, Count };
+		enum class Step : unsigned int { Input = 0, Core, World, Autosave, Game, Scene, UiRender, GfxRender, Count };
 		table<Step, float> m_times = {};
 	};
 
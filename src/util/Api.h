@@ -1,5 +1,6 @@
 //#include <util/Executable.h>
 #include <util/Forward.h>
+#include <util/Hash.h>
 #include <util/Procedure.h>
 #include <util/Types.h>
 #include <util/Threading/Scheduler.h>
@@ -0,0 +1,22 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#include <util/Types.h>
+#include <util/Hash.h>
+
+namespace toy
+{
+	uint64_t hash_bytes(const void* data, size_t size, uint64_t seed)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+		uint64_t hash = seed;
+		for(size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+}
@@ -0,0 +1,17 @@
+//  Copyright (c) 2019 Hugo Amiard hugo.amiard@laposte.net
+//  This software is licensed  under the terms of the GNU General Public License v3.0.
+//  See the attached LICENSE.txt file or https://www.gnu.org/licenses/gpl-3.0.en.html.
+//  This notice and the license may not be removed or altered from any source distribution.
+
+#pragma once
+
+#include <util/Forward.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace toy
+{
+	// FNV-1a of a block of bytes : a hash is extended with more bytes by passing it as the seed
+	TOY_UTIL_EXPORT uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ULL);
+}
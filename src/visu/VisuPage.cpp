@@ -33,7 +33,6 @@ namespace toy
 	{
 		if(page.m_updated > page.m_last_rebuilt)
 		{
-			printf("[info] Rebuilding WorldPage geometry\n");
 			build_world_page_geometry(*parent.m_scene, page);
 			page.update_geometry(page.m_spatial->m_last_tick);
 		}